@@ -65,6 +65,32 @@ LLNode *llPrepend(LLNode *listp, LLNode *newp)
 }
 
 
+/*
+ * llInsertByIndexOrder: place newp in listp in ascending order of
+ * key, after any nodes with an equal key
+ *
+ * this walks the list, so is O(n) for each insert
+ *
+ * as above, we always return the value that
+ * should be the new head of the list
+ */
+LLNode * llInsertByIndexOrder(LLNode *listp, LLNode *newp)
+{
+	LLNode *p;
+
+	if (listp == NULL || strcmp(newp->key, listp->key) < 0)
+		return llPrepend(listp, newp);
+
+	for (p = listp; p->next != NULL
+			&& strcmp(p->next->key, newp->key) <= 0; p = p->next)
+		;
+
+	newp->next = p->next;
+	p->next = newp;
+	return listp;
+}
+
+
 /* llLookupKey: sequential search for key in listp */
 LLNode *llLookupKey(LLNode *listp, char *key)
 {
@@ -31,7 +31,7 @@ LLNode *llPrepend(LLNode *listp, LLNode *newp);
 /* llAppend: add newp to end of listp */
 LLNode *llAppend(LLNode *listp, LLNode *newp);
 
-/* llInsertSort: place the value in the list according to index ordering */
+/* llInsertByIndexOrder: place newp in listp in ascending key order */
 LLNode *llInsertByIndexOrder(LLNode *listp, LLNode *newp);
 
 /* llLookupKey: sequential search for name in listp */
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "bucket_output.h"
+
+/** the starting size of each bucket's buffer; it grows as needed */
+#define	BUCKET_BUFFER_SIZE	(16 * 1024)
+
+typedef struct BucketJob {
+	LLNode **wordListHeads;
+	BucketFormatFn formatFn;
+	OutWriter *buffers;		/* one per bucket, indexed from first */
+	int first;
+	int last;
+	atomic_int nextBucket;
+} BucketJob;
+
+
+static void *
+bucketWorker_(void *arg)
+{
+	BucketJob *job = (BucketJob *) arg;
+	int bucket;
+
+	while ((bucket = atomic_fetch_add(&job->nextBucket, 1)) <= job->last) {
+		(*job->formatFn)(&job->buffers[bucket - job->first], bucket,
+				job->wordListHeads[bucket]);
+	}
+	return NULL;
+}
+
+
+int
+writeBuckets(OutWriter *writer, LLNode **wordListHeads, int first,
+		int last, BucketFormatFn formatFn, int nThreads)
+{
+	BucketJob job;
+	pthread_t *threads;
+	int i, nStarted, status = 1;
+
+	if (nThreads > last - first + 1)
+		nThreads = last - first + 1;
+
+	if (nThreads <= 1) {
+		for (i = first; i <= last; i++)
+			(*formatFn)(writer, i, wordListHeads[i]);
+		return 1;
+	}
+
+	job.wordListHeads = wordListHeads;
+	job.formatFn = formatFn;
+	job.first = first;
+	job.last = last;
+	atomic_init(&job.nextBucket, first);
+	job.buffers = (OutWriter *) malloc((last - first + 1) * sizeof(OutWriter));
+	threads = (pthread_t *) malloc(nThreads * sizeof(pthread_t));
+	if (job.buffers == NULL || threads == NULL) {
+		free(job.buffers);
+		free(threads);
+		return 0;
+	}
+	for (i = 0; i <= last - first; i++) {
+		if (owInitMemory(&job.buffers[i], BUCKET_BUFFER_SIZE) < 0) {
+			while (--i >= 0)
+				owClose(&job.buffers[i]);
+			free(job.buffers);
+			free(threads);
+			return 0;
+		}
+	}
+
+	/** this thread works too; any threads that fail to start leave
+	 * their share to the rest */
+	for (nStarted = 0; nStarted < nThreads - 1; nStarted++) {
+		if (pthread_create(&threads[nStarted], NULL, bucketWorker_, &job) != 0)
+			break;
+	}
+	bucketWorker_(&job);
+	for (i = 0; i < nStarted; i++)
+		pthread_join(threads[i], NULL);
+
+	for (i = 0; i <= last - first; i++) {
+		if (job.buffers[i].error)
+			status = 0;
+		owWrite(writer, job.buffers[i].buffer, job.buffers[i].used);
+		owClose(&job.buffers[i]);
+	}
+
+	free(job.buffers);
+	free(threads);
+	return status;
+}
@@ -0,0 +1,29 @@
+
+#ifndef	__BUCKET_OUTPUT_HEADER__
+#define	__BUCKET_OUTPUT_HEADER__
+
+#include "LLNode.h"
+#include "out_writer.h"
+
+/**
+ * Output of the per-length word lists, one bucket (list) at a time.
+ *
+ * With more than one thread, each worker claims the next unformatted
+ * bucket and formats it into a buffer of its own; the buffers are
+ * then written out in bucket order, so the output is exactly what
+ * formatting the buckets one after another would give.
+ */
+
+/** format the list for words of length into writer */
+typedef void (*BucketFormatFn)(OutWriter *writer, int length, LLNode *head);
+
+/**
+ * Format buckets first to last (inclusive) of wordListHeads with
+ * formatFn, using nThreads threads, and write them to writer in order.
+ *
+ * Returns 1 on success, or 0 if a buffer could not be allocated
+ */
+int writeBuckets(OutWriter *writer, LLNode **wordListHeads, int first,
+		int last, BucketFormatFn formatFn, int nThreads);
+
+#endif /* __BUCKET_OUTPUT_HEADER__ */
@@ -0,0 +1,358 @@
+/**
+ * Transparent decompressing input, see compressed_input.h
+ *
+ * The compressed data is decoded by a producer thread into one of
+ * two buffers while the consumer (the thread calling fgets() and
+ * friends) drains the other.  The FILE handed back to the caller is
+ * built with fopencookie(3), so the existing parsers need no change
+ * beyond calling ciOpen() in place of fopen().
+ */
+
+#define	_GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "compressed_input.h"
+
+
+typedef struct CIStream {
+	int format;
+	int fd;
+	gzFile gz;
+#ifdef HAVE_ZSTD
+	ZSTD_DStream *zds;
+	ZSTD_inBuffer zin;
+	char *zinBuffer;
+	size_t zinBufferSize;
+#endif
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+
+	/** the two buffers handed back and forth between the threads */
+	char *buffer[2];
+	ssize_t length[2];
+	int full[2];
+
+	/** consumer side position */
+	int drainIndex;
+	ssize_t drainPos;
+
+	int stopRequested;
+} CIStream;
+
+
+static const unsigned char gzipMagic_[] = { 0x1f, 0x8b };
+static const unsigned char zstdMagic_[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+
+/**
+ * Fill buf with up to size bytes of decompressed data.
+ *
+ * Returns the number of bytes placed in buf, 0 at the end of
+ * the data, or -1 on error
+ */
+static ssize_t
+decompressInto_(CIStream *cs, char *buf, size_t size)
+{
+	size_t total = 0;
+
+	if (cs->format == CI_FORMAT_GZIP) {
+		while (total < size) {
+			int n = gzread(cs->gz, buf + total, (unsigned) (size - total));
+			if (n < 0)
+				return -1;
+			if (n == 0)
+				break;
+			total += n;
+		}
+		return total;
+	}
+
+#ifdef HAVE_ZSTD
+	if (cs->format == CI_FORMAT_ZSTD) {
+		ZSTD_outBuffer zout = { buf, size, 0 };
+		size_t before;
+		int inputEnded = 0;
+
+		while (zout.pos < zout.size) {
+			if (cs->zin.pos == cs->zin.size && ! inputEnded) {
+				ssize_t nRead = read(cs->fd, cs->zinBuffer, cs->zinBufferSize);
+				if (nRead < 0)
+					return -1;
+				cs->zin.src = cs->zinBuffer;
+				cs->zin.size = nRead;
+				cs->zin.pos = 0;
+				inputEnded = (nRead == 0);
+			}
+
+			/**
+			 * Once the input has run out the decoder may still hold
+			 * output it had no room for, so keep calling it with no
+			 * input until it gives back nothing more
+			 */
+			before = zout.pos;
+			if (ZSTD_isError(ZSTD_decompressStream(cs->zds, &zout, &cs->zin)))
+				return -1;
+			if (inputEnded && zout.pos == before)
+				break;
+		}
+		return zout.pos;
+	}
+#endif
+
+	return -1;
+}
+
+
+/**
+ * Producer thread: keep both buffers full until we run out of
+ * data or the stream is closed
+ */
+static void *
+producerMain_(void *arg)
+{
+	CIStream *cs = (CIStream *) arg;
+	int fillIndex = 0;
+	ssize_t n;
+
+	for (;;) {
+		pthread_mutex_lock(&cs->lock);
+		while (cs->full[fillIndex] && ! cs->stopRequested)
+			pthread_cond_wait(&cs->changed, &cs->lock);
+		if (cs->stopRequested) {
+			pthread_mutex_unlock(&cs->lock);
+			break;
+		}
+		pthread_mutex_unlock(&cs->lock);
+
+		/** do the expensive part without holding the lock */
+		n = decompressInto_(cs, cs->buffer[fillIndex], CI_BUFFER_SIZE);
+
+		/** a zero or negative length marks the end of the stream */
+		pthread_mutex_lock(&cs->lock);
+		cs->length[fillIndex] = n;
+		cs->full[fillIndex] = 1;
+		pthread_cond_broadcast(&cs->changed);
+		pthread_mutex_unlock(&cs->lock);
+
+		if (n <= 0)
+			break;
+		fillIndex = 1 - fillIndex;
+	}
+
+	return NULL;
+}
+
+
+/** fopencookie read hook: hand out data from the current full buffer */
+static ssize_t
+cookieRead_(void *cookie, char *buf, size_t size)
+{
+	CIStream *cs = (CIStream *) cookie;
+	int d = cs->drainIndex;
+	ssize_t nCopy;
+
+	pthread_mutex_lock(&cs->lock);
+	while ( ! cs->full[d])
+		pthread_cond_wait(&cs->changed, &cs->lock);
+	pthread_mutex_unlock(&cs->lock);
+
+	if (cs->length[d] < 0) {
+		errno = EIO;
+		return -1;
+	}
+	if (cs->length[d] == 0)
+		return 0;
+
+	nCopy = cs->length[d] - cs->drainPos;
+	if (nCopy > (ssize_t) size)
+		nCopy = size;
+	memcpy(buf, cs->buffer[d] + cs->drainPos, nCopy);
+	cs->drainPos += nCopy;
+
+	/** give the buffer back to the producer once it is drained */
+	if (cs->drainPos == cs->length[d]) {
+		pthread_mutex_lock(&cs->lock);
+		cs->full[d] = 0;
+		pthread_cond_broadcast(&cs->changed);
+		pthread_mutex_unlock(&cs->lock);
+		cs->drainIndex = 1 - d;
+		cs->drainPos = 0;
+	}
+
+	return nCopy;
+}
+
+
+/** fopencookie close hook: stop the producer and release everything */
+static int
+cookieClose_(void *cookie)
+{
+	CIStream *cs = (CIStream *) cookie;
+
+	pthread_mutex_lock(&cs->lock);
+	cs->stopRequested = 1;
+	pthread_cond_broadcast(&cs->changed);
+	pthread_mutex_unlock(&cs->lock);
+
+	pthread_join(cs->thread, NULL);
+
+	if (cs->gz != NULL)
+		gzclose(cs->gz); /* also closes cs->fd */
+#ifdef HAVE_ZSTD
+	if (cs->zds != NULL) {
+		ZSTD_freeDStream(cs->zds);
+		free(cs->zinBuffer);
+		close(cs->fd);
+	}
+#endif
+
+	pthread_mutex_destroy(&cs->lock);
+	pthread_cond_destroy(&cs->changed);
+	free(cs->buffer[0]);
+	free(cs->buffer[1]);
+	free(cs);
+
+	return 0;
+}
+
+
+static int
+formatFromMagic_(const unsigned char *magic, size_t nMagic)
+{
+	if (nMagic >= sizeof(gzipMagic_)
+			&& memcmp(magic, gzipMagic_, sizeof(gzipMagic_)) == 0)
+		return CI_FORMAT_GZIP;
+	if (nMagic >= sizeof(zstdMagic_)
+			&& memcmp(magic, zstdMagic_, sizeof(zstdMagic_)) == 0)
+		return CI_FORMAT_ZSTD;
+	return CI_FORMAT_PLAIN;
+}
+
+
+int
+ciDetectFormat(const char *filename)
+{
+	unsigned char magic[4];
+	size_t nMagic;
+	FILE *fp;
+
+	fp = fopen(filename, "r");
+	if (fp == NULL)
+		return -1;
+	nMagic = fread(magic, 1, sizeof(magic), fp);
+	fclose(fp);
+
+	return formatFromMagic_(magic, nMagic);
+}
+
+
+const char *
+ciFormatName(int format)
+{
+	switch (format) {
+	case CI_FORMAT_PLAIN: return "plain";
+	case CI_FORMAT_GZIP:  return "gzip";
+	case CI_FORMAT_ZSTD:  return "zstd";
+	}
+	return "unknown";
+}
+
+
+FILE *
+ciOpen(const char *filename)
+{
+	cookie_io_functions_t hooks = { cookieRead_, NULL, NULL, cookieClose_ };
+	CIStream *cs;
+	FILE *fp;
+	int format;
+
+	format = ciDetectFormat(filename);
+	if (format < 0)
+		return NULL; /* errno is set by fopen() */
+
+	if (format == CI_FORMAT_PLAIN)
+		return fopen(filename, "r");
+
+#ifndef HAVE_ZSTD
+	if (format == CI_FORMAT_ZSTD) {
+		fprintf(stderr, "Error: '%s' is zstd compressed, but zstd support"
+				" was not built in\n", filename);
+		errno = ENOTSUP;
+		return NULL;
+	}
+#endif
+
+	cs = (CIStream *) calloc(1, sizeof(CIStream));
+	cs->format = format;
+	cs->fd = open(filename, O_RDONLY);
+	if (cs->fd < 0) {
+		free(cs);
+		return NULL;
+	}
+
+	if (format == CI_FORMAT_GZIP) {
+		cs->gz = gzdopen(cs->fd, "rb");
+		if (cs->gz == NULL) {
+			close(cs->fd);
+			free(cs);
+			errno = ENOMEM;
+			return NULL;
+		}
+		gzbuffer(cs->gz, CI_BUFFER_SIZE);
+	}
+#ifdef HAVE_ZSTD
+	if (format == CI_FORMAT_ZSTD) {
+		cs->zds = ZSTD_createDStream();
+		ZSTD_initDStream(cs->zds);
+		cs->zinBufferSize = ZSTD_DStreamInSize();
+		cs->zinBuffer = (char *) malloc(cs->zinBufferSize);
+	}
+#endif
+
+	cs->buffer[0] = (char *) malloc(CI_BUFFER_SIZE);
+	cs->buffer[1] = (char *) malloc(CI_BUFFER_SIZE);
+	pthread_mutex_init(&cs->lock, NULL);
+	pthread_cond_init(&cs->changed, NULL);
+
+	if (pthread_create(&cs->thread, NULL, producerMain_, cs) != 0) {
+		fprintf(stderr, "Error: cannot start decompression thread for '%s'\n",
+				filename);
+		/** nothing to join, so tidy up by hand */
+		if (cs->gz != NULL)
+			gzclose(cs->gz);
+#ifdef HAVE_ZSTD
+		if (cs->zds != NULL) {
+			ZSTD_freeDStream(cs->zds);
+			free(cs->zinBuffer);
+			close(cs->fd);
+		}
+#endif
+		pthread_mutex_destroy(&cs->lock);
+		pthread_cond_destroy(&cs->changed);
+		free(cs->buffer[0]);
+		free(cs->buffer[1]);
+		free(cs);
+		errno = EAGAIN;
+		return NULL;
+	}
+
+	fp = fopencookie(cs, "r", hooks);
+	if (fp == NULL)
+		cookieClose_(cs);
+
+	return fp;
+}
@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+
+#include "inverted_index.h"
+#include "compressed_input.h"
+#include "util.h"
+
+// define the maximum length of word we will look for
+#define	MAX_WORD_LEN	24
+
+// the longest phrase that may be asked for
+#define	MAX_QUERY_WORDS	64
+
+
+/**
+ * Read all of filename (which may be compressed) into memory, so the
+ * context of each hit can be printed, setting its length in *size.
+ */
+static char *
+loadText(char *filename, size_t *size)
+{
+	FILE *fp;
+	char *text = NULL;
+	size_t allocated = 0, nRead;
+
+	if ((fp = ciOpen(filename)) == NULL) {
+		fprintf(stderr, "Failure opening %s : %s\n",
+				filename, strerror(errno));
+		return NULL;
+	}
+
+	*size = 0;
+	do {
+		if (*size == allocated) {
+			allocated = (allocated == 0) ? 64 * 1024 : allocated * 2;
+			text = (char *) realloc(text, allocated);
+			if (text == NULL) {
+				fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+				exit(1);
+			}
+		}
+		nRead = fread(text + *size, 1, allocated - *size, fp);
+		*size += nRead;
+	} while (nRead > 0);
+
+	fclose(fp);
+	return text;
+}
+
+
+/** whether c can continue a word, as the extractor sees it */
+static int
+isWordChar(char c)
+{
+	return isalpha((unsigned char) c) || c == '-' || c == '_' || c == '\'';
+}
+
+
+/**
+ * Split query into words the way the word extractor would, writing
+ * them into words (which the split words point into).  As in the
+ * extractor, only the first MAX_WORD_LEN letters of a word are kept.
+ *
+ * Returns the number of words, or -1 if there are more than
+ * MAX_QUERY_WORDS of them
+ */
+static int
+splitQuery(char *query, char **words)
+{
+	int nWords = 0, len;
+	char *p = query;
+
+	while (*p != '\0') {
+		while (*p != '\0' && ! isalpha((unsigned char) *p))
+			p++;
+		if (*p == '\0')
+			break;
+		if (nWords == MAX_QUERY_WORDS)
+			return -1;
+		words[nWords++] = p;
+		for (len = 0; isWordChar(*p); len++) {
+			if (len == MAX_WORD_LEN)
+				*p = '\0';
+			p++;
+		}
+		if (*p != '\0')
+			*p++ = '\0';
+	}
+	return nWords;
+}
+
+
+/** print width bytes of text from start, padded, flattening newlines */
+static void
+printContext(const char *text, size_t textSize, long start, long end,
+		int width, int padLeft)
+{
+	long i;
+
+	for (i = end - start; padLeft && i < width; i++)
+		putchar(' ');
+	for (i = start; i < end; i++) {
+		if (i < 0 || (size_t) i >= textSize)
+			continue;
+		putchar(isspace((unsigned char) text[i]) ? ' ' : text[i]);
+	}
+}
+
+
+/** print the hits of query as a keyword in context listing */
+static void
+printConcordance(const char *query, IndexHit *hits, long nHits,
+		const char *text, size_t textSize, int width, int nShow)
+{
+	long i, left, end;
+
+	printf("'%s' : %ld hits\n", query, nHits);
+	for (i = 0; i < nHits && (nShow < 0 || i < nShow); i++) {
+		left = (long) hits[i].offset - width;
+		if (left < 0)
+			left = 0;
+		/** the index holds only the first MAX_WORD_LEN letters of a word */
+		end = (long) hits[i].endOffset;
+		while ((size_t) end < textSize && isWordChar(text[end]))
+			end++;
+		printf("%6u:%-8lu ", hits[i].line, (unsigned long) hits[i].offset);
+		printContext(text, textSize, left, (long) hits[i].offset, width, 1);
+		printf("[");
+		printContext(text, textSize, (long) hits[i].offset, end, width, 0);
+		printf("]");
+		printContext(text, textSize, end, end + width, width, 0);
+		printf("\n");
+	}
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> <query> [ <query> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Lists every place each query word or phrase occurs in <file>,\n");
+	fprintf(stderr, "with the text around it, using the index kept in <file>.idx\n");
+	fprintf(stderr, "(which is built if it is missing or out of date).\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-c <WIDTH> : bytes of context either side of a hit (default 30).\n");
+	fprintf(stderr, "-n <N>     : list at most <N> hits per query (default all).\n");
+	fprintf(stderr, "-r         : rebuild the index even if it is up to date.\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	InvertedIndex index;
+	IndexHit *hits;
+	struct timespec startTime;
+	char *words[MAX_QUERY_WORDS], *query, *text, *indexName, *filename;
+	size_t textSize;
+	long nHits;
+	int i, nWords, width = 30, nShow = -1, rebuild = 0, status = 0;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (argv[i][1] == 'r') {
+			rebuild = 1;
+		} else if (argv[i][1] == 'c' && i + 1 < argc) {
+			width = atoi(argv[++i]);
+			if (width < 0)
+				width = 0;
+		} else if (argv[i][1] == 'n' && i + 1 < argc) {
+			nShow = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "Error: unknown option '%s'\n", argv[i]);
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (i >= argc) {
+		fprintf(stderr, "No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+	filename = argv[i++];
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	indexName = idxFileName(filename);
+	memset(&index, 0, sizeof(index));
+	if ( ! rebuild && idxLoad(&index, indexName, filename)
+			&& index.header->maxLen != MAX_WORD_LEN)
+		idxFree(&index);
+	if (index.header == NULL) {
+		if ( ! idxBuild(&index, filename, MAX_WORD_LEN)) {
+			fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+					filename);
+			free(indexName);
+			return 1;
+		}
+		if ( ! idxWrite(&index, indexName, filename))
+			fprintf(stderr, "Warning: could not save the index of '%s'"
+					" as '%s'\n", filename, indexName);
+		printf("Indexed '%s' in %lf seconds\n", filename,
+				secondsSince(&startTime));
+	}
+	free(indexName);
+	printf("%lu words, %u distinct, %lu byte index\n",
+			(unsigned long) index.header->nTokens, index.header->nTerms,
+			(unsigned long) index.header->imageSize);
+
+	if ((text = loadText(filename, &textSize)) == NULL) {
+		idxFree(&index);
+		return 1;
+	}
+
+	for (; i < argc; i++) {
+		query = strdup(argv[i]);
+		if (query == NULL) {
+			fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+			exit(1);
+		}
+		nWords = splitQuery(query, words);
+		if (nWords < 0) {
+			fprintf(stderr, "Error: query '%s' has more than %d words\n",
+					argv[i], MAX_QUERY_WORDS);
+			free(query);
+			status = 1;
+			continue;
+		}
+		nHits = idxFindPhrase(&index, words, nWords, &hits);
+		printConcordance(argv[i], hits, nHits, text, textSize, width, nShow);
+		free(hits);
+		free(query);
+	}
+
+	free(text);
+	idxFree(&index);
+	return status;
+}
@@ -0,0 +1,480 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "frozen_dict.h"
+#include "hash64.h"
+#include "util.h"
+
+#define	FROZEN_DICT_CACHE_LINE	64
+
+/** seeds tried before giving up on placing the words */
+#define	FROZEN_DICT_MAX_SEEDS	32
+
+#define	FROZEN_DICT_CHECKSUM_SEED	0
+
+/** the working state of fdFreeze() */
+typedef struct FreezeWork {
+	LLNode **nodes;
+	uint64_t *hashes;
+	uint32_t *order;		/* node indices grouped by bucket */
+	uint32_t *bucketStart;	/* [nBuckets + 1] into order */
+	uint32_t *bucketsBySize;
+	uint32_t *pilots;
+	uint32_t *positions;	/* the slots being tried for one bucket */
+	unsigned char *taken;	/* [nPlaces] */
+	uint32_t nKeys;
+	uint32_t nPlaces;
+	uint32_t nBuckets;
+	uint32_t maxBucketSize;
+} FreezeWork;
+
+
+/** scale x, taken as a fraction of 2^32, onto 0..n-1 */
+static inline uint32_t
+reduce_(uint32_t x, uint32_t n)
+{
+	return (uint32_t) (((uint64_t) x * n) >> 32);
+}
+
+
+/** spread the bits of pilot over a 64-bit word */
+static inline uint64_t
+mixPilot_(uint32_t pilot)
+{
+	uint64_t z = pilot + 0x9E3779B97F4A7C15ULL;
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+
+/** the bucket comes from the high half of the hash */
+static inline uint32_t
+bucketOf_(uint64_t hash, uint32_t nBuckets)
+{
+	return reduce_((uint32_t) (hash >> 32), nBuckets);
+}
+
+
+/**
+ * The multiply carries every bit of the hash and pilot up into the
+ * half kept, so that each pilot moves the words of a bucket to
+ * unrelated places rather than all by the same amount
+ */
+static inline uint32_t
+placeOf_(uint64_t hash, uint32_t pilot, uint32_t nPlaces)
+{
+	return reduce_((uint32_t) (((hash ^ mixPilot_(pilot))
+			* 0x9E3779B97F4A7C15ULL) >> 32), nPlaces);
+}
+
+
+/** hash every key with seed and group the keys by bucket */
+static void
+groupBuckets_(FreezeWork *work, uint64_t seed)
+{
+	uint32_t i, b, *sizeStart, *fill;
+	const char *key;
+
+	memset(work->bucketStart, 0, (work->nBuckets + 1) * sizeof(uint32_t));
+	for (i = 0; i < work->nKeys; i++) {
+		key = work->nodes[i]->key;
+		work->hashes[i] = hash64(key, strlen(key), seed);
+		work->bucketStart[bucketOf_(work->hashes[i], work->nBuckets) + 1]++;
+	}
+
+	work->maxBucketSize = 0;
+	for (b = 0; b < work->nBuckets; b++) {
+		if (work->bucketStart[b + 1] > work->maxBucketSize)
+			work->maxBucketSize = work->bucketStart[b + 1];
+		work->bucketStart[b + 1] += work->bucketStart[b];
+	}
+
+	fill = (uint32_t *) reallocOrDie(NULL, work->nBuckets * sizeof(uint32_t));
+	memcpy(fill, work->bucketStart, work->nBuckets * sizeof(uint32_t));
+	for (i = 0; i < work->nKeys; i++)
+		work->order[fill[bucketOf_(work->hashes[i], work->nBuckets)]++] = i;
+	free(fill);
+
+	/** largest buckets first, while the slots are still mostly free */
+	sizeStart = (uint32_t *) reallocOrDie(NULL, (work->maxBucketSize + 2)
+			* sizeof(uint32_t));
+	memset(sizeStart, 0, (work->maxBucketSize + 2) * sizeof(uint32_t));
+	for (b = 0; b < work->nBuckets; b++)
+		sizeStart[work->maxBucketSize
+				- (work->bucketStart[b + 1] - work->bucketStart[b]) + 1]++;
+	for (i = 0; i <= work->maxBucketSize; i++)
+		sizeStart[i + 1] += sizeStart[i];
+	for (b = 0; b < work->nBuckets; b++)
+		work->bucketsBySize[sizeStart[work->maxBucketSize
+				- (work->bucketStart[b + 1] - work->bucketStart[b])]++] = b;
+	free(sizeStart);
+}
+
+
+/** try pilot for bucket b, filling in positions; 1 if every place is free */
+static int
+tryPilot_(FreezeWork *work, uint32_t b, uint32_t pilot)
+{
+	uint32_t j, q, place;
+
+	for (j = work->bucketStart[b]; j < work->bucketStart[b + 1]; j++) {
+		place = placeOf_(work->hashes[work->order[j]], pilot, work->nPlaces);
+		if (work->taken[place])
+			return 0;
+		for (q = 0; q < j - work->bucketStart[b]; q++)
+			if (work->positions[q] == place)
+				return 0;
+		work->positions[j - work->bucketStart[b]] = place;
+	}
+	return 1;
+}
+
+
+/**
+ * Find a pilot for every bucket, largest buckets first.  Returns 0 if
+ * some bucket cannot be placed, which calls for another seed
+ */
+static int
+placeBuckets_(FreezeWork *work)
+{
+	uint64_t pilot, maxPilot;
+	uint32_t i, j, b, size;
+
+	maxPilot = (uint64_t) work->nPlaces * 16 + 1024;
+	if (maxPilot > UINT32_MAX)
+		maxPilot = UINT32_MAX;
+
+	memset(work->taken, 0, work->nPlaces);
+	for (i = 0; i < work->nBuckets; i++) {
+		b = work->bucketsBySize[i];
+		size = work->bucketStart[b + 1] - work->bucketStart[b];
+		if (size == 0)
+			break;
+
+		for (pilot = 0; pilot < maxPilot; pilot++)
+			if (tryPilot_(work, b, (uint32_t) pilot))
+				break;
+		if (pilot == maxPilot)
+			return 0;
+
+		work->pilots[b] = (uint32_t) pilot;
+		for (j = 0; j < size; j++)
+			work->taken[work->positions[j]] = 1;
+	}
+	return 1;
+}
+
+
+/** lay out the image for the placed keys */
+static void
+buildImage_(FrozenDict *dict, FreezeWork *work, uint64_t seed,
+		size_t maxKeyLength)
+{
+	FrozenDictHeader *header;
+	unsigned char *image, *slot;
+	uint32_t *remap;
+	size_t slotSize, slotsOffset, imageSize;
+	uint32_t i, place, hole, value;
+	const char *key;
+
+	slotSize = (sizeof(uint32_t) + maxKeyLength + 1 + 7) & ~(size_t) 7;
+	slotsOffset = (sizeof(FrozenDictHeader)
+			+ (work->nBuckets + work->nPlaces - work->nKeys) * sizeof(uint32_t)
+			+ FROZEN_DICT_CACHE_LINE - 1)
+			& ~(size_t) (FROZEN_DICT_CACHE_LINE - 1);
+	imageSize = slotsOffset + (size_t) work->nKeys * slotSize;
+
+	image = (unsigned char *) aligned_alloc(FROZEN_DICT_CACHE_LINE,
+			(imageSize + FROZEN_DICT_CACHE_LINE - 1)
+				& ~(size_t) (FROZEN_DICT_CACHE_LINE - 1));
+	if (image == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	memset(image, 0, imageSize);
+
+	header = (FrozenDictHeader *) image;
+	memcpy(header->magic, FROZEN_DICT_MAGIC, sizeof(header->magic));
+	header->byteOrder = FROZEN_DICT_BYTE_ORDER;
+	header->headerSize = sizeof(FrozenDictHeader);
+	header->seed = seed;
+	header->nKeys = work->nKeys;
+	header->nPlaces = work->nPlaces;
+	header->nBuckets = work->nBuckets;
+	header->slotSize = (uint32_t) slotSize;
+	header->slotsOffset = (uint32_t) slotsOffset;
+	header->imageSize = imageSize;
+	memcpy(image + header->headerSize, work->pilots,
+			work->nBuckets * sizeof(uint32_t));
+
+	/** each place taken beyond the slots is sent down to an empty slot */
+	remap = (uint32_t *) (image + header->headerSize
+			+ work->nBuckets * sizeof(uint32_t));
+	hole = 0;
+	for (place = work->nKeys; place < work->nPlaces; place++) {
+		if ( ! work->taken[place])
+			continue;
+		while (work->taken[hole])
+			hole++;
+		remap[place - work->nKeys] = hole++;
+	}
+
+	for (i = 0; i < work->nKeys; i++) {
+		key = work->nodes[i]->key;
+		value = (uint32_t) work->nodes[i]->value;
+		place = placeOf_(work->hashes[i],
+				work->pilots[bucketOf_(work->hashes[i], work->nBuckets)],
+				work->nPlaces);
+		if (place >= work->nKeys)
+			place = remap[place - work->nKeys];
+		slot = image + slotsOffset + (size_t) place * slotSize;
+		memcpy(slot, &value, sizeof(value));
+		memcpy(slot + sizeof(value), key, strlen(key) + 1);
+	}
+
+	header->checksum = hash64(image + header->headerSize,
+			imageSize - header->headerSize, FROZEN_DICT_CHECKSUM_SEED);
+
+	dict->header = header;
+	dict->pilots = (const uint32_t *) (image + header->headerSize);
+	dict->remap = remap;
+	dict->slots = image + slotsOffset;
+	dict->maxKeyLength = slotSize - sizeof(uint32_t) - 1;
+	dict->mapped = 0;
+}
+
+
+int
+fdFreeze(FrozenDict *dict, LLNode **wordLists, int maxLen)
+{
+	FreezeWork work;
+	LLNode *node;
+	size_t length, maxKeyLength = 0, nNodes = 0;
+	uint64_t seed = 0;
+	int i, attempt, placed = 0;
+
+	for (i = 0; i <= maxLen; i++)
+		for (node = wordLists[i]; node != NULL; node = node->next)
+			nNodes++;
+	if (nNodes >= UINT32_MAX - UINT32_MAX / FROZEN_DICT_SPARE_RATIO - 1)
+		return 0;
+
+	memset(&work, 0, sizeof(work));
+	work.nKeys = (uint32_t) nNodes;
+	work.nPlaces = work.nKeys + work.nKeys / FROZEN_DICT_SPARE_RATIO + 1;
+	work.nBuckets = work.nKeys / FROZEN_DICT_BUCKET_KEYS + 1;
+	work.nodes = (LLNode **) reallocOrDie(NULL,
+			(nNodes + 1) * sizeof(LLNode *));
+	work.hashes = (uint64_t *) reallocOrDie(NULL,
+			(nNodes + 1) * sizeof(uint64_t));
+	work.order = (uint32_t *) reallocOrDie(NULL,
+			(nNodes + 1) * sizeof(uint32_t));
+	work.positions = (uint32_t *) reallocOrDie(NULL,
+			(nNodes + 1) * sizeof(uint32_t));
+	work.taken = (unsigned char *) reallocOrDie(NULL, work.nPlaces);
+	work.bucketStart = (uint32_t *) reallocOrDie(NULL, (work.nBuckets + 1)
+			* sizeof(uint32_t));
+	work.bucketsBySize = (uint32_t *) reallocOrDie(NULL, work.nBuckets
+			* sizeof(uint32_t));
+	work.pilots = (uint32_t *) reallocOrDie(NULL,
+			work.nBuckets * sizeof(uint32_t));
+	memset(work.pilots, 0, work.nBuckets * sizeof(uint32_t));
+
+	nNodes = 0;
+	for (i = 0; i <= maxLen; i++) {
+		for (node = wordLists[i]; node != NULL; node = node->next) {
+			work.nodes[nNodes++] = node;
+			length = strlen(node->key);
+			if (length > maxKeyLength)
+				maxKeyLength = length;
+		}
+	}
+
+	for (attempt = 0; attempt < FROZEN_DICT_MAX_SEEDS && !placed; attempt++) {
+		seed = mixPilot_((uint32_t) attempt);
+		groupBuckets_(&work, seed);
+		placed = placeBuckets_(&work);
+	}
+	if (placed)
+		buildImage_(dict, &work, seed, maxKeyLength);
+
+	free(work.nodes);
+	free(work.hashes);
+	free(work.order);
+	free(work.positions);
+	free(work.taken);
+	free(work.bucketStart);
+	free(work.bucketsBySize);
+	free(work.pilots);
+	return placed;
+}
+
+
+int
+fdLookup(const FrozenDict *dict, const char *word)
+{
+	const FrozenDictHeader *header = dict->header;
+	const unsigned char *slot;
+	uint64_t hash;
+	uint32_t place, count;
+	size_t length;
+
+	length = strlen(word);
+	if (header->nKeys == 0 || length > dict->maxKeyLength)
+		return 0;
+
+	hash = hash64(word, length, header->seed);
+	place = placeOf_(hash, dict->pilots[bucketOf_(hash, header->nBuckets)],
+			header->nPlaces);
+	if (place >= header->nKeys)
+		place = dict->remap[place - header->nKeys];
+	slot = dict->slots + (size_t) place * header->slotSize;
+	if (memcmp(slot + sizeof(count), word, length + 1) != 0)
+		return 0;
+
+	memcpy(&count, slot, sizeof(count));
+	return (int) count;
+}
+
+
+uint32_t
+fdSize(const FrozenDict *dict)
+{
+	return dict->header->nKeys;
+}
+
+
+size_t
+fdImageSize(const FrozenDict *dict)
+{
+	return (size_t) dict->header->imageSize;
+}
+
+
+char *
+fdFileName(const char *sourceName)
+{
+	char *fileName;
+
+	fileName = (char *) reallocOrDie(NULL, strlen(sourceName)
+			+ strlen(FROZEN_DICT_SUFFIX) + 1);
+	strcpy(fileName, sourceName);
+	strcat(fileName, FROZEN_DICT_SUFFIX);
+	return fileName;
+}
+
+
+int
+fdWrite(const FrozenDict *dict, const char *filename)
+{
+	char *tmpName;
+	FILE *ofp;
+	size_t imageSize = fdImageSize(dict);
+
+	if ((ofp = tempFileOpen(filename, "wb", &tmpName)) == NULL)
+		return 0;
+	return tempFileCommit(ofp, tmpName, filename,
+			fwrite(dict->header, 1, imageSize, ofp) == imageSize);
+}
+
+
+/** check that the mapped image is intact */
+static int
+validateImage_(const char *filename, const unsigned char *address,
+		size_t fileSize)
+{
+	FrozenDictHeader header;
+
+	if (fileSize < sizeof(FrozenDictHeader)) {
+		fprintf(stderr, "Warning: dictionary '%s' is truncated\n", filename);
+		return 0;
+	}
+	memcpy(&header, address, sizeof(header));
+	if (memcmp(header.magic, FROZEN_DICT_MAGIC, sizeof(header.magic)) != 0
+			|| header.byteOrder != FROZEN_DICT_BYTE_ORDER
+			|| header.headerSize != sizeof(FrozenDictHeader)) {
+		fprintf(stderr, "Warning: '%s' is not a dictionary for this"
+				" machine\n", filename);
+		return 0;
+	}
+
+	if (header.imageSize != fileSize || header.nBuckets == 0
+			|| header.nPlaces <= header.nKeys
+			|| header.slotSize <= sizeof(uint32_t)
+			|| header.slotsOffset < header.headerSize
+				+ ((uint64_t) header.nBuckets + header.nPlaces
+					- header.nKeys) * sizeof(uint32_t)
+			|| header.slotsOffset % FROZEN_DICT_CACHE_LINE != 0
+			|| header.slotsOffset + (uint64_t) header.nKeys
+				* header.slotSize != fileSize) {
+		fprintf(stderr, "Warning: dictionary '%s' is truncated\n", filename);
+		return 0;
+	}
+	if (hash64(address + header.headerSize, fileSize - header.headerSize,
+			FROZEN_DICT_CHECKSUM_SEED) != header.checksum) {
+		fprintf(stderr, "Warning: dictionary '%s' fails its checksum\n",
+				filename);
+		return 0;
+	}
+	return 1;
+}
+
+
+int
+fdLoad(FrozenDict *dict, const char *filename)
+{
+	unsigned char *address;
+	struct stat sb;
+	int fd;
+
+	if ((fd = open(filename, O_RDONLY)) < 0) {
+		fprintf(stderr, "Failure opening %s : %s\n",
+				filename, strerror(errno));
+		return 0;
+	}
+	if (fstat(fd, &sb) < 0 || sb.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+
+	address = (unsigned char *) mmap(NULL, sb.st_size, PROT_READ,
+			MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (address == MAP_FAILED)
+		return 0;
+
+	if ( ! validateImage_(filename, address, sb.st_size)) {
+		munmap(address, sb.st_size);
+		return 0;
+	}
+
+	dict->header = (FrozenDictHeader *) address;
+	dict->pilots = (const uint32_t *) (address + dict->header->headerSize);
+	dict->remap = dict->pilots + dict->header->nBuckets;
+	dict->slots = address + dict->header->slotsOffset;
+	dict->maxKeyLength = dict->header->slotSize - sizeof(uint32_t) - 1;
+	dict->mapped = 1;
+	return 1;
+}
+
+
+void
+fdFree(FrozenDict *dict)
+{
+	if (dict->header == NULL)
+		return;
+
+	if (dict->mapped)
+		munmap(dict->header, dict->header->imageSize);
+	else
+		free(dict->header);
+	memset(dict, 0, sizeof(*dict));
+}
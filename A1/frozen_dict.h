@@ -0,0 +1,113 @@
+#ifndef	__FROZEN_DICT_HEADER__
+#define	__FROZEN_DICT_HEADER__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "LLNode.h"
+
+/**
+ * A read-only "frozen" vocabulary built from a finished tally.
+ *
+ * The words are placed with a minimal perfect hash (the CHD
+ * "hash and displace" scheme, as refined by PTHash): each word's hash
+ * picks a bucket of about FROZEN_DICT_BUCKET_KEYS words, and every
+ * bucket has a pilot value, found when freezing, that scatters its
+ * words onto places no other bucket uses.  There are a few percent
+ * more places than words, which keeps the search for the last pilots
+ * short; the few words placed beyond the first nKeys are then moved
+ * down into the slots left empty, through a small remap table.  So
+ * there are exactly nKeys slots and no probing, and a lookup reads one
+ * pilot and then one slot (with a remap entry in between for the few
+ * moved words).
+ *
+ * Each slot holds a word's count followed by the word itself, padded
+ * to a fixed size, so checking the word and fetching its count are
+ * both done within the slot.  The whole dictionary is one block:
+ *
+ *     header    FrozenDictHeader
+ *     pilots    uint32_t [nBuckets]
+ *     remap     uint32_t [nPlaces - nKeys]
+ *     slots     slotSize bytes [nKeys]  starting on a cache line
+ *
+ * which is written to a file as it stands and mapped back in by
+ * fdLoad().  Files are written in the byte order of the machine
+ * writing them, and are rejected by a machine of the other order.
+ */
+
+#define	FROZEN_DICT_SUFFIX		".vocab"
+#define	FROZEN_DICT_MAGIC		"VOCAB001"
+#define	FROZEN_DICT_BYTE_ORDER	0x01020304
+
+/** the average number of words sharing a bucket (and a pilot) */
+#define	FROZEN_DICT_BUCKET_KEYS	4
+
+/** one extra place is made for every this many words */
+#define	FROZEN_DICT_SPARE_RATIO	32
+
+typedef struct FrozenDictHeader {
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t headerSize;
+	uint64_t seed;
+	uint32_t nKeys;
+	uint32_t nPlaces;
+	uint32_t nBuckets;
+	uint32_t slotSize;
+	uint32_t slotsOffset;
+	uint32_t unused;
+	uint64_t imageSize;
+	uint64_t checksum;		/* hash64() of everything after the header */
+} FrozenDictHeader;
+
+typedef struct FrozenDict {
+	FrozenDictHeader *header;
+	const uint32_t *pilots;
+	const uint32_t *remap;
+	const unsigned char *slots;
+	size_t maxKeyLength;
+	int mapped;				/* the image is a file mapping */
+} FrozenDict;
+
+/**
+ * Build dict from the tallied words in wordLists[0..maxLen].  The
+ * lists are only read, and may be freed once this returns.
+ *
+ * Returns 1 on success, or 0 on failure
+ */
+int fdFreeze(FrozenDict *dict, LLNode **wordLists, int maxLen);
+
+/** the count of word, or 0 if it is not in dict */
+int fdLookup(const FrozenDict *dict, const char *word);
+
+/** the number of words held */
+uint32_t fdSize(const FrozenDict *dict);
+
+/** the size in bytes of the dictionary, as held and as written */
+size_t fdImageSize(const FrozenDict *dict);
+
+/**
+ * the name of the dictionary file kept for sourceName; free() it
+ * when done
+ */
+char *fdFileName(const char *sourceName);
+
+/**
+ * Write dict to filename, under a temporary name that is then
+ * renamed into place.
+ *
+ * Returns 1 on success, or 0 on failure
+ */
+int fdWrite(const FrozenDict *dict, const char *filename);
+
+/**
+ * Map the dictionary written to filename into dict.
+ *
+ * Returns 1 on success, or 0 if it cannot be read or is not intact
+ */
+int fdLoad(FrozenDict *dict, const char *filename);
+
+/** release dict */
+void fdFree(FrozenDict *dict);
+
+#endif /* __FROZEN_DICT_HEADER__ */
@@ -1,8 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "word_tally.h"
+#include "out_writer.h"
+#include "bucket_output.h"
+#include "key_sort.h"
+#include "frozen_dict.h"
+#include "token_stream.h"
 #include "LLNode.h"
 #include "word_extractor.h"
 
@@ -15,72 +21,133 @@ void deleteKey(LLNode *node, void *userdata) {
 
 /** Delete the contents of all of the word lists
  *
- * This function assumes that both the nodes and
- * the keys within the nodes have been allocated
- * using malloc() and need to be freed.
+ * This function assumes that the nodes have been allocated
+ * using malloc() and need to be freed, as do the keys
+ * within them if freeKeys is set (the keys of interned
+ * words belong to the intern table instead).
  */
-void deleteWordLists(LLNode **wordListHeads, int maxLen) {
+void deleteWordLists(LLNode **wordListHeads, int maxLen, int freeKeys) {
     int i;
 
-    for (i = 0; i < maxLen; i++) {
+    for (i = 0; i <= maxLen; i++) {
         if (wordListHeads[i] != NULL) {
-            llFree(wordListHeads[i], deleteKey, NULL);
+            llFree(wordListHeads[i], freeKeys ? deleteKey : NULL, NULL);
             wordListHeads[i] = NULL;
         }
     }
 }
 
-/** print out all of the data in a word list */
-int printData(char *filename, LLNode *wordListHeads[], int maxLen) {
-    LLNode *node;
-    int i;
+/**
+ * Set up a buffered writer on standard output, after sending out
+ * anything printf() has buffered so that the output stays in order
+ */
+static void startOutput(OutWriter *writer) {
+    fflush(stdout);
+    if (owInit(writer, STDOUT_FILENO, 0) < 0) {
+        fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+        exit(1);
+    }
+}
+
+/** format one length's list for printData() */
+static void formatDataBucket(OutWriter *writer, int length, LLNode *node) {
+    if (node == NULL) {
+        return;
+    }
 
-    printf("All word count data from file '%s':\n", filename);
+    owPuts(writer, "Length ");
+    owPutLong(writer, length);
+    owPuts(writer, ":\n");
+    while (node != NULL) {
+        owPuts(writer, "    '");
+        owPuts(writer, node->key);
+        owPuts(writer, "' ");
+        owPutLong(writer, node->value);
+        owPutc(writer, '\n');
+        node = node->next;
+    }
+}
+
+/** format the hapax legomena of one length's list for printHapax() */
+static void formatHapaxBucket(OutWriter *writer, int length, LLNode *node) {
+    while (node != NULL) {
+        if (node->value == 1) {
+            owPutc(writer, '\t');
+            owPuts(writer, node->key);
+            owPutc(writer, '\n');
+        }
+        node = node->next;
+    }
+}
+
+/**
+ * print out all of the data in a word list, formatting the lists
+ * for each length on nThreads threads
+ */
+int printData(char *filename, LLNode *wordListHeads[], int maxLen, int nThreads) {
+    OutWriter writer;
+    int status;
+
+    startOutput(&writer);
+    owPuts(&writer, "All word count data from file '");
+    owPuts(&writer, filename);
+    owPuts(&writer, "':\n");
 
     /**
      * For each length, if the list is not null, print out
      * the values in the list
      */
-    for (i = 0; i <= maxLen; i++) {
-        node = wordListHeads[i];
-        if (node != NULL) {
-            printf("Length %d:\n", i);
-            while (node != NULL) {
-                printf("    '%s' %d\n", node->key, node->value);
-                node = node->next;
-            }
-        }
-    }
-    return 1;
+    status = writeBuckets(&writer, wordListHeads, 0, maxLen,
+            formatDataBucket, nThreads);
+    return (owClose(&writer) == 0) && status;
 }
 
-/** TODO: print out only the hapax legomena in a word list */
-int printHapax(char *filename, LLNode *wordListHeads[], int maxLen, int hapaxLength) {
-    LLNode *currentRefNode;
+/** print out only the hapax legomena in a word list */
+int printHapax(char *filename, LLNode *wordListHeads[], int maxLen, int hapaxLength,
+        int nThreads) {
+    OutWriter writer;
+    int status = 1;
 
-    printf("Hapax from the file: %s\n", filename);
+    startOutput(&writer);
+    owPuts(&writer, "Hapax from the file: ");
+    owPuts(&writer, filename);
+    owPutc(&writer, '\n');
 
     if (hapaxLength == -1) {
-        for (int i = 0; i < maxLen; i++) {
-            currentRefNode = wordListHeads[i];
+        status = writeBuckets(&writer, wordListHeads, 0, maxLen,
+                formatHapaxBucket, nThreads);
+    } else if (hapaxLength >= 0 && hapaxLength <= maxLen) {
+        formatHapaxBucket(&writer, hapaxLength, wordListHeads[hapaxLength]);
+    }
+    return (owClose(&writer) == 0) && status;
+}
 
-            while (currentRefNode != NULL) {
-                if (currentRefNode->value == 1) {
-                    printf("\t%s\n", currentRefNode->key);
-                }
-                currentRefNode = currentRefNode->next; // case for no initial N value
-            }
-        }
+/**
+ * freeze the tallied words of filename into a minimal perfect hash
+ * dictionary, and write it alongside as filename.vocab
+ */
+int freezeVocabulary(char *filename, LLNode *wordListHeads[], int maxLen) {
+    FrozenDict dict;
+    char *dictName;
+    int status;
+
+    if (!fdFreeze(&dict, wordListHeads, maxLen)) {
+        fprintf(stderr, "Error: cannot build a dictionary for '%s'\n", filename);
+        return 0;
+    }
+
+    dictName = fdFileName(filename);
+    status = fdWrite(&dict, dictName);
+    if (status) {
+        printf("Froze %u words into '%s' (%lu bytes)\n", fdSize(&dict), dictName,
+                (unsigned long) fdImageSize(&dict));
     } else {
-        currentRefNode = wordListHeads[hapaxLength];
-        while (currentRefNode != NULL) {
-            if (currentRefNode->value == 1) {
-                printf("\t%s\n", currentRefNode->key);
-            }
-            currentRefNode = currentRefNode->next; // case for user-input N value
-        }
+        fprintf(stderr, "Error: cannot write dictionary '%s'\n", dictName);
     }
-    return 1;
+
+    free(dictName);
+    fdFree(&dict);
+    return status;
 }
 
 /* print out the command line help */
@@ -98,6 +165,16 @@ void usage() {
     fprintf(stderr, "-h     : this help.  You are looking at it.\n");
     fprintf(stderr, "-l <N> : only print hapax legomena of length <N>.\n");
     fprintf(stderr, "       : If no -l option is given, all hapax legomena are printed.\n");
+    fprintf(stderr, "-p <N> : tally with <N> threads, fed by a separate tokenizer thread.\n");
+    fprintf(stderr, "-j <N> : format the output for each word length on <N> threads.\n");
+    fprintf(stderr, "-s     : print the words of each length in alphabetical order.\n");
+    fprintf(stderr, "-F     : freeze each file's tally into a read-only dictionary,\n");
+    fprintf(stderr, "       : written as <datafile>.vocab (see vocabquery).\n");
+    fprintf(stderr, "-i     : keep one copy of each word for all files, tallying by word id.\n");
+    fprintf(stderr, "       : (-i cannot be combined with -p.)\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "A <datafile> ending in .tok is read as a token stream written by\n");
+    fprintf(stderr, "tokstream, which implies -i.\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Sample command line:\n");
     fprintf(stderr, "    hapax -l5 smalldata.txt");
@@ -120,12 +197,19 @@ void usage() {
 
 int main(int argc, char *argv[]) {
     int i, shouldPrintData = 0, didProcessing = 0, printHapaxLength = -1;
+    int nTallyThreads = 0, nOutputThreads = 1, sortOutput = 0, freeze = 0, status;
+    int intern = 0;
+    InternTable internTable;
+    IdTally idTally;
     // int strNum;
     //char *fileName;
 
     /** TODO: allocate an array of list heads of the required size */
     LLNode *LLHeadList[MAX_WORD_LEN + 1];
 
+    internInit(&internTable);
+    idTallyInit(&idTally);
+
     for (i = 1; i < argc; i++) {
         if (argv[i][0] == '-') {
 
@@ -144,6 +228,27 @@ int main(int argc, char *argv[]) {
                     i++;
                 }
 
+            } else if (strcmp(argv[i], "-p") == 0) { // Pipeline the tokenizer and the tally threads
+                if (i + 1 < argc) {
+                    nTallyThreads = atoi(argv[i + 1]);
+                    i++;
+                }
+
+            } else if (strcmp(argv[i], "-j") == 0) { // Format each length's output on its own thread
+                if (i + 1 < argc) {
+                    nOutputThreads = atoi(argv[i + 1]);
+                    i++;
+                }
+
+            } else if (strcmp(argv[i], "-s") == 0) { // Print each length's words in sorted order
+                sortOutput = 1;
+
+            } else if (strcmp(argv[i], "-F") == 0) { // Freeze each tally into a dictionary file
+                freeze = 1;
+
+            } else if (strcmp(argv[i], "-i") == 0) { // Intern words across all files, tallying by id
+                intern = 1;
+
             } else {
                 printf("Command: '%s' does not exist.\n", argv[i]);
                 exit(1);
@@ -157,27 +262,68 @@ int main(int argc, char *argv[]) {
             // Once you have set up your array of word lists, you
             // should be able to pass them into this function
 
-            if (tallyWordsInFile(argv[i], LLHeadList, MAX_WORD_LEN) == 0) {
+            // token streams are counted by id
+            if (tsIsStreamName(argv[i])) {
+                intern = 1;
+            }
+
+            if (intern && nTallyThreads > 0) {
+                fprintf(stderr, "Error: -p cannot be used with -i or token streams\n");
+                return 1;
+            }
+
+            if (tsIsStreamName(argv[i])) {
+                status = tallyTokenStream(argv[i], &internTable, &idTally, MAX_WORD_LEN);
+                if (status) {
+                    idTallyToWordLists(&idTally, &internTable, LLHeadList, MAX_WORD_LEN);
+                }
+            } else if (intern) {
+                status = tallyInternedWordsInFile(argv[i], &internTable, &idTally,
+                        MAX_WORD_LEN);
+                if (status) {
+                    idTallyToWordLists(&idTally, &internTable, LLHeadList, MAX_WORD_LEN);
+                }
+            } else if (nTallyThreads > 0) {
+                status = tallyWordsInFilePipelined(argv[i], LLHeadList,
+                        MAX_WORD_LEN, nTallyThreads);
+            } else {
+                status = tallyWordsInFile(argv[i], LLHeadList, MAX_WORD_LEN);
+            }
+            if (status == 0) {
                 fprintf(stderr, "Error: Processing '%s' failed -- exiting\n", argv[i]);
                 return 1;
             }
 
             printf("Tally loaded\n");
 
+            if (freeze && !freezeVocabulary(argv[i], LLHeadList, MAX_WORD_LEN)) {
+                return 1;
+            }
+
+            // put each length's list in alphabetical order for printing
+            if (sortOutput) {
+                int length;
+
+                for (length = 0; length <= MAX_WORD_LEN; length++) {
+                    LLHeadList[length] = keySortList(LLHeadList[length]);
+                }
+            }
+
             /**
              * conditionally print out all the words loaded, based
              * on the command line option
              */
             if (shouldPrintData) {
-                printData(argv[i], LLHeadList, MAX_WORD_LEN);
+                printData(argv[i], LLHeadList, MAX_WORD_LEN, nOutputThreads);
             }
 
             /** print out all the hapax legomena that we have found */
-            printHapax(argv[i], LLHeadList, MAX_WORD_LEN, printHapaxLength);
+            printHapax(argv[i], LLHeadList, MAX_WORD_LEN, printHapaxLength,
+                    nOutputThreads);
 
             // TODO: clean up any memory that we have allocated in this loop
             // MEMORY
-            llFree(*LLHeadList, deleteKey, NULL); // implement llFree function from node.h
+            deleteWordLists(LLHeadList, MAX_WORD_LEN, !intern); // free every length's list, not just the first
         }
     }
 
@@ -190,7 +336,14 @@ int main(int argc, char *argv[]) {
 
     // TODO: clean up any remaining memory that we have allocated
     // MEMORY
-    deleteWordLists(LLHeadList, MAX_WORD_LEN); // Call function to delete contents of the word lists and free memory
+    deleteWordLists(LLHeadList, MAX_WORD_LEN, !intern); // Call function to delete contents of the word lists and free memory
+
+    if (intern) {
+        printf("%u distinct words interned (%lu bytes)\n", internSize(&internTable),
+                (unsigned long) internTable.nBytes);
+    }
+    idTallyFree(&idTally);
+    internFree(&internTable);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "intern_table.h"
+#include "hash64.h"
+#include "util.h"
+
+#define	INTERN_INITIAL_SLOTS	1024
+#define	INTERN_BLOCK_SIZE		(64 * 1024)
+#define	INTERN_HASH_SEED		0
+
+struct InternBlock {
+	InternBlock *next;
+	size_t used;
+	size_t size;
+	char data[];
+};
+
+
+void
+internInit(InternTable *table)
+{
+	memset(table, 0, sizeof(*table));
+}
+
+
+/** the slot for hash, or the empty slot where it would go */
+static uint32_t
+findSlot_(const InternTable *table, const char *word, size_t length,
+		uint64_t hash)
+{
+	uint32_t mask = table->nSlots - 1, i, id;
+	uint64_t slot;
+
+	for (i = (uint32_t) hash & mask; ; i = (i + 1) & mask) {
+		slot = table->slots[i];
+		if (slot == 0)
+			return i;
+		if ((slot >> 32) == (hash >> 32)) {
+			id = (uint32_t) slot - 1;
+			if (table->lengths[id] == length
+					&& memcmp(table->strings[id], word, length) == 0)
+				return i;
+		}
+	}
+}
+
+
+/** double the slots, or create the first ones */
+static void
+growSlots_(InternTable *table)
+{
+	uint64_t *oldSlots = table->slots, hash;
+	uint32_t oldCount = table->nSlots, i, j, mask;
+
+	table->nSlots = (oldCount == 0) ? INTERN_INITIAL_SLOTS : oldCount * 2;
+	table->slots = (uint64_t *) calloc(table->nSlots, sizeof(uint64_t));
+	if (table->slots == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+
+	/** only the hash kept in each slot is needed to place it again */
+	mask = table->nSlots - 1;
+	for (i = 0; i < oldCount; i++) {
+		if (oldSlots[i] == 0)
+			continue;
+		hash = hash64(table->strings[(uint32_t) oldSlots[i] - 1],
+				table->lengths[(uint32_t) oldSlots[i] - 1], INTERN_HASH_SEED);
+		for (j = (uint32_t) hash & mask; table->slots[j] != 0;
+				j = (j + 1) & mask)
+			;
+		table->slots[j] = oldSlots[i];
+	}
+	free(oldSlots);
+}
+
+
+/** copy length bytes of word, and a NUL, into the blocks */
+static char *
+storeCopy_(InternTable *table, const char *word, size_t length)
+{
+	InternBlock *block = table->blocks;
+	size_t size;
+	char *copy;
+
+	if (block == NULL || block->used + length + 1 > block->size) {
+		size = (length + 1 > INTERN_BLOCK_SIZE) ? length + 1 : INTERN_BLOCK_SIZE;
+		block = (InternBlock *) reallocOrDie(NULL, sizeof(InternBlock) + size);
+		block->used = 0;
+		block->size = size;
+		block->next = table->blocks;
+		table->blocks = block;
+	}
+
+	copy = block->data + block->used;
+	memcpy(copy, word, length);
+	copy[length] = '\0';
+	block->used += length + 1;
+	table->nBytes += length + 1;
+	return copy;
+}
+
+
+uint32_t
+internWord(InternTable *table, const char *word)
+{
+	size_t length = strlen(word);
+	uint64_t hash;
+	uint32_t i, id;
+
+	/** keep the slots no more than half full */
+	if (2 * ((uint64_t) table->nStrings + 1) > table->nSlots)
+		growSlots_(table);
+
+	hash = hash64(word, length, INTERN_HASH_SEED);
+	i = findSlot_(table, word, length, hash);
+	if (table->slots[i] != 0)
+		return (uint32_t) table->slots[i] - 1;
+
+	if (table->nStrings == table->nAllocated) {
+		table->nAllocated = (table->nAllocated == 0)
+				? INTERN_INITIAL_SLOTS : table->nAllocated * 2;
+		table->strings = (char **) reallocOrDie(table->strings,
+				table->nAllocated * sizeof(char *));
+		table->lengths = (uint32_t *) reallocOrDie(table->lengths,
+				table->nAllocated * sizeof(uint32_t));
+	}
+
+	id = table->nStrings++;
+	table->strings[id] = storeCopy_(table, word, length);
+	table->lengths[id] = (uint32_t) length;
+	table->slots[i] = (hash & 0xFFFFFFFF00000000ULL) | ((uint64_t) id + 1);
+	return id;
+}
+
+
+uint32_t
+internFind(const InternTable *table, const char *word)
+{
+	size_t length = strlen(word);
+	uint64_t hash;
+	uint32_t i;
+
+	if (table->nStrings == 0)
+		return INTERN_NONE;
+
+	hash = hash64(word, length, INTERN_HASH_SEED);
+	i = findSlot_(table, word, length, hash);
+	if (table->slots[i] == 0)
+		return INTERN_NONE;
+	return (uint32_t) table->slots[i] - 1;
+}
+
+
+void
+internFree(InternTable *table)
+{
+	InternBlock *block, *next;
+
+	for (block = table->blocks; block != NULL; block = next) {
+		next = block->next;
+		free(block);
+	}
+	free(table->strings);
+	free(table->lengths);
+	free(table->slots);
+	internInit(table);
+}
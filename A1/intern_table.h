@@ -0,0 +1,63 @@
+#ifndef	__INTERN_TABLE_HEADER__
+#define	__INTERN_TABLE_HEADER__
+
+#include <stdint.h>
+
+/**
+ * A string interning table: every distinct word is stored once, and
+ * is given a small integer id, counting up from 0 in the order the
+ * words are first seen.  Ids never change while the table exists, so
+ * tallies can be kept as arrays indexed by id, and one table can be
+ * shared by every file of a run.
+ *
+ * The copies are packed one after another into large blocks rather
+ * than each being given its own allocation, and are found through an
+ * open-addressed hash table of ids that keeps part of each word's hash
+ * beside its id, so that most mismatches are rejected without looking
+ * at the word at all.
+ */
+
+#define	INTERN_NONE		UINT32_MAX
+
+typedef struct InternBlock InternBlock;
+
+typedef struct InternTable {
+	char **strings;			/* [nStrings], by id */
+	uint32_t *lengths;		/* [nStrings], by id */
+	uint32_t nStrings;
+	uint32_t nAllocated;
+
+	uint64_t *slots;		/* hash in the high half, id + 1 in the low */
+	uint32_t nSlots;		/* always a power of two */
+
+	InternBlock *blocks;
+	size_t nBytes;			/* the bytes held by the copies */
+} InternTable;
+
+/** set up an empty table */
+void internInit(InternTable *table);
+
+/** the id of word, adding a copy of it to the table if it is new */
+uint32_t internWord(InternTable *table, const char *word);
+
+/** the id of word, or INTERN_NONE if it has not been interned */
+uint32_t internFind(const InternTable *table, const char *word);
+
+/** the word with the given id */
+static inline const char *
+internString(const InternTable *table, uint32_t id)
+{
+	return table->strings[id];
+}
+
+/** the number of distinct words held */
+static inline uint32_t
+internSize(const InternTable *table)
+{
+	return table->nStrings;
+}
+
+/** release everything held by the table, leaving it empty */
+void internFree(InternTable *table);
+
+#endif /* __INTERN_TABLE_HEADER__ */
@@ -0,0 +1,613 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "inverted_index.h"
+#include "intern_table.h"
+#include "word_extractor.h"
+#include "hash64.h"
+#include "util.h"
+
+/** words are taken from the extractor this many at a time */
+#define	IDX_READ_WORDS			256
+
+#define	IDX_CHECKSUM_SEED		0
+
+/** a word and its intern id, for putting the terms in word order */
+typedef struct SortedWord {
+	const char *word;
+	uint32_t id;
+} SortedWord;
+
+/** a walk along the postings of one term */
+typedef struct TermCursor {
+	const InvertedIndex *index;
+	const IndexTerm *term;
+	long block;				/* the block decoded into hits, or -1 */
+	int nDecoded;
+	int at;					/* the current posting within hits */
+	IndexHit hits[IDX_BLOCK_POSTINGS];
+} TermCursor;
+
+
+char *
+idxFileName(const char *sourceName)
+{
+	char *indexName;
+
+	indexName = (char *) reallocOrDie(NULL, strlen(sourceName)
+			+ strlen(IDX_SUFFIX) + 1);
+	strcpy(indexName, sourceName);
+	strcat(indexName, IDX_SUFFIX);
+	return indexName;
+}
+
+
+static int
+compareWords_(const void *a, const void *b)
+{
+	return strcmp(((const SortedWord *) a)->word,
+			((const SortedWord *) b)->word);
+}
+
+
+/** the offset of each part of the image, given the sizes in the header */
+static void
+layout_(const IndexHeader *header, uint64_t *wordOffsets, uint64_t *terms,
+		uint64_t *blocks, uint64_t *data, uint64_t *text, uint64_t *end)
+{
+	*wordOffsets = header->headerSize;
+	*terms = *wordOffsets + (uint64_t) header->nTerms * sizeof(uint64_t);
+	*blocks = *terms + (uint64_t) header->nTerms * sizeof(IndexTerm);
+	*data = *blocks + header->nBlocks * sizeof(IndexBlock);
+	*text = *data + header->dataSize;
+	*end = *text + header->textSize;
+}
+
+
+/** point the parts of index into the image at address */
+static void
+attach_(InvertedIndex *index, char *address)
+{
+	uint64_t wordOffsets, terms, blocks, data, text, end;
+
+	index->header = (IndexHeader *) address;
+	layout_(index->header, &wordOffsets, &terms, &blocks, &data, &text, &end);
+	index->wordOffsets = (const uint64_t *) (address + wordOffsets);
+	index->terms = (const IndexTerm *) (address + terms);
+	index->blocks = (const IndexBlock *) (address + blocks);
+	index->data = (const unsigned char *) (address + data);
+	index->text = address + text;
+}
+
+
+int
+idxBuild(InvertedIndex *index, char *filename, int maxLen)
+{
+	struct WordExtractor *wordExtractor;
+	IndexHeader header, *imageHeader;
+	InternTable table;
+	SortedWord *sorted;
+	WordPosition *positions = NULL;
+	IndexTerm *terms;
+	IndexBlock *blocks, *block;
+	uint32_t *tokenIds = NULL, *termOf, *postingStart, *postings, *fill;
+	unsigned char *data = NULL;
+	char *words[IDX_READ_WORDS], *readBuffer, *image;
+	size_t nTokens = 0, nAllocated = 0, dataSize = 0, dataAllocated = 0;
+	size_t textSize = 0;
+	uint64_t wordOffsetsAt, termsAt, blocksAt, dataAt, textAt, end, b;
+	uint32_t t, j, nTerms, token, previous;
+	int i, nRead, readBufferSize = IDX_READ_WORDS * (maxLen + 1);
+
+	wordExtractor = weCreateExtractor(filename, maxLen);
+	if (wordExtractor == NULL) {
+		fprintf(stderr, "Failed creating extractor for '%s'\n", filename);
+		return 0;
+	}
+
+	/** note the word and position of every token */
+	internInit(&table);
+	readBuffer = (char *) reallocOrDie(NULL, readBufferSize);
+	for (;;) {
+		if (nTokens + IDX_READ_WORDS > nAllocated) {
+			nAllocated = (nAllocated == 0) ? 64 * 1024 : nAllocated * 2;
+			tokenIds = (uint32_t *) reallocOrDie(tokenIds,
+					nAllocated * sizeof(uint32_t));
+			positions = (WordPosition *) reallocOrDie(positions,
+					nAllocated * sizeof(WordPosition));
+		}
+		nRead = weGetWordBatchAt(wordExtractor, words, &positions[nTokens],
+				IDX_READ_WORDS, readBuffer, readBufferSize);
+		if (nRead == 0)
+			break;
+		for (i = 0; i < nRead; i++)
+			tokenIds[nTokens++] = internWord(&table, words[i]);
+	}
+	free(readBuffer);
+	weDeleteExtractor(wordExtractor);
+
+	if (nTokens >= UINT32_MAX) {
+		fprintf(stderr, "Error: '%s' has too many words to index\n", filename);
+		free(tokenIds);
+		free(positions);
+		internFree(&table);
+		return 0;
+	}
+
+	/** number the terms in word order */
+	nTerms = internSize(&table);
+	sorted = (SortedWord *) reallocOrDie(NULL,
+			((size_t) nTerms + 1) * sizeof(SortedWord));
+	termOf = (uint32_t *) reallocOrDie(NULL,
+			((size_t) nTerms + 1) * sizeof(uint32_t));
+	for (t = 0; t < nTerms; t++) {
+		sorted[t].word = internString(&table, t);
+		sorted[t].id = t;
+	}
+	qsort(sorted, nTerms, sizeof(SortedWord), compareWords_);
+	for (t = 0; t < nTerms; t++)
+		termOf[sorted[t].id] = t;
+
+	/** group the tokens by term, keeping them in text order */
+	postingStart = (uint32_t *) reallocOrDie(NULL,
+			((size_t) nTerms + 1) * sizeof(uint32_t));
+	memset(postingStart, 0, ((size_t) nTerms + 1) * sizeof(uint32_t));
+	for (token = 0; token < nTokens; token++)
+		postingStart[termOf[tokenIds[token]] + 1]++;
+	for (t = 0; t < nTerms; t++)
+		postingStart[t + 1] += postingStart[t];
+
+	postings = (uint32_t *) reallocOrDie(NULL,
+			(nTokens + 1) * sizeof(uint32_t));
+	fill = (uint32_t *) reallocOrDie(NULL,
+			((size_t) nTerms + 1) * sizeof(uint32_t));
+	memcpy(fill, postingStart, ((size_t) nTerms + 1) * sizeof(uint32_t));
+	for (token = 0; token < nTokens; token++)
+		postings[fill[termOf[tokenIds[token]]]++] = token;
+	free(fill);
+
+	/** cut each term's postings into blocks and encode them */
+	memset(&header, 0, sizeof(header));
+	terms = (IndexTerm *) reallocOrDie(NULL,
+			((size_t) nTerms + 1) * sizeof(IndexTerm));
+	for (t = 0; t < nTerms; t++) {
+		terms[t].nPostings = postingStart[t + 1] - postingStart[t];
+		terms[t].nBlocks = (terms[t].nPostings + IDX_BLOCK_POSTINGS - 1)
+				/ IDX_BLOCK_POSTINGS;
+		terms[t].firstBlock = header.nBlocks;
+		header.nBlocks += terms[t].nBlocks;
+	}
+
+	blocks = (IndexBlock *) reallocOrDie(NULL,
+			(header.nBlocks + 1) * sizeof(IndexBlock));
+	for (t = 0; t < nTerms; t++) {
+		for (j = 0; j < terms[t].nPostings; j++) {
+			token = postings[postingStart[t] + j];
+			/** room for one more posting, most of which take a few bytes */
+			if (dataSize + 3 * MAX_VARINT_LEN > dataAllocated) {
+				dataAllocated = (dataAllocated == 0)
+						? 64 * 1024 : dataAllocated * 2;
+				data = (unsigned char *) reallocOrDie(data, dataAllocated);
+			}
+			if (j % IDX_BLOCK_POSTINGS == 0) {
+				block = &blocks[terms[t].firstBlock + j / IDX_BLOCK_POSTINGS];
+				block->firstPosition = token;
+				block->firstOffset = (uint64_t) positions[token].offset;
+				block->firstLine = (uint32_t) positions[token].line;
+				block->dataOffset = dataSize;
+			} else {
+				previous = postings[postingStart[t] + j - 1];
+				dataSize += putVarint(data + dataSize, token - previous);
+				dataSize += putVarint(data + dataSize, (uint64_t)
+						(positions[token].offset - positions[previous].offset));
+				dataSize += putVarint(data + dataSize, (uint64_t)
+						(positions[token].line - positions[previous].line));
+			}
+		}
+		textSize += table.lengths[sorted[t].id] + 1;
+	}
+
+	/** and lay the whole index out as one image */
+	memcpy(header.magic, IDX_MAGIC, sizeof(header.magic));
+	header.byteOrder = IDX_BYTE_ORDER;
+	header.headerSize = sizeof(IndexHeader);
+	header.nTerms = nTerms;
+	header.maxLen = (uint32_t) maxLen;
+	header.nTokens = nTokens;
+	header.dataSize = dataSize;
+	header.textSize = textSize;
+	layout_(&header, &wordOffsetsAt, &termsAt, &blocksAt, &dataAt, &textAt,
+			&end);
+	header.imageSize = end;
+
+	image = (char *) reallocOrDie(NULL, end);
+	imageHeader = (IndexHeader *) image;
+	memcpy(image, &header, sizeof(header));
+	textSize = 0;
+	for (t = 0; t < nTerms; t++) {
+		((uint64_t *) (image + wordOffsetsAt))[t] = textSize;
+		memcpy(image + textAt + textSize, sorted[t].word,
+				table.lengths[sorted[t].id] + 1);
+		textSize += table.lengths[sorted[t].id] + 1;
+	}
+	memcpy(image + termsAt, terms, (size_t) nTerms * sizeof(IndexTerm));
+	for (b = 0; b < header.nBlocks; b++)
+		memcpy(image + blocksAt + b * sizeof(IndexBlock), &blocks[b],
+				sizeof(IndexBlock));
+	memcpy(image + dataAt, data, dataSize);
+	imageHeader->checksum = hash64(image + header.headerSize,
+			end - header.headerSize, IDX_CHECKSUM_SEED);
+
+	attach_(index, image);
+	index->mapped = 0;
+
+	free(data);
+	free(blocks);
+	free(terms);
+	free(postings);
+	free(postingStart);
+	free(termOf);
+	free(sorted);
+	free(positions);
+	free(tokenIds);
+	internFree(&table);
+	return 1;
+}
+
+
+/** fill in the source fields of the header */
+static int
+describeSource_(IndexHeader *header, const char *sourceName)
+{
+	struct stat sb;
+
+	if (stat(sourceName, &sb) < 0)
+		return 0;
+	header->sourceSize = (uint64_t) sb.st_size;
+	header->sourceMtimeSeconds = (int64_t) sb.st_mtim.tv_sec;
+	header->sourceMtimeNanoseconds = (int64_t) sb.st_mtim.tv_nsec;
+	return 1;
+}
+
+
+int
+idxWrite(InvertedIndex *index, const char *indexName, const char *sourceName)
+{
+	char *tmpName;
+	FILE *ofp;
+
+	if (index->mapped || ! describeSource_(index->header, sourceName))
+		return 0;
+
+	if ((ofp = tempFileOpen(indexName, "wb", &tmpName)) == NULL)
+		return 0;
+	return tempFileCommit(ofp, tmpName, indexName,
+			fwrite(index->header, 1, index->header->imageSize, ofp)
+				== index->header->imageSize);
+}
+
+
+/** check that the mapped index is intact and belongs to the source */
+static int
+validateIndex_(const char *indexName, const char *sourceName,
+		const char *address, size_t fileSize)
+{
+	IndexHeader header, source;
+	uint64_t wordOffsets, terms, blocks, data, text, end;
+
+	if (fileSize < sizeof(IndexHeader)) {
+		fprintf(stderr, "Warning: index '%s' is truncated\n", indexName);
+		return 0;
+	}
+	memcpy(&header, address, sizeof(header));
+	if (memcmp(header.magic, IDX_MAGIC, sizeof(header.magic)) != 0
+			|| header.byteOrder != IDX_BYTE_ORDER
+			|| header.headerSize != sizeof(IndexHeader)) {
+		fprintf(stderr, "Warning: '%s' is not a word index for this"
+				" machine\n", indexName);
+		return 0;
+	}
+
+	if ( ! describeSource_(&source, sourceName)
+			|| source.sourceSize != header.sourceSize
+			|| source.sourceMtimeSeconds != header.sourceMtimeSeconds
+			|| source.sourceMtimeNanoseconds
+				!= header.sourceMtimeNanoseconds) {
+		fprintf(stderr, "Warning: index '%s' is out of date\n", indexName);
+		return 0;
+	}
+
+	layout_(&header, &wordOffsets, &terms, &blocks, &data, &text, &end);
+	if (header.nBlocks > fileSize || header.dataSize > fileSize
+			|| header.textSize > fileSize || header.imageSize != fileSize
+			|| end != fileSize) {
+		fprintf(stderr, "Warning: index '%s' is truncated\n", indexName);
+		return 0;
+	}
+	if (hash64(address + header.headerSize, fileSize - header.headerSize,
+			IDX_CHECKSUM_SEED) != header.checksum) {
+		fprintf(stderr, "Warning: index '%s' fails its checksum\n", indexName);
+		return 0;
+	}
+	return 1;
+}
+
+
+int
+idxLoad(InvertedIndex *index, const char *indexName, const char *sourceName)
+{
+	struct stat sb;
+	char *address;
+	int fd;
+
+	if ((fd = open(indexName, O_RDONLY)) < 0) {
+		if (errno != ENOENT)
+			fprintf(stderr, "Warning: cannot open index '%s' : %s\n",
+					indexName, strerror(errno));
+		return 0;
+	}
+	if (fstat(fd, &sb) < 0 || sb.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+
+	address = (char *) mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (address == MAP_FAILED)
+		return 0;
+
+	if ( ! validateIndex_(indexName, sourceName, address, sb.st_size)) {
+		munmap(address, sb.st_size);
+		return 0;
+	}
+
+	attach_(index, address);
+	index->mapped = 1;
+	return 1;
+}
+
+
+uint32_t
+idxFindTerm(const InvertedIndex *index, const char *word)
+{
+	uint32_t low = 0, high = index->header->nTerms, middle;
+	int comparison;
+
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		comparison = strcmp(index->text + index->wordOffsets[middle], word);
+		if (comparison == 0)
+			return middle;
+		if (comparison < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return IDX_NO_TERM;
+}
+
+
+static void
+cursorInit_(TermCursor *cursor, const InvertedIndex *index, uint32_t term)
+{
+	cursor->index = index;
+	cursor->term = &index->terms[term];
+	cursor->block = -1;
+	cursor->nDecoded = 0;
+	cursor->at = 0;
+}
+
+
+/** decode block b of the cursor's term into its hits */
+static void
+decodeBlock_(TermCursor *cursor, long b)
+{
+	const IndexBlock *block;
+	const unsigned char *p;
+	IndexHit *hit;
+	int j;
+
+	block = &cursor->index->blocks[cursor->term->firstBlock + b];
+	cursor->block = b;
+	cursor->at = 0;
+	cursor->nDecoded = (b == (long) cursor->term->nBlocks - 1)
+			? (int) (cursor->term->nPostings - b * IDX_BLOCK_POSTINGS)
+			: IDX_BLOCK_POSTINGS;
+
+	hit = &cursor->hits[0];
+	hit->position = block->firstPosition;
+	hit->offset = block->firstOffset;
+	hit->line = block->firstLine;
+
+	p = cursor->index->data + block->dataOffset;
+	for (j = 1; j < cursor->nDecoded; j++) {
+		hit = &cursor->hits[j];
+		hit->position = hit[-1].position + (uint32_t) getVarint(&p);
+		hit->offset = hit[-1].offset + getVarint(&p);
+		hit->line = hit[-1].line + (uint32_t) getVarint(&p);
+	}
+}
+
+
+/** the first block-level position of block b */
+static inline uint64_t
+blockStart_(const TermCursor *cursor, long b)
+{
+	return cursor->index->blocks[cursor->term->firstBlock + b].firstPosition;
+}
+
+
+/**
+ * Move the cursor forward to its first posting at or after target.
+ * Returns 0 if there is none
+ */
+static int
+cursorSeek_(TermCursor *cursor, uint64_t target)
+{
+	long nBlocks = (long) cursor->term->nBlocks, low, high, middle, step;
+	int from, to, mid, gallop;
+
+	/** unless the block already decoded reaches target, gallop along
+	 * the skip table to the last block starting at or before it */
+	if (cursor->nDecoded == 0
+			|| cursor->hits[cursor->nDecoded - 1].position < target) {
+		low = cursor->block + 1;
+		if (low >= nBlocks)
+			return 0;
+		for (step = 1; low + step < nBlocks
+				&& blockStart_(cursor, low + step) <= target; step *= 2)
+			low += step;
+		high = (low + step < nBlocks) ? low + step : nBlocks;
+		while (high - low > 1) {
+			middle = low + (high - low) / 2;
+			if (blockStart_(cursor, middle) <= target)
+				low = middle;
+			else
+				high = middle;
+		}
+		decodeBlock_(cursor, low);
+
+		/** the block may end before target, leaving the next one */
+		if (cursor->hits[cursor->nDecoded - 1].position < target) {
+			if (low + 1 >= nBlocks)
+				return 0;
+			decodeBlock_(cursor, low + 1);
+			return 1;
+		}
+	}
+
+	/** then gallop within the block */
+	from = cursor->at;
+	if (cursor->hits[from].position >= target)
+		return 1;
+	for (gallop = 1; from + gallop < cursor->nDecoded
+			&& cursor->hits[from + gallop].position < target; gallop *= 2)
+		from += gallop;
+	to = (from + gallop < cursor->nDecoded) ? from + gallop
+			: cursor->nDecoded - 1;
+	while (to - from > 1) {
+		mid = from + (to - from) / 2;
+		if (cursor->hits[mid].position < target)
+			from = mid;
+		else
+			to = mid;
+	}
+	cursor->at = to;
+	return 1;
+}
+
+
+/** step to the next posting; returns 0 at the end */
+static int
+cursorNext_(TermCursor *cursor)
+{
+	if (++cursor->at < cursor->nDecoded)
+		return 1;
+	if (cursor->block + 1 >= (long) cursor->term->nBlocks)
+		return 0;
+	decodeBlock_(cursor, cursor->block + 1);
+	return 1;
+}
+
+
+static inline const IndexHit *
+cursorHit_(const TermCursor *cursor)
+{
+	return &cursor->hits[cursor->at];
+}
+
+
+long
+idxFindPhrase(const InvertedIndex *index, char **words, int nWords,
+		IndexHit **hits)
+{
+	TermCursor *cursors;
+	uint32_t *terms;
+	IndexHit *found = NULL;
+	uint64_t start, position;
+	size_t lastLength;
+	long nFound = 0, nAllocated = 0;
+	int i, rarest = 0, matched, more;
+
+	*hits = NULL;
+	if (nWords <= 0)
+		return 0;
+
+	terms = (uint32_t *) reallocOrDie(NULL, nWords * sizeof(uint32_t));
+	for (i = 0; i < nWords; i++) {
+		terms[i] = idxFindTerm(index, words[i]);
+		if (terms[i] == IDX_NO_TERM) {
+			free(terms);
+			return 0;
+		}
+		if (index->terms[terms[i]].nPostings
+				< index->terms[terms[rarest]].nPostings)
+			rarest = i;
+	}
+	lastLength = strlen(index->text + index->wordOffsets[terms[nWords - 1]]);
+
+	cursors = (TermCursor *) reallocOrDie(NULL, nWords * sizeof(TermCursor));
+	for (i = 0; i < nWords; i++)
+		cursorInit_(&cursors[i], index, terms[i]);
+
+	/**
+	 * Each posting of the rarest word is a candidate; the others are
+	 * checked at the positions the phrase needs, and when one is
+	 * missing the candidates leap forward to where that word next is
+	 */
+	more = cursorSeek_(&cursors[rarest], rarest);
+	while (more) {
+		start = cursorHit_(&cursors[rarest])->position - rarest;
+		matched = 1;
+		for (i = 0; i < nWords && more && matched; i++) {
+			if (i == rarest)
+				continue;
+			if ( ! cursorSeek_(&cursors[i], start + i)) {
+				more = 0;
+			} else if ((position = cursorHit_(&cursors[i])->position)
+					!= start + i) {
+				matched = 0;
+				more = cursorSeek_(&cursors[rarest], position - i + rarest);
+			}
+		}
+		if ( ! more || ! matched)
+			continue;
+
+		if (nFound == nAllocated) {
+			nAllocated = (nAllocated == 0) ? 64 : nAllocated * 2;
+			found = (IndexHit *) reallocOrDie(found,
+					nAllocated * sizeof(IndexHit));
+		}
+		found[nFound] = *cursorHit_(&cursors[0]);
+		found[nFound].endOffset = cursorHit_(&cursors[nWords - 1])->offset
+				+ lastLength;
+		nFound++;
+
+		more = cursorNext_(&cursors[rarest]);
+	}
+
+	free(cursors);
+	free(terms);
+	*hits = found;
+	return nFound;
+}
+
+
+void
+idxFree(InvertedIndex *index)
+{
+	if (index->header == NULL)
+		return;
+
+	if (index->mapped)
+		munmap(index->header, index->header->imageSize);
+	else
+		free(index->header);
+	memset(index, 0, sizeof(*index));
+}
@@ -0,0 +1,140 @@
+#ifndef	__INVERTED_INDEX_HEADER__
+#define	__INVERTED_INDEX_HEADER__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A positional inverted index of a text: for every distinct word, the
+ * list of places it occurs, each given as its word position (the
+ * number of words before it), its byte offset, and its line.
+ *
+ * Each word's postings are kept in blocks of IDX_BLOCK_POSTINGS.  A
+ * block's first posting is held in full in a skip table entry; the
+ * rest are held as the differences from the posting before, each
+ * part as a LEB128 varint, so most postings take three or four bytes.
+ * A phrase is found by walking the postings of its rarest word and
+ * checking each of the others at the position the phrase needs.
+ * Those checks gallop along the skip table to the one block that can
+ * hold the position, so only that block is decoded.
+ *
+ * The index is one block of memory:
+ *
+ *     header        IndexHeader
+ *     wordOffsets   uint64_t   [nTerms]  into the word text
+ *     terms         IndexTerm  [nTerms]
+ *     blocks        IndexBlock [nBlocks]
+ *     data          the varints of the blocks
+ *     text          the words, each NUL terminated
+ *
+ * Terms are numbered in byte order of their words, so a word is
+ * looked up by binary search.  The index is written to a file as it
+ * stands, and mapped back in by idxLoad().  The header records the
+ * size and modification time of the text, so an index older than its
+ * text is never used, and a hash64() checksum of everything after the
+ * header.  Files are written in the byte order of the machine writing
+ * them, and are rejected by a machine of the other order.
+ */
+
+#define	IDX_SUFFIX				".idx"
+#define	IDX_MAGIC				"WIDX0001"
+#define	IDX_BYTE_ORDER			0x01020304
+#define	IDX_BLOCK_POSTINGS		128
+#define	IDX_NO_TERM				UINT32_MAX
+
+typedef struct IndexHeader {
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t headerSize;
+	uint32_t nTerms;
+	uint32_t maxLen;		/* the word length the text was read with */
+	uint64_t nTokens;
+	uint64_t nBlocks;
+	uint64_t dataSize;
+	uint64_t textSize;
+	uint64_t imageSize;
+	uint64_t sourceSize;
+	int64_t sourceMtimeSeconds;
+	int64_t sourceMtimeNanoseconds;
+	uint64_t checksum;
+} IndexHeader;
+
+typedef struct IndexTerm {
+	uint32_t nPostings;
+	uint32_t nBlocks;
+	uint64_t firstBlock;
+} IndexTerm;
+
+/** the first posting of a block, and where the rest are encoded */
+typedef struct IndexBlock {
+	uint64_t firstOffset;
+	uint32_t firstPosition;
+	uint32_t firstLine;
+	uint64_t dataOffset;
+} IndexBlock;
+
+/** one place a word or phrase occurs */
+typedef struct IndexHit {
+	uint32_t position;
+	uint32_t line;
+	uint64_t offset;
+	uint64_t endOffset;		/* just past the last word, as indexed */
+} IndexHit;
+
+typedef struct InvertedIndex {
+	IndexHeader *header;
+	const uint64_t *wordOffsets;
+	const IndexTerm *terms;
+	const IndexBlock *blocks;
+	const unsigned char *data;
+	const char *text;
+	int mapped;				/* the image is a file mapping */
+} InvertedIndex;
+
+/**
+ * the name of the index file kept for sourceName; free() it when
+ * done
+ */
+char *idxFileName(const char *sourceName);
+
+/**
+ * Index every word of filename, reading words of up to maxLen letters.
+ *
+ * Returns 1 on success, or 0 on failure
+ */
+int idxBuild(InvertedIndex *index, char *filename, int maxLen);
+
+/**
+ * Write index to indexName as the index of sourceName, under a
+ * temporary name that is then renamed into place.
+ *
+ * Returns 1 on success, or 0 on failure
+ */
+int idxWrite(InvertedIndex *index, const char *indexName,
+		const char *sourceName);
+
+/**
+ * Map the index written to indexName for sourceName into index.
+ *
+ * Returns 1 on success, or 0 if it cannot be read, is not intact, or
+ * is older than sourceName
+ */
+int idxLoad(InvertedIndex *index, const char *indexName,
+		const char *sourceName);
+
+/** the term of word, or IDX_NO_TERM if it does not occur */
+uint32_t idxFindTerm(const InvertedIndex *index, const char *word);
+
+/**
+ * Find every place the nWords words occur one after another, in text
+ * order, setting *hits to a malloc()ed array of them.
+ *
+ * Returns the number of hits
+ */
+long idxFindPhrase(const InvertedIndex *index, char **words, int nWords,
+		IndexHit **hits);
+
+/** release index */
+void idxFree(InvertedIndex *index);
+
+#endif /* __INVERTED_INDEX_HEADER__ */
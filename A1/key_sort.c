@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "key_sort.h"
+
+/** groups smaller than this are insertion sorted rather than distributed */
+#define	KEY_SORT_CUTOFF		24
+
+
+/** insertion sort nodes on their keys, which agree before depth */
+static void
+insertionSort_(LLNode **nodes, long n, int depth)
+{
+	const unsigned char *a, *b;
+	LLNode *node;
+	long i, j;
+
+	for (i = 1; i < n; i++) {
+		node = nodes[i];
+		for (j = i; j > 0; j--) {
+			a = (const unsigned char *) nodes[j - 1]->key + depth;
+			b = (const unsigned char *) node->key + depth;
+			while (*a == *b && *a != '\0') {
+				a++;
+				b++;
+			}
+			if (*a <= *b)
+				break;
+			nodes[j] = nodes[j - 1];
+		}
+		nodes[j] = node;
+	}
+}
+
+
+/** sort nodes on their keys, which agree before depth */
+static void
+radixSort_(LLNode **nodes, unsigned char *digits, long n, int depth)
+{
+	long counts[256], next[256], end[256];
+	LLNode *node, *swapNode;
+	unsigned char digit, swapDigit;
+	long i, start;
+	int b;
+
+	if (n < KEY_SORT_CUTOFF) {
+		insertionSort_(nodes, n, depth);
+		return;
+	}
+
+	memset(counts, 0, sizeof(counts));
+	for (i = 0; i < n; i++) {
+		digits[i] = (unsigned char) nodes[i]->key[depth];
+		counts[digits[i]]++;
+	}
+
+	start = 0;
+	for (b = 0; b < 256; b++) {
+		next[b] = start;
+		start += counts[b];
+		end[b] = start;
+	}
+
+	/**
+	 * Move every node straight to the next free slot of its group,
+	 * carrying the node it displaces on to that one's group in turn,
+	 * until a node for the slot being filled comes round
+	 */
+	for (b = 0; b < 256; b++) {
+		while (next[b] < end[b]) {
+			node = nodes[next[b]];
+			digit = digits[next[b]];
+			while (digit != b) {
+				swapNode = nodes[next[digit]];
+				swapDigit = digits[next[digit]];
+				nodes[next[digit]] = node;
+				digits[next[digit]] = digit;
+				next[digit]++;
+				node = swapNode;
+				digit = swapDigit;
+			}
+			nodes[next[b]] = node;
+			digits[next[b]] = digit;
+			next[b]++;
+		}
+	}
+
+	/** the keys that ended here (group 0) are all equal */
+	start = counts[0];
+	for (b = 1; b < 256; b++) {
+		if (counts[b] > 1)
+			radixSort_(&nodes[start], digits, counts[b], depth + 1);
+		start += counts[b];
+	}
+}
+
+
+void
+keySortNodes(LLNode **nodes, long n)
+{
+	unsigned char *digits;
+
+	if (n < KEY_SORT_CUTOFF) {
+		insertionSort_(nodes, n, 0);
+		return;
+	}
+
+	digits = (unsigned char *) malloc(n);
+	if (digits == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	radixSort_(nodes, digits, n, 0);
+	free(digits);
+}
+
+
+static int
+compareNodeKeys_(const void *a, const void *b)
+{
+	return strcmp((*(LLNode * const *) a)->key, (*(LLNode * const *) b)->key);
+}
+
+
+void
+keySortNodesQsort(LLNode **nodes, long n)
+{
+	qsort(nodes, n, sizeof(LLNode *), compareNodeKeys_);
+}
+
+
+LLNode *
+keySortList(LLNode *listp)
+{
+	LLNode **nodes, *node;
+	long i, n = 0;
+
+	for (node = listp; node != NULL; node = node->next)
+		n++;
+	if (n < 2)
+		return listp;
+
+	nodes = (LLNode **) malloc(n * sizeof(LLNode *));
+	if (nodes == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	for (i = 0, node = listp; node != NULL; node = node->next)
+		nodes[i++] = node;
+
+	keySortNodes(nodes, n);
+
+	for (i = 0; i < n - 1; i++)
+		nodes[i]->next = nodes[i + 1];
+	nodes[n - 1]->next = NULL;
+	listp = nodes[0];
+
+	free(nodes);
+	return listp;
+}
@@ -0,0 +1,28 @@
+#ifndef	__KEY_SORT_HEADER__
+#define	__KEY_SORT_HEADER__
+
+#include "LLNode.h"
+
+/**
+ * Sorting word list nodes by key, in the same order as strcmp().
+ *
+ * keySortNodes() is an in-place MSD radix sort (an "American flag"
+ * sort) over the node pointers: each pass distributes the nodes on one
+ * character of their keys and then sorts each group on the next, so
+ * no two keys are ever compared as a whole.  The character each node
+ * is sorted on is first copied into a small array of its own, so the
+ * counting and permuting passes read those bytes in order rather than
+ * following every node pointer out to its key again.  Groups too small
+ * to be worth distributing are finished with an insertion sort.
+ */
+
+/** sort nodes[0..n-1] by key with the MSD radix sort */
+void keySortNodes(LLNode **nodes, long n);
+
+/** sort nodes[0..n-1] by key with qsort() and strcmp(), for comparison */
+void keySortNodesQsort(LLNode **nodes, long n);
+
+/** relink listp in ascending key order, returning the new head */
+LLNode *keySortList(LLNode *listp);
+
+#endif /* __KEY_SORT_HEADER__ */
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "word_tally.h"
+#include "key_sort.h"
+#include "util.h"
+
+// define the maximum length of word we will look for, and by extension,
+// the number of entries that must be in the array of word lists
+#define	MAX_WORD_LEN	24
+
+typedef void (*SortFn)(LLNode **nodes, long n);
+
+
+/**
+ * Sort a fresh copy of each length's nodes with sortFn, nRepeats
+ * times, leaving the last sorted copy in sorted.  Returns the time
+ * taken by the sorting alone
+ */
+static double
+timeSort(SortFn sortFn, LLNode ***buckets, long *sizes, LLNode ***sorted,
+		int nRepeats)
+{
+	struct timespec startTime;
+	double seconds = 0;
+	int i, r;
+
+	for (r = 0; r < nRepeats; r++) {
+		for (i = 0; i <= MAX_WORD_LEN; i++)
+			memcpy(sorted[i], buckets[i], sizes[i] * sizeof(LLNode *));
+
+		clock_gettime(CLOCK_MONOTONIC, &startTime);
+		for (i = 0; i <= MAX_WORD_LEN; i++)
+			(*sortFn)(sorted[i], sizes[i]);
+		seconds += secondsSince(&startTime);
+	}
+	return seconds;
+}
+
+
+static void
+deleteKey(LLNode *node, void *userdata)
+{
+	free(node->key);
+}
+
+
+static int
+benchmarkFile(char *filename, int nRepeats)
+{
+	LLNode *wordLists[MAX_WORD_LEN + 1];
+	LLNode **buckets[MAX_WORD_LEN + 1];
+	LLNode **radixSorted[MAX_WORD_LEN + 1];
+	LLNode **qsortSorted[MAX_WORD_LEN + 1];
+	long sizes[MAX_WORD_LEN + 1];
+	LLNode *node;
+	double radixSeconds, qsortSeconds;
+	long j, nKeys = 0;
+	int i, status = 1;
+
+	if (tallyWordsInFile(filename, wordLists, MAX_WORD_LEN) == 0)
+		return 0;
+
+	for (i = 0; i <= MAX_WORD_LEN; i++) {
+		sizes[i] = 0;
+		for (node = wordLists[i]; node != NULL; node = node->next)
+			sizes[i]++;
+		nKeys += sizes[i];
+
+		buckets[i] = (LLNode **) malloc((sizes[i] + 1) * sizeof(LLNode *));
+		radixSorted[i] = (LLNode **) malloc((sizes[i] + 1) * sizeof(LLNode *));
+		qsortSorted[i] = (LLNode **) malloc((sizes[i] + 1) * sizeof(LLNode *));
+		if (buckets[i] == NULL || radixSorted[i] == NULL
+				|| qsortSorted[i] == NULL) {
+			fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+			exit(1);
+		}
+		for (j = 0, node = wordLists[i]; node != NULL; node = node->next)
+			buckets[i][j++] = node;
+	}
+
+	radixSeconds = timeSort(keySortNodes, buckets, sizes, radixSorted,
+			nRepeats);
+	qsortSeconds = timeSort(keySortNodesQsort, buckets, sizes, qsortSorted,
+			nRepeats);
+
+	for (i = 0; i <= MAX_WORD_LEN; i++) {
+		if (memcmp(radixSorted[i], qsortSorted[i],
+				sizes[i] * sizeof(LLNode *)) != 0) {
+			fprintf(stderr, "Error: radix and qsort orders differ"
+					" for length %d in '%s'\n", i, filename);
+			status = 0;
+		}
+	}
+
+	printf("%s: %ld keys, sorted %d times\n", filename, nKeys, nRepeats);
+	printf("    radix : %lf seconds, %.2f million keys/sec\n", radixSeconds,
+			(radixSeconds > 0) ? nKeys * nRepeats / radixSeconds / 1e6 : 0.0);
+	printf("    qsort : %lf seconds, %.2f million keys/sec\n", qsortSeconds,
+			(qsortSeconds > 0) ? nKeys * nRepeats / qsortSeconds / 1e6 : 0.0);
+	if (radixSeconds > 0)
+		printf("    radix speedup : %.2fx\n", qsortSeconds / radixSeconds);
+
+	for (i = 0; i <= MAX_WORD_LEN; i++) {
+		free(buckets[i]);
+		free(radixSorted[i]);
+		free(qsortSorted[i]);
+		llFree(wordLists[i], deleteKey, NULL);
+	}
+	return status;
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Tallies the words of each file, then times sorting the keys of\n");
+	fprintf(stderr, "each word length with the MSD radix sort and with qsort().\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-r <N> : sort each file's keys <N> times (default 10).\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	int i, nRepeats = 10, didProcessing = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			if (argv[i][1] == 'r' && i + 1 < argc) {
+				nRepeats = atoi(argv[++i]);
+				if (nRepeats < 1)
+					nRepeats = 1;
+			} else {
+				fprintf(stderr, "Error: unknown option '%s'\n", argv[i]);
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			if (benchmarkFile(argv[i], nRepeats) == 0) {
+				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+						argv[i]);
+				return 1;
+			}
+			didProcessing = 1;
+		}
+	}
+
+	if ( ! didProcessing ) {
+		fprintf(stderr, "No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+
+	return 0;
+}
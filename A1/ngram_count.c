@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ngram_count.h"
+
+#define	NGRAM_EMPTY_KEY			UINT64_MAX
+#define	NGRAM_INITIAL_CAPACITY	(1 << 16)
+
+/** keys are hashed and their slots prefetched this many at a time */
+#define	NGRAM_BATCH				32
+
+
+static NgramSlot *
+allocSlots_(uint64_t capacity)
+{
+	NgramSlot *slots;
+
+	slots = (NgramSlot *) malloc(capacity * sizeof(NgramSlot));
+	if (slots == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	memset(slots, 0xff, capacity * sizeof(NgramSlot));
+	return slots;
+}
+
+
+int
+ngramInit(NgramCounts *counts, int n)
+{
+	if (n < NGRAM_MIN_N || n > NGRAM_MAX_N)
+		return 0;
+
+	memset(counts, 0, sizeof(*counts));
+	counts->n = n;
+	counts->highMask = (n == 4) ? UINT64_MAX
+			: (n == 3) ? UINT32_MAX : 0;
+	counts->capacity = NGRAM_INITIAL_CAPACITY;
+	counts->shift = 64 - 16;
+	counts->slots = allocSlots_(counts->capacity);
+	return 1;
+}
+
+
+void
+ngramStartText(NgramCounts *counts)
+{
+	counts->window.high = 0;
+	counts->window.low = 0;
+	counts->nInWindow = 0;
+}
+
+
+/**
+ * The first slot to probe for key: a Fibonacci hash of the low half,
+ * after folding in the high half
+ */
+static inline uint64_t
+home_(const NgramCounts *counts, const NgramKey *key)
+{
+	return ((key->low ^ (key->high * 0xC2B2AE3D27D4EB4FULL))
+			* 0x9E3779B97F4A7C15ULL) >> counts->shift;
+}
+
+
+static inline int
+sameKey_(const NgramKey *a, const NgramKey *b)
+{
+	return a->low == b->low && a->high == b->high;
+}
+
+
+static inline void
+insert_(NgramCounts *counts, const NgramKey *key, uint64_t i)
+{
+	uint64_t mask = counts->capacity - 1;
+	NgramSlot *slot;
+
+	for (;; i = (i + 1) & mask) {
+		slot = &counts->slots[i];
+		if (sameKey_(&slot->key, key)) {
+			slot->count++;
+			return;
+		}
+		if (slot->key.low == NGRAM_EMPTY_KEY) {
+			slot->key = *key;
+			slot->count = 1;
+			counts->nUsed++;
+			return;
+		}
+	}
+}
+
+
+/** double the table */
+static void
+grow_(NgramCounts *counts)
+{
+	NgramSlot *oldSlots = counts->slots, *slot, *newSlot;
+	uint64_t oldCapacity = counts->capacity, i, j, mask;
+
+	counts->capacity *= 2;
+	counts->shift--;
+	counts->slots = allocSlots_(counts->capacity);
+	mask = counts->capacity - 1;
+
+	for (i = 0; i < oldCapacity; i++) {
+		slot = &oldSlots[i];
+		if (slot->key.low == NGRAM_EMPTY_KEY)
+			continue;
+		for (j = home_(counts, &slot->key); ; j = (j + 1) & mask) {
+			newSlot = &counts->slots[j];
+			if (newSlot->key.low == NGRAM_EMPTY_KEY) {
+				*newSlot = *slot;
+				break;
+			}
+		}
+	}
+	free(oldSlots);
+}
+
+
+/** count a batch of keys, prefetching all of their slots first */
+static void
+insertBatch_(NgramCounts *counts, const NgramKey *keys, int nKeys)
+{
+	uint64_t homes[NGRAM_BATCH];
+	int i;
+
+	/** keep the table at most half full, even if every key is new */
+	while (2 * (counts->nUsed + nKeys) > counts->capacity)
+		grow_(counts);
+
+	for (i = 0; i < nKeys; i++) {
+		homes[i] = home_(counts, &keys[i]);
+		__builtin_prefetch(&counts->slots[homes[i]], 1);
+	}
+	for (i = 0; i < nKeys; i++)
+		insert_(counts, &keys[i], homes[i]);
+	counts->nNgrams += nKeys;
+}
+
+
+int
+ngramAddIds(NgramCounts *counts, const uint32_t *ids, size_t nIds)
+{
+	NgramKey keys[NGRAM_BATCH];
+	NgramKey *window = &counts->window;
+	size_t i;
+	int nKeys = 0;
+
+	for (i = 0; i < nIds; i++) {
+		if (ids[i] == UINT32_MAX) {
+			fprintf(stderr, "Error: word id %lu cannot be counted\n",
+					(unsigned long) ids[i]);
+			return 0;
+		}
+
+		window->high = ((window->high << 32) | (window->low >> 32))
+				& counts->highMask;
+		window->low = (window->low << 32) | ids[i];
+		if (counts->nInWindow < counts->n - 1) {
+			counts->nInWindow++;
+			continue;
+		}
+
+		keys[nKeys++] = *window;
+		if (nKeys == NGRAM_BATCH) {
+			insertBatch_(counts, keys, nKeys);
+			nKeys = 0;
+		}
+	}
+	if (nKeys > 0)
+		insertBatch_(counts, keys, nKeys);
+	return 1;
+}
+
+
+uint64_t
+ngramDistinct(const NgramCounts *counts)
+{
+	return counts->nUsed;
+}
+
+
+uint64_t
+ngramSingletons(const NgramCounts *counts)
+{
+	uint64_t i, n = 0;
+
+	for (i = 0; i < counts->capacity; i++)
+		if (counts->slots[i].key.low != NGRAM_EMPTY_KEY
+				&& counts->slots[i].count == 1)
+			n++;
+	return n;
+}
+
+
+/** whether key a comes after key b, comparing the ids in order */
+static inline int
+keyAfter_(const NgramKey *a, const NgramKey *b)
+{
+	return (a->high > b->high) || (a->high == b->high && a->low > b->low);
+}
+
+
+/** whether entry a ranks below entry b: less frequent, or a later key */
+static inline int
+ranksBelow_(const NgramKey *keyA, uint64_t countA,
+		const NgramKey *keyB, uint64_t countB)
+{
+	return (countA < countB) || (countA == countB && keyAfter_(keyA, keyB));
+}
+
+
+/** restore the heap (lowest ranked at the top) below entry i */
+static void
+heapSiftDown_(NgramKey *keys, uint64_t *tallies, int n, int i)
+{
+	NgramKey tk;
+	uint64_t tt;
+	int child;
+
+	for (;;) {
+		child = 2 * i + 1;
+		if (child >= n)
+			break;
+		if (child + 1 < n && ranksBelow_(&keys[child + 1], tallies[child + 1],
+				&keys[child], tallies[child]))
+			child++;
+		if ( ! ranksBelow_(&keys[child], tallies[child], &keys[i], tallies[i]))
+			break;
+		tk = keys[i]; keys[i] = keys[child]; keys[child] = tk;
+		tt = tallies[i]; tallies[i] = tallies[child]; tallies[child] = tt;
+		i = child;
+	}
+}
+
+
+int
+ngramTopK(const NgramCounts *counts, int K, NgramKey *keys, uint64_t *tallies)
+{
+	const NgramSlot *slot;
+	NgramKey tk;
+	uint64_t i, tt;
+	int n = 0, j;
+
+	if (K <= 0)
+		return 0;
+
+	/** keep the K highest ranked seen so far in a heap */
+	for (i = 0; i < counts->capacity; i++) {
+		slot = &counts->slots[i];
+		if (slot->key.low == NGRAM_EMPTY_KEY)
+			continue;
+		if (n < K) {
+			keys[n] = slot->key;
+			tallies[n] = slot->count;
+			if (++n == K) {
+				for (j = K / 2 - 1; j >= 0; j--)
+					heapSiftDown_(keys, tallies, K, j);
+			}
+		} else if (ranksBelow_(&keys[0], tallies[0], &slot->key, slot->count)) {
+			keys[0] = slot->key;
+			tallies[0] = slot->count;
+			heapSiftDown_(keys, tallies, K, 0);
+		}
+	}
+
+	if (n < K) {
+		for (j = n / 2 - 1; j >= 0; j--)
+			heapSiftDown_(keys, tallies, n, j);
+	}
+
+	/** heap sort, highest ranked first */
+	for (j = n - 1; j > 0; j--) {
+		tk = keys[0]; keys[0] = keys[j]; keys[j] = tk;
+		tt = tallies[0]; tallies[0] = tallies[j]; tallies[j] = tt;
+		heapSiftDown_(keys, tallies, j, 0);
+	}
+
+	return n;
+}
+
+
+void
+ngramUnpack(const NgramCounts *counts, const NgramKey *key, uint32_t *ids)
+{
+	uint64_t low = key->low, high = key->high;
+	int i;
+
+	for (i = counts->n - 1; i >= 0; i--) {
+		ids[i] = (uint32_t) low;
+		low = (low >> 32) | (high << 32);
+		high >>= 32;
+	}
+}
+
+
+void
+ngramApply(const NgramCounts *counts,
+		void (*fn)(const NgramKey *key, uint64_t count, void *arg),
+		void *arg)
+{
+	uint64_t i;
+
+	for (i = 0; i < counts->capacity; i++)
+		if (counts->slots[i].key.low != NGRAM_EMPTY_KEY)
+			(*fn)(&counts->slots[i].key, counts->slots[i].count, arg);
+}
+
+
+void
+ngramFree(NgramCounts *counts)
+{
+	free(counts->slots);
+	memset(counts, 0, sizeof(*counts));
+}
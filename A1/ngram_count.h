@@ -0,0 +1,95 @@
+#ifndef	__NGRAM_COUNT_HEADER__
+#define	__NGRAM_COUNT_HEADER__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Counting the n-grams (runs of n consecutive words) of a text, given
+ * the ids of its words as the interned tally produces them.
+ *
+ * The ids of each n-gram are packed into one 128-bit key, 32 bits
+ * apiece, by a window that shifts in one id per word, so an n-gram
+ * costs little more to count than a single word and any id the intern
+ * table hands out fits, however large the vocabulary.  The keys are
+ * counted in an open-addressed table of key and count pairs, so a
+ * probe touches one or two cache lines.  Keys are inserted a batch at
+ * a time: the slot of every key of the batch is prefetched before any
+ * is updated, so that the cache misses of a batch overlap rather than
+ * follow one another.
+ *
+ * No n-gram spans two texts: ngramStartText() empties the window.
+ */
+
+#define	NGRAM_MIN_N		2
+#define	NGRAM_MAX_N		4
+
+/** the ids of an n-gram, 32 bits each, the first word highest */
+typedef struct NgramKey {
+	uint64_t high;		/* the first two words of a 4-gram */
+	uint64_t low;		/* NGRAM_EMPTY_KEY if the slot is unused */
+} NgramKey;
+
+typedef struct NgramSlot {
+	NgramKey key;
+	uint64_t count;
+} NgramSlot;
+
+typedef struct NgramCounts {
+	NgramSlot *slots;
+	uint64_t capacity;		/* always a power of two */
+	int shift;				/* 64 - log2(capacity) */
+	uint64_t nUsed;
+	uint64_t nNgrams;		/* n-grams counted, with repeats */
+	int n;
+	uint64_t highMask;		/* the bits of high the n-gram uses */
+	NgramKey window;
+	int nInWindow;
+} NgramCounts;
+
+/**
+ * set up an empty count of n-grams of n words.
+ *
+ * Returns 1 on success, or 0 if n is out of range
+ */
+int ngramInit(NgramCounts *counts, int n);
+
+/** start a new text, so that no n-gram joins it to the last */
+void ngramStartText(NgramCounts *counts);
+
+/**
+ * count the n-grams ending at each of the next nIds words of the text.
+ *
+ * Returns 1 on success, or 0 if an id is UINT32_MAX, which is kept
+ * back to mark empty slots (and is never a word's id)
+ */
+int ngramAddIds(NgramCounts *counts, const uint32_t *ids, size_t nIds);
+
+/** the number of distinct n-grams seen */
+uint64_t ngramDistinct(const NgramCounts *counts);
+
+/** the number of n-grams seen exactly once */
+uint64_t ngramSingletons(const NgramCounts *counts);
+
+/**
+ * Find the K most frequent n-grams, most frequent first (and in key
+ * order among equals).
+ *
+ * Returns the number of entries filled in (at most K)
+ */
+int ngramTopK(const NgramCounts *counts, int K, NgramKey *keys,
+		uint64_t *tallies);
+
+/** unpack the n word ids of key, first word first */
+void ngramUnpack(const NgramCounts *counts, const NgramKey *key,
+		uint32_t *ids);
+
+/** call fn for every distinct n-gram, in no particular order */
+void ngramApply(const NgramCounts *counts,
+		void (*fn)(const NgramKey *key, uint64_t count, void *arg),
+		void *arg);
+
+/** release the table */
+void ngramFree(NgramCounts *counts);
+
+#endif /* __NGRAM_COUNT_HEADER__ */
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "word_tally.h"
+#include "intern_table.h"
+#include "token_stream.h"
+#include "ngram_count.h"
+#include "util.h"
+
+// define the maximum length of word we will look for
+#define	MAX_WORD_LEN	24
+
+/** what the tally hands each batch of word ids to */
+typedef struct NgramObserver {
+	NgramCounts *counts;
+	int failed;
+} NgramObserver;
+
+/** what printing the hapax n-grams needs */
+typedef struct HapaxPrinter {
+	NgramCounts *counts;
+	InternTable *table;
+	uint32_t *ids;
+} HapaxPrinter;
+
+
+static void
+countNgrams(void *arg, const uint32_t *ids, int nIds)
+{
+	NgramObserver *observer = (NgramObserver *) arg;
+
+	if ( ! observer->failed
+			&& ! ngramAddIds(observer->counts, ids, (size_t) nIds))
+		observer->failed = 1;
+}
+
+
+/** print the words of an n-gram, separated by spaces */
+static void
+printNgram(NgramCounts *counts, InternTable *table, const NgramKey *key,
+		uint32_t *ids)
+{
+	int i;
+
+	ngramUnpack(counts, key, ids);
+	for (i = 0; i < counts->n; i++)
+		printf("%s%s", (i > 0) ? " " : "", internString(table, ids[i]));
+}
+
+
+static void
+printIfHapax(const NgramKey *key, uint64_t count, void *arg)
+{
+	HapaxPrinter *printer = (HapaxPrinter *) arg;
+
+	if (count != 1)
+		return;
+	printf("\t");
+	printNgram(printer->counts, printer->table, key, printer->ids);
+	printf("\n");
+}
+
+
+/** print the summary, the top n-grams, and the hapax n-grams if asked */
+static void
+printNgramReport(NgramCounts *counts, InternTable *table, int nTop,
+		int printHapax)
+{
+	HapaxPrinter printer;
+	NgramKey *topKeys;
+	uint64_t *topTallies;
+	uint32_t ids[NGRAM_MAX_N];
+	int i, nFound;
+
+	printf("%lu distinct %d-grams, %lu singletons (hapax %d-grams)\n",
+			(unsigned long) ngramDistinct(counts), counts->n,
+			(unsigned long) ngramSingletons(counts), counts->n);
+
+	if (nTop > 0) {
+		topKeys = (NgramKey *) malloc(nTop * sizeof(NgramKey));
+		topTallies = (uint64_t *) malloc(nTop * sizeof(uint64_t));
+		if (topKeys == NULL || topTallies == NULL) {
+			fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+			exit(1);
+		}
+
+		nFound = ngramTopK(counts, nTop, topKeys, topTallies);
+		printf("Most frequent %d-grams:\n", counts->n);
+		for (i = 0; i < nFound; i++) {
+			printf("    '");
+			printNgram(counts, table, &topKeys[i], ids);
+			printf("' %lu\n", (unsigned long) topTallies[i]);
+		}
+
+		free(topKeys);
+		free(topTallies);
+	}
+
+	if (printHapax) {
+		printf("Hapax %d-grams:\n", counts->n);
+		printer.counts = counts;
+		printer.table = table;
+		printer.ids = ids;
+		ngramApply(counts, printIfHapax, &printer);
+	}
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Counts the n-grams (runs of consecutive words) of all files.\n");
+	fprintf(stderr, "A file ending in .tok is read as a token stream (see tokstream).\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-n <N> : count <N>-grams, %d to %d (default 2).\n",
+			NGRAM_MIN_N, NGRAM_MAX_N);
+	fprintf(stderr, "-k <K> : print the <K> most frequent n-grams (default 10).\n");
+	fprintf(stderr, "-H     : print the n-grams seen only once.\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	InternTable table;
+	IdTally tally;
+	NgramCounts counts;
+	NgramObserver observer;
+	struct timespec startTime;
+	double seconds;
+	int i, n = 2, nTop = 10, printHapax = 0, nFiles = 0, status;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (argv[i][1] == 'H') {
+			printHapax = 1;
+		} else if (argv[i][1] == 'n' && i + 1 < argc) {
+			n = atoi(argv[++i]);
+		} else if (argv[i][1] == 'k' && i + 1 < argc) {
+			nTop = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "Error: unknown option '%s'\n", argv[i]);
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if ( ! ngramInit(&counts, n)) {
+		fprintf(stderr, "Error: n must be from %d to %d\n",
+				NGRAM_MIN_N, NGRAM_MAX_N);
+		return 1;
+	}
+
+	internInit(&table);
+	idTallyInit(&tally);
+	observer.counts = &counts;
+	observer.failed = 0;
+	tally.observer = countNgrams;
+	tally.observerArg = &observer;
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	for ( ; i < argc; i++) {
+		ngramStartText(&counts);
+		if (tsIsStreamName(argv[i]))
+			status = tallyTokenStream(argv[i], &table, &tally, MAX_WORD_LEN);
+		else
+			status = tallyInternedWordsInFile(argv[i], &table, &tally,
+					MAX_WORD_LEN);
+		if ( ! status || observer.failed) {
+			fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+					argv[i]);
+			return 1;
+		}
+		nFiles++;
+	}
+	seconds = secondsSince(&startTime);
+
+	if (nFiles == 0) {
+		fprintf(stderr, "No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+
+	printf("%lu %d-grams counted from %d files in %lf seconds"
+			" : %.2f million n-grams/sec\n",
+			(unsigned long) counts.nNgrams, n, nFiles, seconds,
+			(seconds > 0) ? counts.nNgrams / seconds / 1e6 : 0.0);
+	printNgramReport(&counts, &table, nTop, printHapax);
+
+	ngramFree(&counts);
+	idTallyFree(&tally);
+	internFree(&table);
+	return 0;
+}
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "out_writer.h"
+
+
+/** write all of the pieces in iov, carrying on after partial writes */
+static int
+writeAll_(int fd, struct iovec *iov, int nPieces)
+{
+	ssize_t nWritten;
+
+	while (nPieces > 0) {
+		nWritten = writev(fd, iov, nPieces);
+		if (nWritten < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		while (nPieces > 0 && (size_t) nWritten >= iov->iov_len) {
+			nWritten -= iov->iov_len;
+			iov++;
+			nPieces--;
+		}
+		if (nPieces > 0) {
+			iov->iov_base = (char *) iov->iov_base + nWritten;
+			iov->iov_len -= nWritten;
+		}
+	}
+	return 0;
+}
+
+
+int
+owInit(OutWriter *ow, int fd, size_t bufferSize)
+{
+	if (bufferSize == 0)
+		bufferSize = OW_DEFAULT_BUFFER_SIZE;
+
+	ow->buffer = (char *) malloc(bufferSize);
+	if (ow->buffer == NULL)
+		return -1;
+	ow->fd = fd;
+	ow->size = bufferSize;
+	ow->used = 0;
+	ow->nBytes = 0;
+	ow->error = 0;
+	return 0;
+}
+
+
+int
+owInitMemory(OutWriter *ow, size_t bufferSize)
+{
+	if (owInit(ow, -1, bufferSize) < 0)
+		return -1;
+	return 0;
+}
+
+
+/** make room in a memory writer for n more bytes */
+static int
+grow_(OutWriter *ow, size_t n)
+{
+	size_t newSize = ow->size;
+	char *newBuffer;
+
+	while (newSize < ow->used + n)
+		newSize *= 2;
+	newBuffer = (char *) realloc(ow->buffer, newSize);
+	if (newBuffer == NULL) {
+		ow->error = 1;
+		return -1;
+	}
+	ow->buffer = newBuffer;
+	ow->size = newSize;
+	return 0;
+}
+
+
+int
+owFlush(OutWriter *ow)
+{
+	struct iovec iov;
+
+	if (ow->fd < 0)
+		return ow->error ? -1 : 0;
+
+	if (ow->used > 0 && !ow->error) {
+		iov.iov_base = ow->buffer;
+		iov.iov_len = ow->used;
+		if (writeAll_(ow->fd, &iov, 1) < 0)
+			ow->error = 1;
+	}
+	ow->used = 0;
+	return ow->error ? -1 : 0;
+}
+
+
+void
+owWrite(OutWriter *ow, const char *p, size_t n)
+{
+	struct iovec iov[2];
+
+	ow->nBytes += n;
+	if (ow->used + n <= ow->size) {
+		memcpy(ow->buffer + ow->used, p, n);
+		ow->used += n;
+		return;
+	}
+
+	if (ow->fd < 0) {
+		if (grow_(ow, n) == 0) {
+			memcpy(ow->buffer + ow->used, p, n);
+			ow->used += n;
+		}
+		return;
+	}
+
+	/** too big to gather: send it along with what is buffered */
+	if (n >= ow->size) {
+		iov[0].iov_base = ow->buffer;
+		iov[0].iov_len = ow->used;
+		iov[1].iov_base = (void *) p;
+		iov[1].iov_len = n;
+		if (!ow->error && writeAll_(ow->fd, iov, 2) < 0)
+			ow->error = 1;
+		ow->used = 0;
+		return;
+	}
+
+	owFlush(ow);
+	memcpy(ow->buffer, p, n);
+	ow->used = n;
+}
+
+
+void
+owPuts(OutWriter *ow, const char *s)
+{
+	owWrite(ow, s, strlen(s));
+}
+
+
+void
+owPutc(OutWriter *ow, int c)
+{
+	char ch = (char) c;
+
+	if (ow->used == ow->size) {
+		owWrite(ow, &ch, 1);
+		return;
+	}
+	ow->buffer[ow->used++] = ch;
+	ow->nBytes++;
+}
+
+
+void
+owPutLong(OutWriter *ow, long value)
+{
+	char digits[24], *p = digits + sizeof(digits);
+	unsigned long magnitude;
+
+	/** negate as unsigned, so that LONG_MIN is handled */
+	magnitude = (value < 0) ? 0UL - (unsigned long) value
+			: (unsigned long) value;
+	do {
+		*--p = (char) ('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude > 0);
+	if (value < 0)
+		*--p = '-';
+
+	owWrite(ow, p, digits + sizeof(digits) - p);
+}
+
+
+int
+owClose(OutWriter *ow)
+{
+	int status = owFlush(ow);
+
+	free(ow->buffer);
+	ow->buffer = NULL;
+	ow->size = 0;
+	return status;
+}
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+#include "spsc_ring.h"
+
+
+int
+ringInit(SPSCRing *ring, unsigned long capacity)
+{
+	unsigned long size = 1;
+
+	while (size < capacity)
+		size <<= 1;
+
+	ring->slots = (void **) malloc(size * sizeof(void *));
+	if (ring->slots == NULL)
+		return -1;
+	ring->mask = size - 1;
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	return 0;
+}
+
+
+int
+ringTryPush(SPSCRing *ring, void *item)
+{
+	unsigned long tail, head;
+
+	tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	if (tail - head > ring->mask)
+		return 0;
+
+	ring->slots[tail & ring->mask] = item;
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+	return 1;
+}
+
+
+void *
+ringTryPop(SPSCRing *ring)
+{
+	unsigned long head, tail;
+	void *item;
+
+	head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	if (head == tail)
+		return NULL;
+
+	item = ring->slots[head & ring->mask];
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+	return item;
+}
+
+
+void
+ringPush(SPSCRing *ring, void *item)
+{
+	while ( ! ringTryPush(ring, item))
+		sched_yield();
+}
+
+
+void *
+ringPop(SPSCRing *ring)
+{
+	void *item;
+
+	while ((item = ringTryPop(ring)) == NULL)
+		sched_yield();
+	return item;
+}
+
+
+void
+ringDestroy(SPSCRing *ring)
+{
+	free(ring->slots);
+	ring->slots = NULL;
+}
@@ -0,0 +1,52 @@
+
+#ifndef	__SPSC_RING_HEADER__
+#define	__SPSC_RING_HEADER__
+
+#include <stdatomic.h>
+
+/**
+ * A lock-free single producer, single consumer ring of pointers.
+ *
+ * The producer only ever advances tail and the consumer only head,
+ * each publishing its slot with a release store that the other side
+ * reads with an acquire load, so no locks are needed.  The two
+ * counters are kept on separate cache lines so that the two threads
+ * do not keep stealing one line from each other.
+ *
+ * A full ring makes ringPush() wait, which is how a fast producer is
+ * held back (backpressure) until its consumer catches up.
+ */
+
+#define	RING_CACHE_LINE		64
+
+typedef struct SPSCRing {
+	void **slots;
+	unsigned long mask;		/* capacity - 1; the capacity is a power of two */
+	_Atomic unsigned long head __attribute__((aligned(RING_CACHE_LINE)));
+	_Atomic unsigned long tail __attribute__((aligned(RING_CACHE_LINE)));
+} SPSCRing;
+
+/**
+ * set up an empty ring holding up to capacity items, which is
+ * rounded up to a power of two
+ *
+ * Returns 0, or -1 if the slots cannot be allocated
+ */
+int ringInit(SPSCRing *ring, unsigned long capacity);
+
+/** add item unless the ring is full; returns 1 if it was added */
+int ringTryPush(SPSCRing *ring, void *item);
+
+/** remove the oldest item, or return NULL if the ring is empty */
+void *ringTryPop(SPSCRing *ring);
+
+/** add item, waiting for room if the ring is full */
+void ringPush(SPSCRing *ring, void *item);
+
+/** remove the oldest item, waiting for one if the ring is empty */
+void *ringPop(SPSCRing *ring);
+
+/** release the slots */
+void ringDestroy(SPSCRing *ring);
+
+#endif /* __SPSC_RING_HEADER__ */
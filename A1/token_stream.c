@@ -0,0 +1,391 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "token_stream.h"
+#include "intern_table.h"
+#include "word_extractor.h"
+#include "hash64.h"
+#include "util.h"
+
+/** words are taken from the extractor this many at a time */
+#define	TOKEN_READ_WORDS		256
+
+#define	TOKEN_CHECKSUM_SEED		0
+
+/** the longest varint of a 32-bit id */
+#define	TOKEN_MAX_VARINT		5
+
+/** a word id and how often it occurs, for ranking the words */
+typedef struct RankedWord {
+	uint32_t count;
+	uint32_t id;
+} RankedWord;
+
+
+char *
+tsDictName(const char *streamName)
+{
+	char *dictName;
+
+	dictName = (char *) reallocOrDie(NULL, strlen(streamName)
+			+ strlen(TOKEN_DICT_SUFFIX) + 1);
+	strcpy(dictName, streamName);
+	strcat(dictName, TOKEN_DICT_SUFFIX);
+	return dictName;
+}
+
+
+int
+tsIsStreamName(const char *filename)
+{
+	size_t length = strlen(filename), suffixLength = strlen(TOKEN_STREAM_SUFFIX);
+
+	return length > suffixLength && strcmp(filename + length - suffixLength,
+			TOKEN_STREAM_SUFFIX) == 0;
+}
+
+
+/** most frequent first, and in order of first appearance among equals */
+static int
+compareRanks_(const void *a, const void *b)
+{
+	const RankedWord *left = (const RankedWord *) a;
+	const RankedWord *right = (const RankedWord *) b;
+
+	if (left->count != right->count)
+		return (left->count > right->count) ? -1 : 1;
+	return (left->id < right->id) ? -1 : (left->id > right->id);
+}
+
+
+/** write header and then data to filename.  Returns 1 on success */
+static int
+writeFile_(const char *filename, const void *header, size_t headerSize,
+		const void *data, size_t dataSize)
+{
+	char *tmpName;
+	FILE *ofp;
+
+	if ((ofp = tempFileOpen(filename, "wb", &tmpName)) == NULL) {
+		fprintf(stderr, "Failure creating %s : %s\n",
+				filename, strerror(errno));
+		return 0;
+	}
+	return tempFileCommit(ofp, tmpName, filename,
+			fwrite(header, 1, headerSize, ofp) == headerSize
+			&& fwrite(data, 1, dataSize, ofp) == dataSize);
+}
+
+
+int
+tsEncodeFile(char *filename, int maxLen, const char *streamName,
+		TokenStreamStats *stats)
+{
+	struct WordExtractor *wordExtractor;
+	TokenStreamHeader streamHeader;
+	TokenDictHeader dictHeader;
+	InternTable table;
+	RankedWord *ranks;
+	uint32_t *tokens = NULL, *newIds;
+	unsigned char *varints;
+	char *words[TOKEN_READ_WORDS], *readBuffer, *text, *dictName;
+	size_t nTokens = 0, nAllocated = 0, textSize = 0, dataSize = 0, i;
+	int j, nRead, readBufferSize = TOKEN_READ_WORDS * (maxLen + 1);
+	int status;
+
+	wordExtractor = weCreateExtractor(filename, maxLen);
+	if (wordExtractor == NULL) {
+		fprintf(stderr, "Failed creating extractor for '%s'\n", filename);
+		return 0;
+	}
+
+	/** tokenize, giving ids in order of first appearance */
+	internInit(&table);
+	readBuffer = (char *) reallocOrDie(NULL, readBufferSize);
+	while ((nRead = weGetWordBatch(wordExtractor, words, TOKEN_READ_WORDS,
+			readBuffer, readBufferSize)) > 0) {
+		if (nTokens + nRead > nAllocated) {
+			nAllocated = (nAllocated == 0) ? 64 * 1024 : nAllocated * 2;
+			tokens = (uint32_t *) reallocOrDie(tokens,
+					nAllocated * sizeof(uint32_t));
+		}
+		for (j = 0; j < nRead; j++)
+			tokens[nTokens++] = internWord(&table, words[j]);
+	}
+	free(readBuffer);
+	weDeleteExtractor(wordExtractor);
+
+	/** then renumber the words, commonest first */
+	ranks = (RankedWord *) reallocOrDie(NULL,
+			(internSize(&table) + 1) * sizeof(RankedWord));
+	newIds = (uint32_t *) reallocOrDie(NULL,
+			(internSize(&table) + 1) * sizeof(uint32_t));
+	for (i = 0; i < internSize(&table); i++) {
+		ranks[i].count = 0;
+		ranks[i].id = (uint32_t) i;
+	}
+	for (i = 0; i < nTokens; i++)
+		ranks[tokens[i]].count++;
+	qsort(ranks, internSize(&table), sizeof(RankedWord), compareRanks_);
+
+	text = (char *) reallocOrDie(NULL, table.nBytes + 1);
+	for (i = 0; i < internSize(&table); i++) {
+		newIds[ranks[i].id] = (uint32_t) i;
+		memcpy(text + textSize, internString(&table, ranks[i].id),
+				table.lengths[ranks[i].id] + 1);
+		textSize += table.lengths[ranks[i].id] + 1;
+	}
+
+	varints = (unsigned char *) reallocOrDie(NULL,
+			nTokens * TOKEN_MAX_VARINT + 1);
+	for (i = 0; i < nTokens; i++)
+		dataSize += putVarint(varints + dataSize, newIds[tokens[i]]);
+
+	memset(&dictHeader, 0, sizeof(dictHeader));
+	memcpy(dictHeader.magic, TOKEN_DICT_MAGIC, sizeof(dictHeader.magic));
+	dictHeader.byteOrder = TOKEN_STREAM_BYTE_ORDER;
+	dictHeader.headerSize = sizeof(TokenDictHeader);
+	dictHeader.nWords = internSize(&table);
+	dictHeader.maxLen = (uint32_t) maxLen;
+	dictHeader.textSize = textSize;
+	dictHeader.checksum = hash64(text, textSize, TOKEN_CHECKSUM_SEED);
+
+	memset(&streamHeader, 0, sizeof(streamHeader));
+	memcpy(streamHeader.magic, TOKEN_STREAM_MAGIC, sizeof(streamHeader.magic));
+	streamHeader.byteOrder = TOKEN_STREAM_BYTE_ORDER;
+	streamHeader.headerSize = sizeof(TokenStreamHeader);
+	streamHeader.nTokens = nTokens;
+	streamHeader.dataSize = dataSize;
+	streamHeader.dictChecksum = dictHeader.checksum;
+	streamHeader.checksum = hash64(varints, dataSize, TOKEN_CHECKSUM_SEED);
+
+	/** the dictionary goes first, so a stream always has its own */
+	dictName = tsDictName(streamName);
+	status = writeFile_(dictName, &dictHeader, sizeof(dictHeader),
+				text, textSize)
+			&& writeFile_(streamName, &streamHeader, sizeof(streamHeader),
+				varints, dataSize);
+
+	if (stats != NULL) {
+		stats->nTokens = nTokens;
+		stats->nWords = internSize(&table);
+		stats->textBytes = textSize;
+		stats->streamBytes = sizeof(streamHeader) + dataSize;
+		stats->dictBytes = sizeof(dictHeader) + textSize;
+	}
+
+	free(dictName);
+	free(varints);
+	free(text);
+	free(newIds);
+	free(ranks);
+	free(tokens);
+	internFree(&table);
+	return status;
+}
+
+
+/** map all of filename; returns 1 on success */
+static int
+mapFile_(const char *filename, void **address, size_t *size)
+{
+	struct stat sb;
+	int fd;
+
+	if ((fd = open(filename, O_RDONLY)) < 0) {
+		fprintf(stderr, "Failure opening %s : %s\n", filename, strerror(errno));
+		return 0;
+	}
+	if (fstat(fd, &sb) < 0 || sb.st_size == 0) {
+		close(fd);
+		fprintf(stderr, "Warning: '%s' is empty\n", filename);
+		return 0;
+	}
+	*address = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (*address == MAP_FAILED) {
+		*address = NULL;
+		return 0;
+	}
+	*size = (size_t) sb.st_size;
+	return 1;
+}
+
+
+/** check the mapped dictionary and index its words */
+static int
+loadDict_(TokenStream *ts, const char *dictName)
+{
+	TokenDictHeader header;
+	const char *text, *word, *end;
+	uint32_t i;
+
+	if (ts->dictMappingSize < sizeof(TokenDictHeader)) {
+		fprintf(stderr, "Warning: dictionary '%s' is truncated\n", dictName);
+		return 0;
+	}
+	memcpy(&header, ts->dictMapping, sizeof(header));
+	if (memcmp(header.magic, TOKEN_DICT_MAGIC, sizeof(header.magic)) != 0
+			|| header.byteOrder != TOKEN_STREAM_BYTE_ORDER
+			|| header.headerSize != sizeof(TokenDictHeader)) {
+		fprintf(stderr, "Warning: '%s' is not a token dictionary for this"
+				" machine\n", dictName);
+		return 0;
+	}
+	if (header.headerSize + header.textSize != ts->dictMappingSize) {
+		fprintf(stderr, "Warning: dictionary '%s' is truncated\n", dictName);
+		return 0;
+	}
+	text = (const char *) ts->dictMapping + header.headerSize;
+	if (hash64(text, header.textSize, TOKEN_CHECKSUM_SEED) != header.checksum) {
+		fprintf(stderr, "Warning: dictionary '%s' fails its checksum\n",
+				dictName);
+		return 0;
+	}
+
+	ts->nWords = header.nWords;
+	ts->maxLen = (int) header.maxLen;
+	ts->words = (const char **) reallocOrDie(NULL,
+			((size_t) header.nWords + 1) * sizeof(char *));
+	ts->lengths = (uint32_t *) reallocOrDie(NULL,
+			((size_t) header.nWords + 1) * sizeof(uint32_t));
+
+	word = text;
+	end = text + header.textSize;
+	for (i = 0; i < header.nWords; i++) {
+		if (word >= end || memchr(word, '\0', end - word) == NULL) {
+			fprintf(stderr, "Warning: dictionary '%s' is truncated\n",
+					dictName);
+			return 0;
+		}
+		ts->words[i] = word;
+		ts->lengths[i] = (uint32_t) strlen(word);
+		word += ts->lengths[i] + 1;
+	}
+	return 1;
+}
+
+
+/** check the mapped stream against its dictionary */
+static int
+checkStream_(TokenStream *ts, const char *streamName)
+{
+	TokenStreamHeader header;
+	TokenDictHeader *dictHeader = (TokenDictHeader *) ts->dictMapping;
+
+	if (ts->streamMappingSize < sizeof(TokenStreamHeader)) {
+		fprintf(stderr, "Warning: token stream '%s' is truncated\n",
+				streamName);
+		return 0;
+	}
+	memcpy(&header, ts->streamMapping, sizeof(header));
+	if (memcmp(header.magic, TOKEN_STREAM_MAGIC, sizeof(header.magic)) != 0
+			|| header.byteOrder != TOKEN_STREAM_BYTE_ORDER
+			|| header.headerSize != sizeof(TokenStreamHeader)) {
+		fprintf(stderr, "Warning: '%s' is not a token stream for this"
+				" machine\n", streamName);
+		return 0;
+	}
+	if (header.headerSize + header.dataSize != ts->streamMappingSize) {
+		fprintf(stderr, "Warning: token stream '%s' is truncated\n",
+				streamName);
+		return 0;
+	}
+	if (header.dictChecksum != dictHeader->checksum) {
+		fprintf(stderr, "Warning: token stream '%s' does not match its"
+				" dictionary\n", streamName);
+		return 0;
+	}
+
+	ts->data = (const unsigned char *) ts->streamMapping + header.headerSize;
+	ts->dataSize = header.dataSize;
+	ts->nTokens = header.nTokens;
+	if (hash64(ts->data, ts->dataSize, TOKEN_CHECKSUM_SEED) != header.checksum) {
+		fprintf(stderr, "Warning: token stream '%s' fails its checksum\n",
+				streamName);
+		return 0;
+	}
+	return 1;
+}
+
+
+int
+tsOpen(TokenStream *ts, const char *streamName)
+{
+	char *dictName;
+	int status;
+
+	memset(ts, 0, sizeof(*ts));
+	dictName = tsDictName(streamName);
+	status = mapFile_(dictName, &ts->dictMapping, &ts->dictMappingSize);
+	if (status)
+		status = loadDict_(ts, dictName);
+	if (status)
+		status = mapFile_(streamName, &ts->streamMapping,
+				&ts->streamMappingSize);
+	if (status)
+		status = checkStream_(ts, streamName);
+	free(dictName);
+
+	if (!status)
+		tsClose(ts);
+	return status;
+}
+
+
+size_t
+tsRead(TokenStream *ts, uint32_t *ids, size_t maxIds)
+{
+	const unsigned char *p = ts->data + ts->position;
+	const unsigned char *end = ts->data + ts->dataSize;
+	uint32_t value;
+	unsigned char byte;
+	size_t n = 0;
+	int shift;
+
+	while (n < maxIds && p < end) {
+		/** most ids are a single byte */
+		if (*p < 0x80) {
+			ids[n++] = *p++;
+			continue;
+		}
+
+		value = 0;
+		shift = 0;
+		do {
+			byte = *p++;
+			value |= (uint32_t) (byte & 0x7f) << shift;
+			shift += 7;
+		} while ((byte & 0x80) && p < end && shift < 7 * TOKEN_MAX_VARINT);
+		ids[n++] = value;
+	}
+
+	ts->position = p - ts->data;
+	return n;
+}
+
+
+void
+tsRewind(TokenStream *ts)
+{
+	ts->position = 0;
+}
+
+
+void
+tsClose(TokenStream *ts)
+{
+	if (ts->streamMapping != NULL)
+		munmap(ts->streamMapping, ts->streamMappingSize);
+	if (ts->dictMapping != NULL)
+		munmap(ts->dictMapping, ts->dictMappingSize);
+	free(ts->words);
+	free(ts->lengths);
+	memset(ts, 0, sizeof(*ts));
+}
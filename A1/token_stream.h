@@ -0,0 +1,117 @@
+#ifndef	__TOKEN_STREAM_HEADER__
+#define	__TOKEN_STREAM_HEADER__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A corpus tokenized once and kept as a stream of word ids, so that
+ * later analyses can read the ids straight out of memory rather than
+ * scanning the characters of the text again.
+ *
+ * Two files are written for each corpus:
+ *
+ *     <stream>        TokenStreamHeader, then the id of every word of
+ *                     the text in order, each as a LEB128 varint
+ *     <stream>dict    TokenDictHeader, then the words by id, each
+ *                     NUL terminated
+ *
+ * Ids are given in order of falling frequency, so the commonest 128
+ * words take one byte each and the next 16K two.  Both files carry a
+ * hash64() checksum of their contents, and the stream records the
+ * checksum of its dictionary so that a stream is never read with the
+ * wrong one.  The files are written in the byte order of the machine
+ * writing them, and are rejected by a machine of the other order.
+ */
+
+#define	TOKEN_STREAM_SUFFIX		".tok"
+#define	TOKEN_DICT_SUFFIX		"dict"
+#define	TOKEN_STREAM_MAGIC		"TOKSTR01"
+#define	TOKEN_DICT_MAGIC		"TOKDIC01"
+#define	TOKEN_STREAM_BYTE_ORDER	0x01020304
+
+typedef struct TokenStreamHeader {
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t headerSize;
+	uint64_t nTokens;
+	uint64_t dataSize;
+	uint64_t dictChecksum;
+	uint64_t checksum;		/* hash64() of the varints */
+} TokenStreamHeader;
+
+typedef struct TokenDictHeader {
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t headerSize;
+	uint32_t nWords;
+	uint32_t maxLen;		/* the word length the text was read with */
+	uint64_t textSize;
+	uint64_t checksum;		/* hash64() of the words */
+} TokenDictHeader;
+
+typedef struct TokenStream {
+	const unsigned char *data;	/* the varints */
+	size_t dataSize;
+	size_t position;			/* where tsRead() continues from */
+	uint64_t nTokens;
+	const char **words;			/* [nWords], by id */
+	uint32_t *lengths;			/* [nWords], by id */
+	uint32_t nWords;
+	int maxLen;
+	void *streamMapping;
+	size_t streamMappingSize;
+	void *dictMapping;
+	size_t dictMappingSize;
+} TokenStream;
+
+typedef struct TokenStreamStats {
+	uint64_t nTokens;
+	uint32_t nWords;
+	size_t textBytes;
+	size_t streamBytes;
+	size_t dictBytes;
+} TokenStreamStats;
+
+/**
+ * the name of the dictionary kept beside streamName; free() it when
+ * done
+ */
+char *tsDictName(const char *streamName);
+
+/** whether filename names a token stream (by its suffix) */
+int tsIsStreamName(const char *filename);
+
+/**
+ * Tokenize filename with the word extractor, reading words of up to
+ * maxLen letters, and write the stream to streamName and its
+ * dictionary beside it.  Both are written under temporary names and
+ * renamed into place.  stats may be NULL.
+ *
+ * Returns 1 on success, or 0 on failure
+ */
+int tsEncodeFile(char *filename, int maxLen, const char *streamName,
+		TokenStreamStats *stats);
+
+/**
+ * Map the stream written to streamName, and its dictionary, into ts,
+ * ready to be read from the first token.
+ *
+ * Returns 1 on success, or 0 if either cannot be read or is not intact
+ */
+int tsOpen(TokenStream *ts, const char *streamName);
+
+/**
+ * Decode up to maxIds further ids into ids.
+ *
+ * Returns the number decoded, or 0 at the end of the stream
+ */
+size_t tsRead(TokenStream *ts, uint32_t *ids, size_t maxIds);
+
+/** start reading again from the first token */
+void tsRewind(TokenStream *ts);
+
+/** release the mappings */
+void tsClose(TokenStream *ts);
+
+#endif /* __TOKEN_STREAM_HEADER__ */
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "word_extractor.h"
+#include "intern_table.h"
+#include "token_stream.h"
+#include "util.h"
+
+// define the maximum length of word we will look for
+#define	MAX_WORD_LEN	24
+
+// words and ids are read this many at a time
+#define	READ_WORDS		256
+
+
+/**
+ * Time counting the words of filename by tokenizing the text again,
+ * as each analysis does without a stream.  Returns the seconds taken,
+ * or -1 on failure
+ */
+static double
+timeTokenizing(char *filename, unsigned long *nTokens)
+{
+	struct WordExtractor *wordExtractor;
+	struct timespec startTime;
+	InternTable table;
+	uint32_t *counts = NULL, nAllocated = 0, oldSize, id;
+	char *words[READ_WORDS], buffer[READ_WORDS * (MAX_WORD_LEN + 1)];
+	double seconds;
+	int i, nRead;
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	wordExtractor = weCreateExtractor(filename, MAX_WORD_LEN);
+	if (wordExtractor == NULL)
+		return -1;
+
+	internInit(&table);
+	*nTokens = 0;
+	while ((nRead = weGetWordBatch(wordExtractor, words, READ_WORDS,
+			buffer, sizeof(buffer))) > 0) {
+		for (i = 0; i < nRead; i++) {
+			id = internWord(&table, words[i]);
+			if (id >= nAllocated) {
+				oldSize = nAllocated;
+				nAllocated = (nAllocated == 0) ? 1024 : nAllocated * 2;
+				counts = (uint32_t *) realloc(counts,
+						nAllocated * sizeof(uint32_t));
+				if (counts == NULL) {
+					fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+					exit(1);
+				}
+				memset(counts + oldSize, 0,
+						(nAllocated - oldSize) * sizeof(uint32_t));
+			}
+			counts[id]++;
+		}
+		*nTokens += nRead;
+	}
+	weDeleteExtractor(wordExtractor);
+	seconds = secondsSince(&startTime);
+
+	free(counts);
+	internFree(&table);
+	return seconds;
+}
+
+
+/**
+ * Time counting the words of the stream by reading their ids.
+ * Returns the seconds taken, or -1 on failure
+ */
+static double
+timeStreaming(char *streamName, unsigned long *nTokens)
+{
+	TokenStream stream;
+	struct timespec startTime;
+	uint32_t *counts, ids[READ_WORDS];
+	double seconds;
+	size_t i, nRead;
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	if ( ! tsOpen(&stream, streamName))
+		return -1;
+
+	counts = (uint32_t *) calloc(stream.nWords + 1, sizeof(uint32_t));
+	if (counts == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	*nTokens = 0;
+	while ((nRead = tsRead(&stream, ids, READ_WORDS)) > 0) {
+		for (i = 0; i < nRead; i++)
+			if (ids[i] < stream.nWords)
+				counts[ids[i]]++;
+		*nTokens += nRead;
+	}
+	seconds = secondsSince(&startTime);
+
+	free(counts);
+	tsClose(&stream);
+	return seconds;
+}
+
+
+static int
+encodeFile(char *filename, int benchmark)
+{
+	TokenStreamStats stats;
+	struct timespec startTime;
+	char *streamName;
+	unsigned long nTextTokens, nStreamTokens;
+	double seconds, textSeconds, streamSeconds;
+	int status;
+
+	streamName = (char *) malloc(strlen(filename)
+			+ strlen(TOKEN_STREAM_SUFFIX) + 1);
+	if (streamName == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	strcpy(streamName, filename);
+	strcat(streamName, TOKEN_STREAM_SUFFIX);
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	status = tsEncodeFile(filename, MAX_WORD_LEN, streamName, &stats);
+	seconds = secondsSince(&startTime);
+	if (status) {
+		printf("%s: %lu tokens, %u distinct words, in %lf seconds\n",
+				streamName, (unsigned long) stats.nTokens, stats.nWords,
+				seconds);
+		printf("    stream %lu bytes (%.2f bytes/token),"
+				" dictionary %lu bytes\n",
+				(unsigned long) stats.streamBytes,
+				(stats.nTokens > 0)
+					? (double) stats.streamBytes / stats.nTokens : 0.0,
+				(unsigned long) stats.dictBytes);
+	}
+
+	if (status && benchmark) {
+		textSeconds = timeTokenizing(filename, &nTextTokens);
+		streamSeconds = timeStreaming(streamName, &nStreamTokens);
+		if (textSeconds < 0 || streamSeconds < 0
+				|| nTextTokens != nStreamTokens) {
+			fprintf(stderr, "Error: '%s' does not read back as '%s'\n",
+					streamName, filename);
+			status = 0;
+		} else {
+			printf("    counting from text   : %lf seconds,"
+					" %.2f million tokens/sec\n", textSeconds,
+					(textSeconds > 0) ? nTextTokens / textSeconds / 1e6 : 0.0);
+			printf("    counting from stream : %lf seconds,"
+					" %.2f million tokens/sec\n", streamSeconds,
+					(streamSeconds > 0)
+						? nStreamTokens / streamSeconds / 1e6 : 0.0);
+		}
+	}
+
+	free(streamName);
+	return status;
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Tokenizes each file once into a stream of word ids, written as\n");
+	fprintf(stderr, "<file>.tok, with its dictionary as <file>.tokdict.  hapax reads\n");
+	fprintf(stderr, "a .tok file in place of the text.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-b : time counting the words from the text and from the stream.\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	int i, benchmark = 0, didProcessing = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			if (argv[i][1] == 'b') {
+				benchmark = 1;
+			} else {
+				fprintf(stderr, "Error: unknown option '%s'\n", argv[i]);
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			if (encodeFile(argv[i], benchmark) == 0) {
+				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+						argv[i]);
+				return 1;
+			}
+			didProcessing = 1;
+		}
+	}
+
+	if ( ! didProcessing ) {
+		fprintf(stderr, "No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+
+	return 0;
+}
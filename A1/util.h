@@ -0,0 +1,68 @@
+#ifndef	__UTIL_HEADER__
+#define	__UTIL_HEADER__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Small helpers shared by the tools and libraries of this assignment.
+ */
+
+/** the seconds elapsed on CLOCK_MONOTONIC since start */
+double secondsSince(struct timespec *start);
+
+/** realloc() that reports the failure and exits rather than return NULL */
+void *reallocOrDie(void *block, size_t size);
+
+/**
+ * Files are written under a temporary name and renamed into place, so
+ * a reader never sees a half written file.  tempFileOpen() opens the
+ * temporary for filename with the given fopen() mode, setting *tmpName;
+ * it returns NULL, with errno set and *tmpName freed, if that fails.
+ */
+FILE *tempFileOpen(const char *filename, const char *mode, char **tmpName);
+
+/**
+ * Close ofp and, if ok, rename tmpName over filename; otherwise, or if
+ * either step fails, remove the temporary.  tmpName is freed.  Returns
+ * 1 if filename now holds the new contents
+ */
+int tempFileCommit(FILE *ofp, char *tmpName, const char *filename, int ok);
+
+/** the longest varint of a 64-bit value */
+#define	MAX_VARINT_LEN		10
+
+/** append value to out as a LEB128 varint, returning the bytes used */
+static inline size_t
+putVarint(unsigned char *out, uint64_t value)
+{
+	size_t n = 0;
+
+	while (value >= 0x80) {
+		out[n++] = (unsigned char) (value | 0x80);
+		value >>= 7;
+	}
+	out[n++] = (unsigned char) value;
+	return n;
+}
+
+/** decode the varint at *in, advancing *in past it */
+static inline uint64_t
+getVarint(const unsigned char **in)
+{
+	const unsigned char *p = *in;
+	uint64_t value = 0;
+	int shift = 0;
+
+	while (*p & 0x80) {
+		value |= (uint64_t) (*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	value |= (uint64_t) *p++ << shift;
+	*in = p;
+	return value;
+}
+
+#endif /* __UTIL_HEADER__ */
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "word_extractor.h"
+#include "frozen_dict.h"
+#include "util.h"
+
+// define the maximum length of word we will look for
+#define	MAX_WORD_LEN	24
+
+// words are read from the text this many at a time
+#define	READ_WORDS		256
+
+
+/**
+ * Read every word of filename into one block, returning the words
+ * one after another, each NUL terminated, and their number in nWords
+ * (which is -1 if the file cannot be read)
+ */
+static char *
+loadWords(char *filename, long *nWords)
+{
+	struct WordExtractor *wordExtractor;
+	char *words[READ_WORDS];
+	char buffer[READ_WORDS * (MAX_WORD_LEN + 1)];
+	char *text = NULL, *end;
+	size_t used = 0, allocated = 0, length;
+	int i, nRead;
+
+	*nWords = -1;
+	wordExtractor = weCreateExtractor(filename, MAX_WORD_LEN);
+	if (wordExtractor == NULL) {
+		fprintf(stderr, "Failed creating extractor for '%s'\n", filename);
+		return NULL;
+	}
+
+	*nWords = 0;
+	while ((nRead = weGetWordBatch(wordExtractor, words, READ_WORDS,
+			buffer, sizeof(buffer))) > 0) {
+		end = words[nRead - 1] + strlen(words[nRead - 1]) + 1;
+		length = end - words[0];
+		if (used + length > allocated) {
+			allocated = (allocated == 0) ? 64 * 1024 : allocated * 2;
+			while (used + length > allocated)
+				allocated *= 2;
+			text = (char *) realloc(text, allocated);
+			if (text == NULL) {
+				fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+				exit(1);
+			}
+		}
+		for (i = 0; i < nRead; i++) {
+			length = strlen(words[i]) + 1;
+			memcpy(text + used, words[i], length);
+			used += length;
+		}
+		*nWords += nRead;
+	}
+
+	weDeleteExtractor(wordExtractor);
+	return text;
+}
+
+
+/** look up every word of filename nRepeats times, timing the lookups */
+static int
+queryText(FrozenDict *dict, char *filename, int nRepeats)
+{
+	struct timespec startTime;
+	char *text, *word;
+	double seconds;
+	long i, nWords, nFound = 0;
+	int r;
+
+	text = loadWords(filename, &nWords);
+	if (nWords < 0)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	for (r = 0; r < nRepeats; r++) {
+		nFound = 0;
+		for (i = 0, word = text; i < nWords; i++) {
+			if (fdLookup(dict, word) > 0)
+				nFound++;
+			word += strlen(word) + 1;
+		}
+	}
+	seconds = secondsSince(&startTime);
+
+	printf("%s: %ld words, %ld found in the dictionary\n",
+			filename, nWords, nFound);
+	printf("    %ld lookups in %lf seconds : %.2f million lookups/sec\n",
+			nWords * nRepeats, seconds, (seconds > 0)
+				? nWords * nRepeats / seconds / 1e6 : 0.0);
+
+	free(text);
+	return 1;
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <vocabfile> [ <word> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Prints the count of each word in a dictionary written by 'hapax -F'.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-t <FILE> : look up every word of <FILE>, timing the lookups.\n");
+	fprintf(stderr, "-r <N>    : repeat the -t lookups <N> times (default 10).\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	FrozenDict dict;
+	char *textFile = NULL;
+	int i, nRepeats = 10;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (argv[i][1] == 't' && i + 1 < argc) {
+			textFile = argv[++i];
+		} else if (argv[i][1] == 'r' && i + 1 < argc) {
+			nRepeats = atoi(argv[++i]);
+			if (nRepeats < 1)
+				nRepeats = 1;
+		} else {
+			fprintf(stderr, "Error: unknown option '%s'\n", argv[i]);
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (i >= argc) {
+		fprintf(stderr, "No dictionary given -- provide the name of"
+				" a .vocab file on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+
+	if ( ! fdLoad(&dict, argv[i])) {
+		fprintf(stderr, "Error: cannot load dictionary '%s'\n", argv[i]);
+		return 1;
+	}
+	printf("%u words in '%s' (%lu bytes)\n", fdSize(&dict), argv[i],
+			(unsigned long) fdImageSize(&dict));
+
+	for (i++; i < argc; i++)
+		printf("    '%s' %d\n", argv[i], fdLookup(&dict, argv[i]));
+
+	if (textFile != NULL && ! queryText(&dict, textFile, nRepeats)) {
+		fdFree(&dict);
+		return 1;
+	}
+
+	fdFree(&dict);
+	return 0;
+}
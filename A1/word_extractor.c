@@ -9,6 +9,7 @@
 #include <ctype.h> // for isalpha()
 
 #include "word_extractor.h"
+#include "compressed_input.h"
 
 
 /**
@@ -36,8 +37,9 @@ weCreateExtractor(char *filename, int maxletters)
 	FILE *in;
 
 	/* try opening the file before anything else so that we don't
-	 * have a memory leak if this fails */
-	in = fopen(filename, "r");
+	 * have a memory leak if this fails.  Compressed files are
+	 * decompressed on the fly by ciOpen() */
+	in = ciOpen(filename);
 	if (in == NULL) {
 		fprintf(stderr, "Cannot open input file '%s' : %s\n",
 				filename, strerror(errno));
@@ -54,6 +56,10 @@ weCreateExtractor(char *filename, int maxletters)
 	we->pendingWord[0] = 0;
 	we->pendingWordLen = 0;
 	we->pendingWordMax = maxletters;
+	we->nextOffset = 0;
+	we->lineNumber = 1;
+	we->pendingWordOffset = 0;
+	we->pendingWordLine = 0;
 
 	return we;
 }
@@ -104,6 +110,53 @@ char * weGetNextWord(struct WordExtractor *we)
 	return nextWord;
 }
 
+/**
+ * Reads up to maxWords words into buffer, pointing words[] at them.
+ *
+ * @return the number of words read, or 0 if there are no more
+ */
+int weGetWordBatch(struct WordExtractor *we, char **words, int maxWords,
+		char *buffer, int bufferSize)
+{
+	return weGetWordBatchAt(we, words, NULL, maxWords, buffer, bufferSize);
+}
+
+/**
+ * As weGetWordBatch(), noting where each word was found if
+ * positions is not NULL
+ */
+int weGetWordBatchAt(struct WordExtractor *we, char **words,
+		WordPosition *positions, int maxWords, char *buffer, int bufferSize)
+{
+	int nWords = 0, used = 0;
+
+	flockfile(we->in);
+	while (nWords < maxWords && used + we->pendingWordMax + 1 <= bufferSize) {
+		if (we->hasSearchedForNextWord == 0)
+			scanForNextWord_(we);
+
+		if (we->pendingWordLen == 0) {
+			/* leave things as weHasMoreWords() would */
+			we->hasSearchedForNextWord = 1;
+			break;
+		}
+
+		memcpy(buffer + used, we->pendingWord, we->pendingWordLen + 1);
+		if (positions != NULL) {
+			positions[nWords].offset = we->pendingWordOffset;
+			positions[nWords].line = we->pendingWordLine;
+		}
+		words[nWords++] = buffer + used;
+		used += we->pendingWordLen + 1;
+
+		we->hasSearchedForNextWord = 0;
+		we->pendingWordLen = 0;
+	}
+	funlockfile(we->in);
+
+	return nWords;
+}
+
 /**
  * Clean up and deallocate
  */
@@ -138,10 +191,16 @@ static int getNextChar_(struct WordExtractor *we)
 		return nextChar;
 	}
 
-	nextChar = fgetc(we->in);
+	/* the stream is locked by our callers, once per word or batch */
+	nextChar = getc_unlocked(we->in);
 
-	if (nextChar < 0)
+	if (nextChar < 0) {
 		we->reachedEOF = 1;
+	} else {
+		we->nextOffset++;
+		if (nextChar == '\n')
+			we->lineNumber++;
+	}
 	return nextChar;
 }
 
@@ -162,13 +221,19 @@ static char *scanForNextWord_(struct WordExtractor *we)
 	int aChar;
 
 	we->pendingWordLen = 0;
+	flockfile(we->in);
 	while ((aChar = getNextChar_(we)) > 0) {
 		if (state == S_SKIP_LEADING) {
 			// if the character is not  letter, skip to next read
 			if ( ! isalpha(aChar))
 				continue;
 
+			/* a word never starts with a pushed back character, as
+			 * only non-letters are pushed back, so this letter was
+			 * the last one taken from the stream */
 			state = S_IN_LETTERS;
+			we->pendingWordOffset = we->nextOffset - 1;
+			we->pendingWordLine = we->lineNumber;
 			we->pendingWord[we->pendingWordLen++] = (char) aChar;
 
 		} else if ( isalpha(aChar)
@@ -188,11 +253,15 @@ static char *scanForNextWord_(struct WordExtractor *we)
 		} else {
 			pushChar_(we, aChar);
 			we->pendingWord[we->pendingWordLen] = '\0';
+			funlockfile(we->in);
 			return we->pendingWord;
 		}
 	}
+	funlockfile(we->in);
 
-	/** we have reached EOF, so return NULL */
+	/** we have reached EOF, so return NULL, but terminate any word
+	 * that ran up to the end of the file, as it is still handed out */
+	we->pendingWord[we->pendingWordLen] = '\0';
 	return NULL;
 }
 
@@ -20,8 +20,18 @@ struct WordExtractor {
 	int pendingWordMax;
 	int pendingWordLen;
 	int pushedChar;
+	long nextOffset;		/* bytes taken from the stream so far */
+	long lineNumber;		/* the line being read, counting from 1 */
+	long pendingWordOffset;
+	long pendingWordLine;
 };
 
+/** where a word was found: its byte offset in the text, and its line */
+typedef struct WordPosition {
+	long offset;
+	long line;
+} WordPosition;
+
 // Create an extractor based on a file to read
 struct WordExtractor *weCreateExtractor(char *filename, int maxletters);
 
@@ -43,6 +53,26 @@ int weHasMoreWords(struct WordExtractor *we);
  */
 char *weGetNextWord(struct WordExtractor *we);
 
+/**
+ * Reads up to maxWords words at once, copying each (NUL terminated)
+ * into buffer, which holds bufferSize bytes, and pointing words[] at
+ * the copies.  Fewer words are returned when the buffer has no room
+ * for another word of the longest length.  The stream is locked once
+ * for the whole batch rather than once per word.
+ *
+ * Returns the number of words read, or 0 if there are no more
+ */
+int weGetWordBatch(struct WordExtractor *we, char **words, int maxWords,
+		char *buffer, int bufferSize);
+
+/**
+ * As weGetWordBatch(), also filling in the position of each word in
+ * positions[], which must hold maxWords entries; offsets in a
+ * compressed file are those of the decompressed text
+ */
+int weGetWordBatchAt(struct WordExtractor *we, char **words,
+		WordPosition *positions, int maxWords, char *buffer, int bufferSize);
+
 /**
  * Clean up and deallocate
  */
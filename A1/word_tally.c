@@ -1,9 +1,24 @@
 #include <stdio.h>
 #include <stdlib.h> // for malloc(), free()
 #include <string.h>
+#include <pthread.h>
 
 #include "word_extractor.h"
 #include "word_tally.h"
+#include "spsc_ring.h"
+#include "token_stream.h"
+
+// Words are passed from the tokenizer to the tally threads in batches
+// of this many bytes, so that the rings are touched once per batch
+// rather than once per word
+#define TALLY_BATCH_BYTES   8192
+
+// Words are taken from the extractor this many at a time
+#define TALLY_READ_WORDS    256
+
+// The batches in flight for each tally thread; once all of them are
+// full the tokenizer waits for that thread to hand one back
+#define TALLY_RING_BATCHES  8
 
 // Forward declarations
 static int updateWordInTallyList(LLNode **wordLists, int maxLen, char *word);
@@ -27,8 +42,9 @@ int tallyWordsInFile(char *filename, LLNode **wordLists, int maxLen)
         return 0;
     }
 
-    // Ensure that all of the word list heads are NULL
-    for (int i = 0; i < maxLen; i++) {
+    // Ensure that all of the word list heads are NULL; there is
+    // one for each length from 0 up to and including maxLen
+    for (int i = 0; i <= maxLen; i++) {
         wordLists[i] = NULL;
     }
 
@@ -92,4 +108,353 @@ static int updateWordInTallyList(LLNode **wordListHeads, int maxLen, char *word)
 
     // Return success if no error
     return 1;
-}
\ No newline at end of file
+}
+
+
+// A run of words, each NUL terminated, packed one after another
+typedef struct WordBatch {
+    int nWords;
+    int nBytes;
+    int isLast;         // no more batches follow this one
+    char text[TALLY_BATCH_BYTES];
+} WordBatch;
+
+// One tally thread: it owns the lists for the lengths it is sent,
+// so no other thread ever touches them
+typedef struct TallyShard {
+    pthread_t thread;
+    SPSCRing full;      // batches to count, from the tokenizer
+    SPSCRing empty;     // counted batches, going back to be refilled
+    WordBatch *batches;
+    WordBatch *filling; // the batch the tokenizer is adding to
+    LLNode **wordLists;
+    int maxLen;
+} TallyShard;
+
+static void *tallyThread_(void *arg)
+{
+    TallyShard *shard = (TallyShard *) arg;
+    WordBatch *batch;
+    char *word;
+    int i, isLast;
+
+    do {
+        batch = (WordBatch *) ringPop(&shard->full);
+        word = batch->text;
+        for (i = 0; i < batch->nWords; i++) {
+            updateWordInTallyList(shard->wordLists, shard->maxLen, word);
+            word += strlen(word) + 1;
+        }
+        isLast = batch->isLast;
+        ringPush(&shard->empty, batch);
+    } while ( ! isLast);
+
+    return NULL;
+}
+
+// Pipelined version of tallyWordsInFile(): this thread reads and
+// tokenizes while nTallyThreads others update the lists.  Each word
+// goes to the thread for its length, so every list is built by one
+// thread from the words in file order, and ends up exactly as the
+// serial version would leave it.
+int tallyWordsInFilePipelined(char *filename, LLNode **wordLists, int maxLen,
+        int nTallyThreads)
+{
+    struct WordExtractor *wordExtractor = NULL;
+    TallyShard *shards, *shard;
+    WordBatch *batch;
+    char *words[TALLY_READ_WORDS], *readBuffer, *aWord;
+    int i, j, w, nWords, length, totalWordCount = 0, nStarted = 0;
+    int readBufferSize = TALLY_READ_WORDS * (maxLen + 1);
+
+    if (nTallyThreads < 1)
+        nTallyThreads = 1;
+    if (nTallyThreads > maxLen)
+        nTallyThreads = maxLen;
+
+    wordExtractor = weCreateExtractor(filename, maxLen);
+    if (wordExtractor == NULL) {
+        fprintf(stderr, "Failed creating extractor for '%s'\n", filename);
+        return 0;
+    }
+
+    for (i = 0; i <= maxLen; i++) {
+        wordLists[i] = NULL;
+    }
+
+    readBuffer = (char *) malloc(readBufferSize);
+    if (readBuffer == NULL) {
+        fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+        exit(1);
+    }
+
+    // Set up each shard with all of its batches waiting to be filled
+    shards = (TallyShard *) calloc(nTallyThreads, sizeof(TallyShard));
+    if (shards == NULL) {
+        fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+        exit(1);
+    }
+    for (i = 0; i < nTallyThreads; i++) {
+        shard = &shards[i];
+        shard->wordLists = wordLists;
+        shard->maxLen = maxLen;
+        shard->batches = (WordBatch *) malloc(TALLY_RING_BATCHES * sizeof(WordBatch));
+        if (shard->batches == NULL
+                || ringInit(&shard->full, TALLY_RING_BATCHES) < 0
+                || ringInit(&shard->empty, TALLY_RING_BATCHES) < 0) {
+            fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+            exit(1);
+        }
+        for (j = 1; j < TALLY_RING_BATCHES; j++) {
+            ringPush(&shard->empty, &shard->batches[j]);
+        }
+        shard->filling = &shard->batches[0];
+        shard->filling->nWords = shard->filling->nBytes = 0;
+        shard->filling->isLast = 0;
+    }
+
+    for (i = 0; i < nTallyThreads; i++) {
+        if (pthread_create(&shards[i].thread, NULL, tallyThread_, &shards[i]) != 0) {
+            fprintf(stderr, "Failed creating tally thread %d\n", i);
+            break;
+        }
+        nStarted++;
+    }
+
+    // Tokenize a batch at a time, dealing each word into the batch
+    // for its length; if a thread could not be started we still
+    // drain the file, but send nothing, so that the running threads
+    // can be shut down
+    while ((nWords = weGetWordBatch(wordExtractor, words, TALLY_READ_WORDS,
+            readBuffer, readBufferSize)) > 0) {
+        totalWordCount += nWords;
+        if (nStarted < nTallyThreads)
+            continue;
+
+        for (w = 0; w < nWords; w++) {
+            aWord = words[w];
+            length = strlen(aWord);
+            shard = &shards[length % nTallyThreads];
+            batch = shard->filling;
+            if (batch->nBytes + length + 1 > TALLY_BATCH_BYTES) {
+                ringPush(&shard->full, batch);
+                batch = shard->filling = (WordBatch *) ringPop(&shard->empty);
+                batch->nWords = batch->nBytes = 0;
+                batch->isLast = 0;
+            }
+            memcpy(batch->text + batch->nBytes, aWord, length + 1);
+            batch->nBytes += length + 1;
+            batch->nWords++;
+        }
+    }
+
+    // Send each thread what is left, marked as the end, and wait
+    for (i = 0; i < nStarted; i++) {
+        shards[i].filling->isLast = 1;
+        ringPush(&shards[i].full, shards[i].filling);
+    }
+    for (i = 0; i < nStarted; i++) {
+        pthread_join(shards[i].thread, NULL);
+    }
+
+    for (i = 0; i < nTallyThreads; i++) {
+        ringDestroy(&shards[i].full);
+        ringDestroy(&shards[i].empty);
+        free(shards[i].batches);
+    }
+    free(shards);
+    free(readBuffer);
+    weDeleteExtractor(wordExtractor);
+
+    if (nStarted < nTallyThreads) {
+        return 0;
+    }
+
+    printf("Total word count %d\n", totalWordCount);
+    return 1;
+}
+
+
+void idTallyInit(IdTally *tally)
+{
+    tally->counts = NULL;
+    tally->seen = NULL;
+    tally->nSeen = 0;
+    tally->nAllocated = 0;
+    tally->observer = NULL;
+    tally->observerArg = NULL;
+}
+
+void idTallyFree(IdTally *tally)
+{
+    free(tally->counts);
+    free(tally->seen);
+    idTallyInit(tally);
+}
+
+// Make room for ids up to nIds - 1; the new counts start at zero
+static void growIdTally(IdTally *tally, uint32_t nIds)
+{
+    uint32_t oldSize = tally->nAllocated;
+
+    if (nIds <= oldSize) {
+        return;
+    }
+    tally->nAllocated = (oldSize == 0) ? 1024 : oldSize;
+    while (tally->nAllocated < nIds) {
+        tally->nAllocated *= 2;
+    }
+
+    tally->counts = (uint32_t *) realloc(tally->counts,
+            tally->nAllocated * sizeof(uint32_t));
+    tally->seen = (uint32_t *) realloc(tally->seen,
+            tally->nAllocated * sizeof(uint32_t));
+    if (tally->counts == NULL || tally->seen == NULL) {
+        fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+        exit(1);
+    }
+    memset(tally->counts + oldSize, 0,
+            (tally->nAllocated - oldSize) * sizeof(uint32_t));
+}
+
+// Count one id of the current file, by its id in the intern table
+static inline void countId(IdTally *tally, uint32_t id)
+{
+    growIdTally(tally, id + 1);
+    if (tally->counts[id]++ == 0) {
+        tally->seen[tally->nSeen++] = id;
+    }
+}
+
+// Clear only the counts the last file set
+static void clearIdTally(IdTally *tally)
+{
+    uint32_t i;
+
+    for (i = 0; i < tally->nSeen; i++) {
+        tally->counts[tally->seen[i]] = 0;
+    }
+    tally->nSeen = 0;
+}
+
+// Interning version of tallyWordsInFile(): each word is looked up
+// once in the shared table, and its count is then just an array
+// element, so no word is copied again once any file has used it
+int tallyInternedWordsInFile(char *filename, InternTable *table,
+        IdTally *tally, int maxLen)
+{
+    struct WordExtractor *wordExtractor = NULL;
+    char *words[TALLY_READ_WORDS], *readBuffer;
+    uint32_t ids[TALLY_READ_WORDS];
+    int i, nWords, totalWordCount = 0;
+    int readBufferSize = TALLY_READ_WORDS * (maxLen + 1);
+
+    wordExtractor = weCreateExtractor(filename, maxLen);
+    if (wordExtractor == NULL) {
+        fprintf(stderr, "Failed creating extractor for '%s'\n", filename);
+        return 0;
+    }
+
+    readBuffer = (char *) malloc(readBufferSize);
+    if (readBuffer == NULL) {
+        fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+        exit(1);
+    }
+
+    clearIdTally(tally);
+
+    while ((nWords = weGetWordBatch(wordExtractor, words, TALLY_READ_WORDS,
+            readBuffer, readBufferSize)) > 0) {
+        for (i = 0; i < nWords; i++) {
+            ids[i] = internWord(table, words[i]);
+            countId(tally, ids[i]);
+        }
+        if (tally->observer != NULL) {
+            (*tally->observer)(tally->observerArg, ids, nWords);
+        }
+        totalWordCount += nWords;
+    }
+
+    free(readBuffer);
+    weDeleteExtractor(wordExtractor);
+
+    printf("Total word count %d\n", totalWordCount);
+    return 1;
+}
+
+// Token stream version of tallyInternedWordsInFile(): the stream's
+// ids are its own, so each is interned in the shared table the first
+// time it comes up, which gives the table the same words in the same
+// order as tokenizing the text would have
+int tallyTokenStream(char *streamName, InternTable *table, IdTally *tally,
+        int maxLen)
+{
+    TokenStream stream;
+    uint32_t ids[TALLY_READ_WORDS], *tableIds, i;
+    size_t j, nIds;
+    int status = 1;
+
+    if (!tsOpen(&stream, streamName)) {
+        return 0;
+    }
+
+    tableIds = (uint32_t *) malloc((stream.nWords + 1) * sizeof(uint32_t));
+    if (tableIds == NULL) {
+        fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+        exit(1);
+    }
+    for (i = 0; i < stream.nWords; i++) {
+        tableIds[i] = INTERN_NONE;
+    }
+
+    clearIdTally(tally);
+
+    while (status && (nIds = tsRead(&stream, ids, TALLY_READ_WORDS)) > 0) {
+        for (j = 0; j < nIds; j++) {
+            if (ids[j] >= stream.nWords) {
+                fprintf(stderr, "Error: '%s' holds an unknown word id\n", streamName);
+                status = 0;
+                break;
+            }
+            if (tableIds[ids[j]] == INTERN_NONE) {
+                tableIds[ids[j]] = internWord(table, stream.words[ids[j]]);
+            }
+            ids[j] = tableIds[ids[j]];
+            countId(tally, ids[j]);
+        }
+        if (status && tally->observer != NULL) {
+            (*tally->observer)(tally->observerArg, ids, (int) nIds);
+        }
+    }
+
+    if (status) {
+        printf("Total word count %lu\n", (unsigned long) stream.nTokens);
+    }
+    free(tableIds);
+    tsClose(&stream);
+    return status;
+}
+
+void idTallyToWordLists(IdTally *tally, InternTable *table, LLNode **wordLists,
+        int maxLen)
+{
+    LLNode *node;
+    uint32_t i, id;
+    int length;
+
+    for (i = 0; i <= (uint32_t) maxLen; i++) {
+        wordLists[i] = NULL;
+    }
+
+    // Adding each word to the front of its list in the order the
+    // words were first seen gives the order the list tally builds
+    for (i = 0; i < tally->nSeen; i++) {
+        id = tally->seen[i];
+        length = (int) table->lengths[id];
+        if (length > maxLen) {
+            continue;
+        }
+        node = llNewNode((char *) internString(table, id), (int) tally->counts[id]);
+        wordLists[length] = llPrepend(wordLists[length], node);
+    }
+}
@@ -2,7 +2,31 @@
 #ifndef	__WORD_TALLY_HEADER__
 #define	__WORD_TALLY_HEADER__
 
+#include <stdint.h>
+
 #include "LLNode.h"
+#include "intern_table.h"
+
+/**
+ * A tally kept by interned word id rather than in lists: counts[id]
+ * is the number of times the word with that id has been seen, and
+ * seen[] holds the ids of the words counted, in the order they were
+ * first seen, so that the counts can be cleared for the next file
+ * without touching the rest of the array
+ *
+ * If observer is set, it is also given the ids of the words of each
+ * file, a batch at a time, in the order they appear in the text
+ */
+typedef void (*IdObserver)(void *arg, const uint32_t *ids, int nIds);
+
+typedef struct IdTally {
+    uint32_t *counts;
+    uint32_t *seen;
+    uint32_t nSeen;
+    uint32_t nAllocated;
+    IdObserver observer;
+    void *observerArg;
+} IdTally;
 
 
 /**
@@ -10,4 +34,42 @@
  */
 int tallyWordsInFile(char *filename, LLNode **wordLists, int maxLen);
 
+/**
+ * as tallyWordsInFile(), but reading and tokenizing on this thread
+ * while nTallyThreads other threads update the lists; the words are
+ * handed over through lock-free rings, and each thread is sent the
+ * words of the lengths it owns, so the lists come out the same
+ */
+int tallyWordsInFilePipelined(char *filename, LLNode **wordLists, int maxLen,
+        int nTallyThreads);
+
+/** set up an empty id tally */
+void idTallyInit(IdTally *tally);
+
+/** release the arrays of an id tally */
+void idTallyFree(IdTally *tally);
+
+/**
+ * as tallyWordsInFile(), but counting by id: every word is interned
+ * in table, which may be shared with other files, and counted in
+ * tally, which is cleared first
+ */
+int tallyInternedWordsInFile(char *filename, InternTable *table,
+        IdTally *tally, int maxLen);
+
+/**
+ * as tallyInternedWordsInFile(), but reading the word ids of a token
+ * stream written by tsEncodeFile() rather than tokenizing a text
+ */
+int tallyTokenStream(char *streamName, InternTable *table, IdTally *tally,
+        int maxLen);
+
+/**
+ * build the per-length lists for a finished id tally, in the same
+ * order tallyWordsInFile() would have left them; the keys of the
+ * nodes are the interned copies, so free the lists without them
+ */
+void idTallyToWordLists(IdTally *tally, InternTable *table, LLNode **wordLists,
+        int maxLen);
+
 #endif
@@ -10,6 +10,7 @@
 #include <string.h>
 
 #include "LLvNode.h"
+#include "arena.h"
 
 
 /*
@@ -33,6 +34,25 @@ llNewNode(char *key, void *value)
 }
 
 
+/*
+ * llNewNodeInArena: as llNewNode, but the node comes from arena
+ * and so is released with the arena rather than by llFree()
+ */
+LLvNode *
+llNewNodeInArena(Arena *arena, char *key, void *value)
+{
+	LLvNode *newp;
+
+	newp = (LLvNode *) arenaAlloc(arena, sizeof(LLvNode));
+
+	newp->key = key;
+	newp->value = value;
+	newp->next = NULL;
+
+	return newp;
+}
+
+
 /*
  * llAppend: add newp to end of listp
  *
@@ -69,6 +89,34 @@ llPrepend(LLvNode *listp, LLvNode *newp)
 }
 
 
+/*
+ * llInsertByIndexOrder: place newp in listp in ascending order of
+ * key, after any nodes with an equal key
+ *
+ * this walks the list, so is O(n) for each insert; the skip list
+ * in A2 keeps a large collection ordered more cheaply
+ *
+ * as above, we always return the value that
+ * should be the new head of the list
+ */
+LLvNode *
+llInsertByIndexOrder(LLvNode *listp, LLvNode *newp)
+{
+	LLvNode *p;
+
+	if (listp == NULL || strcmp(newp->key, listp->key) < 0)
+		return llPrepend(listp, newp);
+
+	for (p = listp; p->next != NULL
+			&& strcmp(p->next->key, newp->key) <= 0; p = p->next)
+		;
+
+	newp->next = p->next;
+	p->next = newp;
+	return listp;
+}
+
+
 /* llLookupKey: sequential search for key in listp */
 LLvNode *
 llLookupKey(LLvNode *listp, char *key)
@@ -25,13 +25,17 @@ struct LLvNode {
 /* llNewNode: create and initialize data */
 LLvNode *llNewNode(char *key, void *value);
 
+/* llNewNodeInArena: as llNewNode, but allocating from arena */
+struct Arena;
+LLvNode *llNewNodeInArena(struct Arena *arena, char *key, void *value);
+
 /* llPrepend: add newp to front of list */
 LLvNode *llPrepend(LLvNode *listp, LLvNode *newp);
 
 /* llAppend: add newp to end of listp */
 LLvNode *llAppend(LLvNode *listp, LLvNode *newp);
 
-/* llInsertSort: place the value in the list according to index ordering */
+/* llInsertByIndexOrder: place newp in listp in ascending key order */
 LLvNode *llInsertByIndexOrder(LLvNode *listp, LLvNode *newp);
 
 /* llLookupKey: sequential search for name in listp */
@@ -0,0 +1,138 @@
+/**
+ * Allocation tracking by interposition, see alloc_track.h
+ *
+ * The counters are updated with atomic builtins so that worker
+ * threads may allocate freely while being counted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "alloc_track.h"
+
+/** the real allocator entry points, resolved by the linker */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void  __real_free(void *ptr);
+char *__real_strdup(const char *s);
+
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+void  __wrap_free(void *ptr);
+char *__wrap_strdup(const char *s);
+
+static ATStats counters_;
+
+
+#define	AT_ADD(field, n)	__atomic_add_fetch(&counters_.field, (n), \
+									__ATOMIC_RELAXED)
+
+/** account for a new block of usable size n */
+static void
+noteAllocated_(size_t n)
+{
+	long live, peak;
+
+	AT_ADD(bytesAllocated, n);
+	live = AT_ADD(bytesLive, (long) n);
+
+	peak = __atomic_load_n(&counters_.peakBytes, __ATOMIC_RELAXED);
+	while (live > peak
+			&& ! __atomic_compare_exchange_n(&counters_.peakBytes, &peak,
+					live, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+static void
+noteFreed_(size_t n)
+{
+	AT_ADD(bytesLive, -(long) n);
+}
+
+
+void *
+__wrap_malloc(size_t size)
+{
+	void *p = __real_malloc(size);
+
+	AT_ADD(mallocCalls, 1);
+	if (p != NULL)
+		noteAllocated_(malloc_usable_size(p));
+	return p;
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size)
+{
+	void *p = __real_calloc(nmemb, size);
+
+	AT_ADD(callocCalls, 1);
+	if (p != NULL)
+		noteAllocated_(malloc_usable_size(p));
+	return p;
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+	size_t oldSize = malloc_usable_size(ptr);
+	void *p;
+
+	p = __real_realloc(ptr, size);
+
+	AT_ADD(reallocCalls, 1);
+	if (p == NULL && size != 0)
+		return NULL; /* ptr is untouched */
+
+	noteFreed_(oldSize);
+	if (p != NULL)
+		noteAllocated_(malloc_usable_size(p));
+
+	/** a move means the allocator copied the old contents */
+	if (ptr != NULL && p != NULL && p != ptr) {
+		AT_ADD(reallocMoves, 1);
+		AT_ADD(reallocBytesCopied, (oldSize < size) ? oldSize : size);
+	}
+	return p;
+}
+
+void
+__wrap_free(void *ptr)
+{
+	if (ptr == NULL)
+		return;
+	AT_ADD(freeCalls, 1);
+	noteFreed_(malloc_usable_size(ptr));
+	__real_free(ptr);
+}
+
+char *
+__wrap_strdup(const char *s)
+{
+	char *p = __real_strdup(s);
+
+	AT_ADD(strdupCalls, 1);
+	if (p != NULL)
+		noteAllocated_(malloc_usable_size(p));
+	return p;
+}
+
+
+void
+atSnapshot(ATStats *stats)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	*stats = counters_;
+}
+
+void
+atResetPeak(void)
+{
+	__atomic_store_n(&counters_.peakBytes,
+			__atomic_load_n(&counters_.bytesLive, __ATOMIC_RELAXED),
+			__ATOMIC_RELAXED);
+}
@@ -0,0 +1,39 @@
+
+#ifndef	__ALLOC_TRACK_HEADER__
+#define	__ALLOC_TRACK_HEADER__
+
+/**
+ * Allocation tracking by interposition.
+ *
+ * Programs linked with
+ *     -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free,--wrap=strdup
+ * have every one of those calls made from our own object files routed
+ * through the __wrap_ functions in alloc_track.c, which count the calls
+ * and keep track of the bytes live, the peak, and the bytes copied when
+ * realloc() has to move a block.  Allocations made inside the C library
+ * itself (stdio buffers and the like) are not seen.
+ *
+ * Sizes are taken from malloc_usable_size(3), so they include the
+ * allocator's rounding; this is the memory actually tied up.
+ */
+
+typedef struct ATStats {
+	unsigned long mallocCalls;
+	unsigned long callocCalls;
+	unsigned long reallocCalls;
+	unsigned long strdupCalls;
+	unsigned long freeCalls;
+	unsigned long reallocMoves;
+	unsigned long bytesAllocated;
+	unsigned long reallocBytesCopied;
+	long bytesLive;
+	long peakBytes;
+} ATStats;
+
+/** copy the current counters into stats */
+void atSnapshot(ATStats *stats);
+
+/** restart peak tracking from the current number of live bytes */
+void atResetPeak(void);
+
+#endif /* __ALLOC_TRACK_HEADER__ */
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+
+/** round n up to the next multiple of ARENA_ALIGNMENT */
+static size_t
+alignUp_(size_t n)
+{
+	return (n + (ARENA_ALIGNMENT - 1)) & ~((size_t) ARENA_ALIGNMENT - 1);
+}
+
+static ArenaChunk *
+newChunk_(Arena *arena, size_t size)
+{
+	ArenaChunk *chunk;
+
+	chunk = (ArenaChunk *) malloc(sizeof(ArenaChunk) + size);
+	if (chunk == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+
+	arena->nChunks++;
+	arena->bytesReserved += size;
+
+	return chunk;
+}
+
+
+Arena *
+arenaCreate(size_t chunkSize)
+{
+	Arena *arena;
+
+	arena = (Arena *) malloc(sizeof(Arena));
+	if (arena == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+
+	arena->chunkSize = alignUp_((chunkSize > 0)
+			? chunkSize : ARENA_DEFAULT_CHUNK_SIZE);
+	arena->nChunks = 0;
+	arena->bytesRequested = 0;
+	arena->bytesReserved = 0;
+	arena->current = newChunk_(arena, arena->chunkSize);
+
+	return arena;
+}
+
+
+void *
+arenaAlloc(Arena *arena, size_t size)
+{
+	ArenaChunk *chunk = arena->current;
+	void *p;
+
+	size = alignUp_(size);
+	arena->bytesRequested += size;
+
+	if (chunk->used + size > chunk->size) {
+		if (size > arena->chunkSize / 4) {
+			/**
+			 * A large request gets a chunk of its own, linked in
+			 * behind the current one so that the space left in the
+			 * current chunk is not abandoned
+			 */
+			chunk = newChunk_(arena, size);
+			chunk->next = arena->current->next;
+			arena->current->next = chunk;
+			chunk->used = size;
+			return chunk->data;
+		}
+
+		chunk = newChunk_(arena, arena->chunkSize);
+		chunk->next = arena->current;
+		arena->current = chunk;
+	}
+
+	p = chunk->data + chunk->used;
+	chunk->used += size;
+	return p;
+}
+
+
+int
+arenaUnwind(Arena *arena, void *p, size_t size)
+{
+	ArenaChunk *chunk = arena->current;
+
+	size = alignUp_(size);
+	if (size > chunk->used || (char *) p != chunk->data + chunk->used - size)
+		return 0;
+
+	chunk->used -= size;
+	arena->bytesRequested -= size;
+	return 1;
+}
+
+
+char *
+arenaStrdup(Arena *arena, const char *s)
+{
+	size_t len = strlen(s) + 1;
+	char *copy;
+
+	copy = (char *) arenaAlloc(arena, len);
+	memcpy(copy, s, len);
+	return copy;
+}
+
+
+void
+arenaDestroy(Arena *arena)
+{
+	ArenaChunk *chunk, *next;
+
+	for (chunk = arena->current; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+	free(arena);
+}
@@ -0,0 +1,61 @@
+
+#ifndef	__ARENA_HEADER__
+#define	__ARENA_HEADER__
+
+#include <stddef.h>
+
+/**
+ * A region ("arena") allocator.
+ *
+ * Memory is handed out from large chunks obtained with malloc(),
+ * by simply advancing a pointer.  Individual allocations are never
+ * freed; instead the whole arena is released at once with
+ * arenaDestroy(), which costs one free() per chunk rather than one
+ * per object.  This suits a loaded FASTA file, whose records all
+ * live and die together.
+ */
+
+/** the default chunk size, used when 0 is passed to arenaCreate() */
+#define	ARENA_DEFAULT_CHUNK_SIZE	(1024 * 1024)
+
+/** all allocations are aligned to this many bytes */
+#define	ARENA_ALIGNMENT		16
+
+typedef struct ArenaChunk {
+	struct ArenaChunk *next;
+	size_t size;
+	size_t used;
+	char data[] __attribute__((aligned(ARENA_ALIGNMENT)));
+} ArenaChunk;
+
+typedef struct Arena {
+	ArenaChunk *current;
+	size_t chunkSize;
+	size_t nChunks;
+	size_t bytesRequested;
+	size_t bytesReserved;
+} Arena;
+
+/** create an arena handing out memory from chunks of chunkSize bytes */
+Arena *arenaCreate(size_t chunkSize);
+
+/** allocate size bytes, aligned to ARENA_ALIGNMENT */
+void *arenaAlloc(Arena *arena, size_t size);
+
+/**
+ * Give back the most recent allocation, p of size bytes, so that the
+ * space is handed out again by the next arenaAlloc().  This lets a
+ * caller that built something speculatively in the arena drop it.
+ *
+ * Returns 1 if the space was reclaimed, or 0 if p was not the most
+ * recent allocation from the current chunk (it is then simply kept)
+ */
+int arenaUnwind(Arena *arena, void *p, size_t size);
+
+/** copy a string into the arena */
+char *arenaStrdup(Arena *arena, const char *s);
+
+/** release every allocation made from the arena, and the arena */
+void arenaDestroy(Arena *arena);
+
+#endif /* __ARENA_HEADER__ */
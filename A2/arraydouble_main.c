@@ -5,6 +5,15 @@
 #include <errno.h>
 
 #include "fasta.h"
+#include "compressed_input.h"
+#include "benchmark.h"
+#include "fasta_profile.h"
+#include "arena.h"
+#include "out_writer.h"
+
+/** where -w writes the loaded records, and whether -s uses stdio */
+static char *printFile = NULL;
+static int printWithStdio = 0;
 
 void doubleArraySize(FASTArecord **array, int *arraySize) // Uses pointers to modify array size and the instance of FASTArecord to modify data outside the function and double the array size
 {
@@ -21,15 +30,84 @@ void doubleArraySize(FASTArecord **array, int *arraySize) // Uses pointers to mo
 }
 
 
-int processFasta(char *filename, double *timeTaken)
+/**
+ * Release the loaded records: all at once with their arena, if they
+ * were taken from one, and otherwise one record at a time
+ */
+static void
+freeRecords(FASTArecord *records, int nRecords, Arena *arena)
+{
+	int i;
+
+	if (arena != NULL) {
+		arenaDestroy(arena);
+	} else {
+		for (i = 0; i < nRecords; i++)
+			fastaClearRecord(&records[i]);
+	}
+	free(records);
+}
+
+
+/**
+ * Print every record, as fastaPrintRecord() does, to printFile,
+ * noting how long it took in sample
+ */
+static int
+printRecords(FASTArecord *records, int nRecords, BMSample *sample)
+{
+	OutWriter writer;
+	BMTimer outputTimer;
+	FILE *ofp;
+	int i, status;
+
+	bmTimerStart(&outputTimer);
+	if ((ofp = fopen(printFile, "w")) == NULL) {
+		fprintf(stderr, "Error: cannot create '%s' : %s\n",
+				printFile, strerror(errno));
+		return -1;
+	}
+
+	if (printWithStdio) {
+		for (i = 0; i < nRecords; i++)
+			fastaPrintRecord(ofp, &records[i]);
+		fflush(ofp);
+		sample->outputBytes = (double) ftell(ofp);
+		status = ferror(ofp) ? -1 : 0;
+	} else {
+		if (owInit(&writer, fileno(ofp), 0) < 0) {
+			fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+			exit(1);
+		}
+		for (i = 0; i < nRecords; i++)
+			fastaPrintRecordBuffered(&writer, &records[i]);
+		sample->outputBytes = (double) writer.nBytes;
+		status = owClose(&writer);
+	}
+	if (fclose(ofp) != 0)
+		status = -1;
+
+	sample->outputSeconds = bmTimerElapsed(&outputTimer);
+	if (sample->outputSeconds > 0)
+		sample->outputMBPerSecond = sample->outputBytes
+				/ sample->outputSeconds / 1e6;
+	if (status < 0)
+		fprintf(stderr, "Error: writing '%s' failed\n", printFile);
+	return status;
+}
+
+
+int processFasta(char *filename, BMOptions *options, BMSample *sample)
 {
 	FILE *fp;
 	FASTArecord fRecord;
 	int lineNumber = 0, recordNumber = 0, status;
 	int eofSeen = 0;
-	clock_t startTime, endTime;
+	BMTimer timer, freeTimer;
+	FPTimer phaseTimer;
+	Arena *arena = NULL;
 
-	fp = fopen(filename, "r");
+	fp = ciOpen(filename);
 	if (fp == NULL) {
 		fprintf(stderr, "Failure opening %s : %s\n",
 				filename, strerror(errno));
@@ -46,8 +124,13 @@ int processFasta(char *filename, double *timeTaken)
 	}
 
 
+	/** with -A the record strings all come from one arena, freed in
+	 * one go; otherwise each is strdup()ed and freed on its own */
+	if (options->useArena)
+		arena = arenaCreate(0);
+
 	/** record the time now, before we do the work */
-	startTime = clock();
+	bmTimerStart(&timer);
 
 	//size_t allocatedMemoryTotal = (*size) * sizeof(FASTArecord); // Calculate total allocated memory
 	//size_t memoryUsed = recordNumber * sizeof(FASTArecord); // Calculate memory used
@@ -76,7 +159,7 @@ int processFasta(char *filename, double *timeTaken)
 
 		fastaInitializeRecord(&fRecord);
 
-		status = fastaReadRecord(fp, &fRecord);
+		status = fastaReadRecordInArena(fp, &fRecord, arena);
 		if (status == 0) {
 			eofSeen = 1;
 
@@ -84,10 +167,12 @@ int processFasta(char *filename, double *timeTaken)
 			lineNumber += status;
 			recordNumber++;
 
+		fpStart(&phaseTimer);
 		if (recordNumber == (initialArraySize - 1)) {   // Check if the array is full
 			doubleArraySize(&dynamicArray, &initialArraySize); // Double the array size
 		}
 		dynamicArray[recordNumber - 1] = fRecord; // Store parsed record into larger array
+		fpStop(&phaseTimer, FP_CONTAINER, sizeof(FASTArecord));
 
 
 			//fastaPrintRecord(stdout, &fRecord);
@@ -95,7 +180,7 @@ int processFasta(char *filename, double *timeTaken)
 			fprintf(stderr, "status = %d\n", status);
 			fprintf(stderr, "Error: failure at line %d of '%s'\n",
 					lineNumber, filename);
-			free(dynamicArray);   // even if there is an error free allocated memory
+			freeRecords(dynamicArray, recordNumber, arena);   // even if there is an error free allocated memory
 			return -1;
 		}
 
@@ -109,55 +194,30 @@ int processFasta(char *filename, double *timeTaken)
 	printf(" %d FASTA records -- %zu allocated (%.3f%% waste)\n",recordNumber, memoryUsed, wastedMemory);  // Print total allocated memory and wasted space
 	//printf(" %d FASTA records -- %zu allocated (%.3f%% waste)\n", recordNumber, allocatedMemoryTotal, *wastedMemoryPercentage); 
 
-	/** record the time now, when the work is done,
-	 *  and calculate the difference*/
-	endTime = clock();
-
-	(*timeTaken) = ((double) (endTime - startTime)) / CLOCKS_PER_SEC;
+	/** record the time now, when the work is done */
+	bmTimerStop(&timer, sample);
 
 	fclose(fp);
 
-	// free memory outside of iteration loop
-	for (int i = 0; i < recordNumber; i++) {
-		fastaClearRecord(&dynamicArray[i]);
+	/** write the records back out, timed apart from the load */
+	if (printFile != NULL
+			&& printRecords(dynamicArray, recordNumber, sample) < 0) {
+		freeRecords(dynamicArray, recordNumber, arena);
+		return -1;
 	}
 
-	free(dynamicArray);  // Free memory used in dynamic array
+	// free memory outside of iteration loop
+	bmTimerStart(&freeTimer);
+	fpStart(&phaseTimer);
+	freeRecords(dynamicArray, recordNumber, arena);  // Free memory used in dynamic array
+	fpStop(&phaseTimer, FP_TEARDOWN, memoryUsed);
+	sample->freeSeconds = bmTimerElapsed(&freeTimer);
 	//free(wastedMemoryPercentage); // Free memory used in wasted memory variable
 
 	return recordNumber;
 }
 
 
-int processFastaRepeatedly(
-		char *filename,
-		long repeatsRequested
-	)
-{
-	double timeThisIterationInSeconds;
-	double totalTimeInSeconds = 0;
-	int minutesPortion;
-	int status;
-	long i;
-
-	for (i = 0; i < repeatsRequested; i++) {
-		status = processFasta(filename, &timeThisIterationInSeconds);
-		if (status < 0)	return -1;
-		totalTimeInSeconds += timeThisIterationInSeconds;
-	}
-
-	printf("%lf seconds taken for processing total\n", totalTimeInSeconds);
-
-	totalTimeInSeconds /= (double) repeatsRequested;
-
-	minutesPortion = (int) (totalTimeInSeconds / 60);
-	totalTimeInSeconds = totalTimeInSeconds - (60 * minutesPortion);
-	printf("On average: %d minutes, %lf second per run\n",
-            minutesPortion, totalTimeInSeconds);
-
-	return status;
-}
-
 void usage(char *progname)
 {
 	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
@@ -165,8 +225,11 @@ void usage(char *progname)
 	fprintf(stderr, "Prints timing of loading and storing FASTA records.\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Options: \n");
-	fprintf(stderr, "-R <REPEATS> : Number of times to repeat load.\n");
-	fprintf(stderr, "             : Time reported will be average time.\n");
+	fprintf(stderr, "-w <FILE>    : Print every record loaded to FILE, timing\n");
+	fprintf(stderr, "             : the output apart from the load.\n");
+	fprintf(stderr, "-s           : Print with stdio rather than the buffered\n");
+	fprintf(stderr, "             : writer, for comparison.\n");
+	bmUsage(stderr);
 	fprintf(stderr, "\n");
 }
 
@@ -177,30 +240,34 @@ void usage(char *progname)
  */
 int main(int argc, char **argv)
 {
-	int i, recordsProcessed = 0;
-	long repeatsRequested = 1;
+	BMOptions options;
+	int i, status, recordsProcessed = 0;
+
+	bmInitOptions(&options, argv[0]);
 
 	for (i = 1; i < argc; i++) {
-		if (argv[i][0] == '-') {
-			if (argv[i][1] == 'R') {
-				if (i >= argc) {
-					fprintf(stderr,
-							"Error: need argument for repeats requested\n");
-					return 1;
-				}
-				if (sscanf(argv[++i], "%ld", &repeatsRequested) != 1) {
-					fprintf(stderr,
-							"Error: cannot parse repeats requested from '%s'\n",
-							argv[i]);
-					return 1;
-				}
-			} else {
+		if (strcmp(argv[i], "-w") == 0) {
+			if (i + 1 >= argc) {
+				fprintf(stderr, "Error: option '-w' needs a FILE argument\n");
+				usage(argv[0]);
+				return 1;
+			}
+			printFile = argv[++i];
+			options.reportOutput = 1;
+		} else if (strcmp(argv[i], "-s") == 0) {
+			printWithStdio = 1;
+		} else if (argv[i][0] == '-') {
+			status = bmParseOption(&options, argc, argv, &i);
+			if (status < 0) {
+				return 1;
+			} else if (status == 0) {
 				fprintf(stderr,
 						"Error: unknown option '%s'\n", argv[i]);
 				usage(argv[0]);
 			}
 		} else {
-			recordsProcessed = processFastaRepeatedly(argv[i], repeatsRequested);
+			recordsProcessed = bmProcessRepeatedly(argv[i], &options,
+					processFasta);
 			if (recordsProcessed < 0) {
 				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
 						argv[i]);
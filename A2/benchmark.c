@@ -0,0 +1,503 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <errno.h>
+
+#include "benchmark.h"
+#include "fasta_profile.h"
+#include "alloc_track.h"
+
+
+/**
+ * The metrics we summarize, each of which is a double stored
+ * within a BMSample.  Adding a field to BMSample and a line here
+ * is all that is needed to have it reported in every format.
+ */
+typedef struct BMMetric {
+	const char *name;
+	size_t offset;
+	int isCount;
+	int isOutput;	/* only reported for loaders writing their records */
+} BMMetric;
+
+static const BMMetric metrics_[] = {
+	{ "wall",         offsetof(BMSample, wallSeconds), 0, 0 },
+	{ "user",         offsetof(BMSample, userSeconds), 0, 0 },
+	{ "sys",          offsetof(BMSample, sysSeconds), 0, 0 },
+	{ "free",         offsetof(BMSample, freeSeconds), 0, 0 },
+	{ "allocs",       offsetof(BMSample, allocCalls), 1, 0 },
+	{ "frees",        offsetof(BMSample, freeCalls), 1, 0 },
+	{ "peak_bytes",   offsetof(BMSample, peakBytes), 1, 0 },
+	{ "realloc_copy", offsetof(BMSample, reallocCopiedBytes), 1, 0 },
+	{ "output",       offsetof(BMSample, outputSeconds), 0, 1 },
+	{ "output_bytes", offsetof(BMSample, outputBytes), 1, 1 },
+	{ "output_mb/s",  offsetof(BMSample, outputMBPerSecond), 0, 1 },
+};
+#define	N_METRICS	((int) (sizeof(metrics_) / sizeof(metrics_[0])))
+
+typedef struct BMStats {
+	double min;
+	double median;
+	double p95;
+	double mean;
+	double stddev;
+} BMStats;
+
+
+void
+bmInitOptions(BMOptions *options, char *programName)
+{
+	char *lastSlash = strrchr(programName, '/');
+
+	/** report "arraydouble" rather than "./arraydouble" */
+	options->programName = (lastSlash != NULL) ? lastSlash + 1 : programName;
+	options->repeats = 1;
+	options->warmups = 0;
+	options->format = BM_FORMAT_TEXT;
+	options->outputFile = NULL;
+	options->profile = 0;
+	options->useArena = 0;
+	options->reportOutput = 0;
+}
+
+
+/** fetch the argument that must follow option argv[*argIndex] */
+static char *
+optionArgument_(int argc, char **argv, int *argIndex)
+{
+	/** allow both "-R 5" and "-R5" */
+	if (argv[*argIndex][2] != '\0')
+		return &argv[*argIndex][2];
+
+	if (*argIndex + 1 >= argc) {
+		fprintf(stderr, "Error: option '%s' needs an argument\n",
+				argv[*argIndex]);
+		return NULL;
+	}
+	return argv[++(*argIndex)];
+}
+
+int
+bmParseOption(BMOptions *options, int argc, char **argv, int *argIndex)
+{
+	char *arg = argv[*argIndex];
+	char *value;
+
+	if (arg[0] != '-')
+		return 0;
+
+	switch (arg[1]) {
+	case 'R':
+		if ((value = optionArgument_(argc, argv, argIndex)) == NULL)
+			return -1;
+		if (sscanf(value, "%ld", &options->repeats) != 1
+				|| options->repeats < 1) {
+			fprintf(stderr,
+					"Error: cannot parse repeats requested from '%s'\n",
+					value);
+			return -1;
+		}
+		return 1;
+
+	case 'W':
+		if ((value = optionArgument_(argc, argv, argIndex)) == NULL)
+			return -1;
+		if (sscanf(value, "%ld", &options->warmups) != 1
+				|| options->warmups < 0) {
+			fprintf(stderr,
+					"Error: cannot parse warm-up count from '%s'\n", value);
+			return -1;
+		}
+		return 1;
+
+	case 'F':
+		if ((value = optionArgument_(argc, argv, argIndex)) == NULL)
+			return -1;
+		if (strcmp(value, "text") == 0) {
+			options->format = BM_FORMAT_TEXT;
+		} else if (strcmp(value, "csv") == 0) {
+			options->format = BM_FORMAT_CSV;
+		} else if (strcmp(value, "json") == 0) {
+			options->format = BM_FORMAT_JSON;
+		} else {
+			fprintf(stderr, "Error: unknown report format '%s'\n", value);
+			return -1;
+		}
+		return 1;
+
+	case 'P':
+		options->profile = 1;
+		return 1;
+
+	case 'A':
+		options->useArena = 1;
+		return 1;
+
+	case 'o':
+		if ((value = optionArgument_(argc, argv, argIndex)) == NULL)
+			return -1;
+		options->outputFile = value;
+		return 1;
+	}
+
+	return 0;
+}
+
+
+void
+bmUsage(FILE *ofp)
+{
+	fprintf(ofp, "-R <REPEATS> : Number of times to repeat load.\n");
+	fprintf(ofp, "             : Time reported will be average time.\n");
+	fprintf(ofp, "-W <WARMUPS> : Number of extra warm-up loads to run first;\n");
+	fprintf(ofp, "             : these are not included in the statistics.\n");
+	fprintf(ofp, "-F <FORMAT>  : Report format: text (default), csv or json.\n");
+	fprintf(ofp, "-o <FILE>    : Append the csv/json report to FILE instead\n");
+	fprintf(ofp, "             : of printing it on stdout (not for text).\n");
+	fprintf(ofp, "-P           : Print a per-phase breakdown of the load\n");
+	fprintf(ofp, "             : (needs a build with -DFASTA_PROFILE).\n");
+	fprintf(ofp, "-A           : Allocate the loaded records from an arena\n");
+	fprintf(ofp, "             : rather than one malloc() at a time.\n");
+}
+
+
+static double
+timespecSeconds_(struct timespec *ts)
+{
+	return (double) ts->tv_sec + ((double) ts->tv_nsec / 1e9);
+}
+
+static double
+timevalSeconds_(struct timeval *tv)
+{
+	return (double) tv->tv_sec + ((double) tv->tv_usec / 1e6);
+}
+
+void
+bmTimerStart(BMTimer *timer)
+{
+	getrusage(RUSAGE_SELF, &timer->usageStart);
+	clock_gettime(CLOCK_MONOTONIC, &timer->wallStart);
+}
+
+void
+bmTimerStop(BMTimer *timer, BMSample *sample)
+{
+	struct timespec wallEnd;
+	struct rusage usageEnd;
+
+	clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+	getrusage(RUSAGE_SELF, &usageEnd);
+
+	sample->wallSeconds = timespecSeconds_(&wallEnd)
+			- timespecSeconds_(&timer->wallStart);
+	sample->userSeconds = timevalSeconds_(&usageEnd.ru_utime)
+			- timevalSeconds_(&timer->usageStart.ru_utime);
+	sample->sysSeconds = timevalSeconds_(&usageEnd.ru_stime)
+			- timevalSeconds_(&timer->usageStart.ru_stime);
+}
+
+double
+bmTimerElapsed(BMTimer *timer)
+{
+	struct timespec wallEnd;
+
+	clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+	return timespecSeconds_(&wallEnd) - timespecSeconds_(&timer->wallStart);
+}
+
+
+/** whether metric belongs in the reports of this run */
+static int
+reported_(BMOptions *options, const BMMetric *metric)
+{
+	return ! metric->isOutput || options->reportOutput;
+}
+
+static double
+sampleValue_(BMSample *sample, const BMMetric *metric)
+{
+	return *(double *) ((char *) sample + metric->offset);
+}
+
+static int
+compareDoubles_(const void *a, const void *b)
+{
+	double da = *(const double *) a, db = *(const double *) b;
+	return (da > db) - (da < db);
+}
+
+/** nearest-rank percentile over an already sorted array */
+static double
+percentile_(double *sorted, long n, double pct)
+{
+	long rank = (long) ceil((pct / 100.0) * n);
+	if (rank < 1)
+		rank = 1;
+	return sorted[rank - 1];
+}
+
+static void
+computeStats_(BMSample *samples, long n, const BMMetric *metric,
+		BMStats *stats)
+{
+	double *values = (double *) malloc(n * sizeof(double));
+	double sum = 0, sumSq = 0;
+	long i;
+
+	for (i = 0; i < n; i++) {
+		values[i] = sampleValue_(&samples[i], metric);
+		sum += values[i];
+	}
+	qsort(values, n, sizeof(double), compareDoubles_);
+
+	stats->min = values[0];
+	stats->median = (n % 2) ? values[n / 2]
+			: (values[n / 2 - 1] + values[n / 2]) / 2.0;
+	stats->p95 = percentile_(values, n, 95.0);
+	stats->mean = sum / n;
+
+	for (i = 0; i < n; i++)
+		sumSq += (values[i] - stats->mean) * (values[i] - stats->mean);
+	stats->stddev = (n > 1) ? sqrt(sumSq / (n - 1)) : 0.0;
+
+	free(values);
+}
+
+
+/** how the loaded records were allocated, for the reports */
+static const char *
+allocatorName_(BMOptions *options)
+{
+	return options->useArena ? "arena" : "malloc";
+}
+
+
+/** print s as a JSON string, escaping as required */
+static void
+printJSONString_(FILE *ofp, const char *s)
+{
+	fputc('"', ofp);
+	for ( ; *s != '\0'; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(ofp, "\\%c", *s);
+		else if ((unsigned char) *s < 0x20)
+			fprintf(ofp, "\\u%04x", *s);
+		else
+			fputc(*s, ofp);
+	}
+	fputc('"', ofp);
+}
+
+static void
+reportText_(FILE *ofp, BMOptions *options, BMSample *samples, long n)
+{
+	BMStats stats;
+	double totalTimeInSeconds = 0;
+	int minutesPortion;
+	long i;
+	int m;
+
+	for (i = 0; i < n; i++)
+		totalTimeInSeconds += samples[i].wallSeconds;
+
+	fprintf(ofp, "%lf seconds taken for processing total\n",
+			totalTimeInSeconds);
+
+	totalTimeInSeconds /= (double) n;
+
+	minutesPortion = (int) (totalTimeInSeconds / 60);
+	totalTimeInSeconds = totalTimeInSeconds - (60 * minutesPortion);
+	fprintf(ofp, "On average: %d minutes, %lf second per run\n",
+			minutesPortion, totalTimeInSeconds);
+
+	fprintf(ofp, "Over %ld runs (%ld warm-up runs discarded, %s):\n",
+			n, options->warmups, allocatorName_(options));
+	for (m = 0; m < N_METRICS; m++) {
+		if ( ! reported_(options, &metrics_[m]))
+			continue;
+		computeStats_(samples, n, &metrics_[m], &stats);
+		if (metrics_[m].isCount) {
+			fprintf(ofp, "    %-12s min %.0f median %.0f p95 %.0f"
+					" mean %.1f stddev %.1f\n", metrics_[m].name,
+					stats.min, stats.median, stats.p95,
+					stats.mean, stats.stddev);
+		} else {
+			fprintf(ofp, "    %-12s min %lf median %lf p95 %lf"
+					" mean %lf stddev %lf\n", metrics_[m].name,
+					stats.min, stats.median, stats.p95,
+					stats.mean, stats.stddev);
+		}
+	}
+}
+
+/** print s as a quoted CSV field, doubling any quotes within it */
+static void
+printCSVString_(FILE *ofp, const char *s)
+{
+	fputc('"', ofp);
+	for ( ; *s != '\0'; s++) {
+		if (*s == '"')
+			fputc('"', ofp);
+		fputc(*s, ofp);
+	}
+	fputc('"', ofp);
+}
+
+static void
+reportCSV_(FILE *ofp, char *filename, BMOptions *options,
+		BMSample *samples, long n)
+{
+	BMStats stats;
+	int m;
+
+	/** only write the header into an empty file */
+	if (ftell(ofp) <= 0) {
+		fprintf(ofp, "program,allocator,file,records,runs,warmups,"
+				"metric,min,median,p95,mean,stddev\n");
+	}
+
+	for (m = 0; m < N_METRICS; m++) {
+		if ( ! reported_(options, &metrics_[m]))
+			continue;
+		computeStats_(samples, n, &metrics_[m], &stats);
+		fprintf(ofp, "%s,%s,", options->programName,
+				allocatorName_(options));
+		printCSVString_(ofp, filename);
+		fprintf(ofp, ",%ld,%ld,%ld,%s,%.9f,%.9f,%.9f,%.9f,%.9f\n",
+				samples[n - 1].nRecords,
+				n, options->warmups, metrics_[m].name,
+				stats.min, stats.median, stats.p95, stats.mean, stats.stddev);
+	}
+}
+
+/** one JSON object per line, so results can be appended to a file */
+static void
+reportJSON_(FILE *ofp, char *filename, BMOptions *options,
+		BMSample *samples, long n)
+{
+	BMStats stats;
+	long i;
+	int m;
+
+	fprintf(ofp, "{\"program\":");
+	printJSONString_(ofp, options->programName);
+	fprintf(ofp, ",\"allocator\":");
+	printJSONString_(ofp, allocatorName_(options));
+	fprintf(ofp, ",\"file\":");
+	printJSONString_(ofp, filename);
+	fprintf(ofp, ",\"records\":%ld,\"runs\":%ld,\"warmups\":%ld",
+			samples[n - 1].nRecords, n, options->warmups);
+
+	fprintf(ofp, ",\"metrics\":{");
+	for (m = 0; m < N_METRICS; m++) {
+		if ( ! reported_(options, &metrics_[m]))
+			continue;
+		computeStats_(samples, n, &metrics_[m], &stats);
+		fprintf(ofp, "%s\"%s\":{\"min\":%.9f,\"median\":%.9f,\"p95\":%.9f,"
+				"\"mean\":%.9f,\"stddev\":%.9f}", (m > 0) ? "," : "",
+				metrics_[m].name, stats.min, stats.median, stats.p95,
+				stats.mean, stats.stddev);
+	}
+
+	fprintf(ofp, "},\"iterations\":[");
+	for (i = 0; i < n; i++) {
+		fprintf(ofp, "%s{", (i > 0) ? "," : "");
+		for (m = 0; m < N_METRICS; m++) {
+			if ( ! reported_(options, &metrics_[m]))
+				continue;
+			fprintf(ofp, "%s\"%s\":%.9f", (m > 0) ? "," : "",
+					metrics_[m].name, sampleValue_(&samples[i], &metrics_[m]));
+		}
+		fprintf(ofp, "}");
+	}
+	fprintf(ofp, "]}\n");
+}
+
+
+/** fill in the allocator fields of sample from two snapshots */
+static void
+noteAllocations_(BMSample *sample, ATStats *before, ATStats *after)
+{
+	sample->allocCalls = (double) ((after->mallocCalls - before->mallocCalls)
+			+ (after->callocCalls - before->callocCalls)
+			+ (after->reallocCalls - before->reallocCalls)
+			+ (after->strdupCalls - before->strdupCalls));
+	sample->freeCalls = (double) (after->freeCalls - before->freeCalls);
+	sample->peakBytes = (double) (after->peakBytes - before->bytesLive);
+	sample->reallocCopiedBytes = (double)
+			(after->reallocBytesCopied - before->reallocBytesCopied);
+}
+
+
+int
+bmProcessRepeatedly(char *filename, BMOptions *options, BMProcessFn processFn)
+{
+	BMSample warmupSample, *samples;
+	ATStats allocBefore, allocAfter;
+	FILE *ofp = stdout;
+	int status = 0;
+	long i;
+
+	/** the text report always goes to stdout, so -o would be lost */
+	if (options->outputFile != NULL && options->format == BM_FORMAT_TEXT) {
+		fprintf(stderr, "Error: -o needs a csv or json report (-F)\n");
+		return -1;
+	}
+
+	for (i = 0; i < options->warmups; i++) {
+		status = (*processFn)(filename, options, &warmupSample);
+		if (status < 0)	return -1;
+	}
+
+	/** only the measured runs count towards the phase breakdown */
+	fpReset();
+
+	samples = (BMSample *) calloc(options->repeats, sizeof(BMSample));
+	for (i = 0; i < options->repeats; i++) {
+		atResetPeak();
+		atSnapshot(&allocBefore);
+		status = (*processFn)(filename, options, &samples[i]);
+		atSnapshot(&allocAfter);
+		if (status < 0) {
+			free(samples);
+			return -1;
+		}
+		samples[i].nRecords = status;
+		noteAllocations_(&samples[i], &allocBefore, &allocAfter);
+	}
+
+	/** the familiar summary always goes to stdout */
+	reportText_(stdout, options, samples, options->repeats);
+	if (options->profile) {
+		double totalWallSeconds = 0;
+		for (i = 0; i < options->repeats; i++)
+			totalWallSeconds += samples[i].wallSeconds;
+		fpReport(stdout, options->repeats, totalWallSeconds);
+	}
+
+	if (options->format != BM_FORMAT_TEXT) {
+		if (options->outputFile != NULL) {
+			ofp = fopen(options->outputFile, "a");
+			if (ofp == NULL) {
+				fprintf(stderr, "Failure opening %s : %s\n",
+						options->outputFile, strerror(errno));
+				free(samples);
+				return -1;
+			}
+		}
+
+		if (options->format == BM_FORMAT_CSV)
+			reportCSV_(ofp, filename, options, samples, options->repeats);
+		else
+			reportJSON_(ofp, filename, options, samples, options->repeats);
+
+		if (ofp != stdout)
+			fclose(ofp);
+	}
+
+	free(samples);
+	return status;
+}
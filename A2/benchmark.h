@@ -0,0 +1,110 @@
+
+#ifndef	__BENCHMARK_HEADER__
+#define	__BENCHMARK_HEADER__
+
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+/**
+ * Shared benchmarking harness for the FASTA loaders.
+ *
+ * Each loader provides a function that processes a file once and
+ * fills in a BMSample using a BMTimer around the work it wants
+ * measured.  bmProcessRepeatedly() then calls that function for the
+ * requested number of warm-up and measured iterations and reports
+ * min/median/p95/mean/stddev of the measured ones.
+ *
+ * The allocator counters from alloc_track.h are sampled around each
+ * iteration as well, so memory footprint and allocator pressure are
+ * reported next to the timing.
+ */
+
+/** values for BMOptions.format */
+#define	BM_FORMAT_TEXT	0
+#define	BM_FORMAT_CSV	1
+#define	BM_FORMAT_JSON	2
+
+/** the measurements taken for a single iteration */
+typedef struct BMSample {
+	double wallSeconds;
+	double userSeconds;
+	double sysSeconds;
+
+	/** time spent releasing the loaded collection, outside wallSeconds */
+	double freeSeconds;
+
+	/** allocator activity over the whole iteration, teardown included */
+	double allocCalls;
+	double freeCalls;
+	double peakBytes;
+	double reallocCopiedBytes;
+
+	/** writing the records back out, for loaders that do so */
+	double outputSeconds;
+	double outputBytes;
+	double outputMBPerSecond;
+
+	long nRecords;
+} BMSample;
+
+/** state captured at the start of a measured region */
+typedef struct BMTimer {
+	struct timespec wallStart;
+	struct rusage usageStart;
+} BMTimer;
+
+/** the command line controls of the harness */
+typedef struct BMOptions {
+	char *programName;
+	long repeats;
+	long warmups;
+	int format;
+	char *outputFile;
+	int profile;
+	int useArena;		/* take the loaded records from an arena */
+	int reportOutput;	/* the loader writes its records out, so
+						 * report the output metrics too */
+} BMOptions;
+
+/** the function type each loader supplies */
+typedef int (*BMProcessFn)(char *filename, BMOptions *options,
+		BMSample *sample);
+
+
+/**
+ * set up the default options: one run, no warm-up, text output,
+ * records allocated with malloc()
+ */
+void bmInitOptions(BMOptions *options, char *programName);
+
+/**
+ * Handle argv[*argIndex] if it is one of the harness options,
+ * advancing *argIndex past any option argument.
+ *
+ * Returns 1 if the option was consumed, 0 if it is not ours,
+ * or -1 if it was ours but malformed
+ */
+int  bmParseOption(BMOptions *options, int argc, char **argv, int *argIndex);
+
+/** print the harness options for a usage message */
+void bmUsage(FILE *ofp);
+
+/** mark the start and end of the region to be measured */
+void bmTimerStart(BMTimer *timer);
+void bmTimerStop(BMTimer *timer, BMSample *sample);
+
+/** wall clock seconds since bmTimerStart() */
+double bmTimerElapsed(BMTimer *timer);
+
+/**
+ * Run processFn over filename for options->warmups discarded runs
+ * followed by options->repeats measured runs, and report.
+ *
+ * Returns the record count from the last run, or -1 on failure
+ */
+int  bmProcessRepeatedly(char *filename, BMOptions *options,
+		BMProcessFn processFn);
+
+#endif /* __BENCHMARK_HEADER__ */
@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "bptree.h"
+
+/** nodes are allocated this many at a time */
+#define	BPTREE_BLOCK_NODES	1024
+
+
+static BPTreeNode *
+newNode_(BPTree *tree, int isLeaf)
+{
+	BPTreeBlock *block = tree->blocks;
+	BPTreeNode *node;
+
+	if (block == NULL || block->nUsed == BPTREE_BLOCK_NODES) {
+		block = (BPTreeBlock *) malloc(sizeof(BPTreeBlock));
+		if (block == NULL || posix_memalign((void **) &block->nodes,
+				BPTREE_LINE_SIZE,
+				BPTREE_BLOCK_NODES * sizeof(BPTreeNode)) != 0) {
+			fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+			exit(1);
+		}
+		block->nUsed = 0;
+		block->next = tree->blocks;
+		tree->blocks = block;
+	}
+
+	node = &block->nodes[block->nUsed++];
+	node->nKeys = 0;
+	node->isLeaf = isLeaf;
+	if (isLeaf)
+		node->u.leaf.next = NULL;
+	tree->nNodes++;
+	return node;
+}
+
+
+#ifdef __SSE2__
+/**
+ * For each of the two signed 64-bit lanes, is a greater than b?
+ * SSE2 only compares 32-bit lanes, so the high halves are compared
+ * signed and, where they are equal, the low halves unsigned (by
+ * flipping their sign bits).  Returns a two bit mask
+ */
+static inline int
+greater64_(__m128i a, __m128i b)
+{
+	const __m128i flipLow = _mm_set_epi32(0, (int) 0x80000000,
+			0, (int) 0x80000000);
+	__m128i greater, equal, greaterLow;
+
+	greater = _mm_cmpgt_epi32(a, b);
+	equal = _mm_cmpeq_epi32(a, b);
+	greaterLow = _mm_cmpgt_epi32(_mm_xor_si128(a, flipLow),
+			_mm_xor_si128(b, flipLow));
+	greater = _mm_or_si128(_mm_shuffle_epi32(greater, _MM_SHUFFLE(3, 3, 1, 1)),
+			_mm_and_si128(_mm_shuffle_epi32(equal, _MM_SHUFFLE(3, 3, 1, 1)),
+				_mm_shuffle_epi32(greaterLow, _MM_SHUFFLE(2, 2, 0, 0))));
+	return _mm_movemask_pd(_mm_castsi128_pd(greater));
+}
+#endif
+
+
+/**
+ * The number of keys of node less than key or, if orEqual is set,
+ * no greater than it.  This is the slot to search or insert at
+ */
+static int
+countBelow_(const BPTreeNode *node, long key, int orEqual)
+{
+	int i = 0, n = node->nKeys, count = 0;
+
+#ifdef __SSE2__
+	const __m128i target = _mm_set1_epi64x(key);
+	__m128i keys;
+	int mask;
+
+	for ( ; i + 2 <= n; i += 2) {
+		keys = _mm_load_si128((const __m128i *) &node->keys[i]);
+		mask = orEqual ? greater64_(keys, target) ^ 3
+				: greater64_(target, keys);
+		count += (mask & 1) + (mask >> 1);
+	}
+#endif
+
+	for ( ; i < n; i++)
+		count += orEqual ? (node->keys[i] <= key) : (node->keys[i] < key);
+	return count;
+}
+
+
+void
+bptreeInit(BPTree *tree)
+{
+	memset(tree, 0, sizeof(BPTree));
+}
+
+
+/** insert key and child at slot of an inner node with room for them */
+static void
+placeInInner_(BPTreeNode *node, int slot, long key, BPTreeNode *child)
+{
+	memmove(&node->keys[slot + 1], &node->keys[slot],
+			(node->nKeys - slot) * sizeof(long));
+	memmove(&node->u.children[slot + 2], &node->u.children[slot + 1],
+			(node->nKeys - slot) * sizeof(BPTreeNode *));
+	node->keys[slot] = key;
+	node->u.children[slot + 1] = child;
+	node->nKeys++;
+}
+
+
+/** insert key and value at slot of a leaf with room for them */
+static void
+placeInLeaf_(BPTreeNode *leaf, int slot, long key, long value)
+{
+	memmove(&leaf->keys[slot + 1], &leaf->keys[slot],
+			(leaf->nKeys - slot) * sizeof(long));
+	memmove(&leaf->u.leaf.values[slot + 1], &leaf->u.leaf.values[slot],
+			(leaf->nKeys - slot) * sizeof(long));
+	leaf->keys[slot] = key;
+	leaf->u.leaf.values[slot] = value;
+	leaf->nKeys++;
+}
+
+
+/**
+ * Insert into the subtree at node.  If node has to split, the new
+ * right-hand node and the least key under it are passed back, and
+ * 1 is returned
+ */
+static int
+insert_(BPTree *tree, BPTreeNode *node, long key, long value,
+		long *upKey, BPTreeNode **upNode)
+{
+	BPTreeNode *right, *child, *children[BPTREE_NODE_KEYS + 2];
+	long childKey, keys[BPTREE_NODE_KEYS + 1];
+	int slot, half;
+
+	slot = countBelow_(node, key, 1);
+
+	if (node->isLeaf) {
+		if (node->nKeys < BPTREE_NODE_KEYS) {
+			placeInLeaf_(node, slot, key, value);
+			return 0;
+		}
+
+		/** move the upper half across, then add to whichever side */
+		right = newNode_(tree, 1);
+		half = (BPTREE_NODE_KEYS + 1) / 2;
+		right->nKeys = node->nKeys - half;
+		memcpy(right->keys, &node->keys[half], right->nKeys * sizeof(long));
+		memcpy(right->u.leaf.values, &node->u.leaf.values[half],
+				right->nKeys * sizeof(long));
+		node->nKeys = half;
+		right->u.leaf.next = node->u.leaf.next;
+		node->u.leaf.next = right;
+
+		if (slot <= half)
+			placeInLeaf_(node, slot, key, value);
+		else
+			placeInLeaf_(right, slot - half, key, value);
+
+		*upKey = right->keys[0];
+		*upNode = right;
+		return 1;
+	}
+
+	if (!insert_(tree, node->u.children[slot], key, value,
+			&childKey, &child))
+		return 0;
+
+	if (node->nKeys < BPTREE_NODE_KEYS) {
+		placeInInner_(node, slot, childKey, child);
+		return 0;
+	}
+
+	/**
+	 * A full inner node: gather its keys and children with the new
+	 * ones, then the middle key moves up, with those on its right
+	 * going to the new node
+	 */
+	memcpy(keys, node->keys, slot * sizeof(long));
+	keys[slot] = childKey;
+	memcpy(&keys[slot + 1], &node->keys[slot],
+			(BPTREE_NODE_KEYS - slot) * sizeof(long));
+	memcpy(children, node->u.children, (slot + 1) * sizeof(BPTreeNode *));
+	children[slot + 1] = child;
+	memcpy(&children[slot + 2], &node->u.children[slot + 1],
+			(BPTREE_NODE_KEYS - slot) * sizeof(BPTreeNode *));
+
+	half = (BPTREE_NODE_KEYS + 1) / 2;
+	right = newNode_(tree, 0);
+	right->nKeys = BPTREE_NODE_KEYS - half;
+	memcpy(right->keys, &keys[half + 1], right->nKeys * sizeof(long));
+	memcpy(right->u.children, &children[half + 1],
+			(right->nKeys + 1) * sizeof(BPTreeNode *));
+	node->nKeys = half;
+	memcpy(node->keys, keys, half * sizeof(long));
+	memcpy(node->u.children, children, (half + 1) * sizeof(BPTreeNode *));
+
+	*upKey = keys[half];
+	*upNode = right;
+	return 1;
+}
+
+
+void
+bptreeInsert(BPTree *tree, long key, long value)
+{
+	BPTreeNode *right, *root;
+	long upKey;
+
+	if (tree->root == NULL) {
+		tree->root = tree->firstLeaf = newNode_(tree, 1);
+		tree->height = 1;
+	}
+
+	if (insert_(tree, tree->root, key, value, &upKey, &right)) {
+		root = newNode_(tree, 0);
+		root->keys[0] = upKey;
+		root->u.children[0] = tree->root;
+		root->u.children[1] = right;
+		root->nKeys = 1;
+		tree->root = root;
+		tree->height++;
+	}
+	tree->nItems++;
+	tree->rightmostValid = 0;
+}
+
+
+/**
+ * Add child, whose least key is key, as the last child at level,
+ * starting a new node there (and so going up a level) if the last
+ * node is full
+ */
+static void
+appendChild_(BPTree *tree, int level, long key, BPTreeNode *child)
+{
+	BPTreeNode *node, *root;
+
+	if (level == tree->height) {
+		root = newNode_(tree, 0);
+		root->keys[0] = key;
+		root->u.children[0] = tree->root;
+		root->u.children[1] = child;
+		root->nKeys = 1;
+		tree->root = tree->rightmost[level] = root;
+		tree->height++;
+		return;
+	}
+
+	node = tree->rightmost[level];
+	if (node->nKeys < BPTREE_NODE_KEYS) {
+		node->keys[node->nKeys] = key;
+		node->u.children[++node->nKeys] = child;
+		return;
+	}
+
+	/** a new node with one child and no keys yet */
+	node = newNode_(tree, 0);
+	node->u.children[0] = child;
+	tree->rightmost[level] = node;
+	appendChild_(tree, level + 1, key, node);
+}
+
+
+int
+bptreeAppend(BPTree *tree, long key, long value)
+{
+	BPTreeNode *leaf, *node;
+	int level;
+
+	if (tree->root == NULL) {
+		tree->root = tree->firstLeaf = tree->rightmost[0] = newNode_(tree, 1);
+		tree->height = 1;
+		tree->rightmostValid = 1;
+	}
+
+	if (!tree->rightmostValid) {
+		node = tree->root;
+		for (level = tree->height - 1; level > 0; level--) {
+			tree->rightmost[level] = node;
+			node = node->u.children[node->nKeys];
+		}
+		tree->rightmost[0] = node;
+		tree->rightmostValid = 1;
+	}
+
+	leaf = tree->rightmost[0];
+	if (leaf->nKeys > 0 && key < leaf->keys[leaf->nKeys - 1])
+		return -1;
+
+	if (leaf->nKeys == BPTREE_NODE_KEYS) {
+		leaf->u.leaf.next = newNode_(tree, 1);
+		leaf = tree->rightmost[0] = leaf->u.leaf.next;
+		appendChild_(tree, 1, key, leaf);
+	}
+
+	leaf->keys[leaf->nKeys] = key;
+	leaf->u.leaf.values[leaf->nKeys++] = value;
+	tree->nItems++;
+	return 0;
+}
+
+
+int
+bptreeSeek(BPTree *tree, long key, BPTreeCursor *cursor)
+{
+	BPTreeNode *node = tree->root;
+
+	if (node == NULL)
+		return 0;
+
+	/**
+	 * separators equal to key send us left: with repeated keys the
+	 * first of them may be in the left subtree
+	 */
+	while (!node->isLeaf)
+		node = node->u.children[countBelow_(node, key, 0)];
+
+	cursor->leaf = node;
+	cursor->slot = countBelow_(node, key, 0);
+	while (cursor->leaf != NULL && cursor->slot >= cursor->leaf->nKeys) {
+		cursor->leaf = cursor->leaf->u.leaf.next;
+		cursor->slot = 0;
+	}
+	return cursor->leaf != NULL;
+}
+
+
+int
+bptreeNext(BPTreeCursor *cursor, long *key, long *value)
+{
+	if (cursor->leaf == NULL)
+		return 0;
+
+	*key = cursor->leaf->keys[cursor->slot];
+	*value = cursor->leaf->u.leaf.values[cursor->slot];
+	if (++cursor->slot >= cursor->leaf->nKeys) {
+		cursor->leaf = cursor->leaf->u.leaf.next;
+		cursor->slot = 0;
+	}
+	return 1;
+}
+
+
+int
+bptreeFind(BPTree *tree, long key, long *value)
+{
+	BPTreeCursor cursor;
+	long found, foundValue;
+
+	if (!bptreeSeek(tree, key, &cursor)
+			|| !bptreeNext(&cursor, &found, &foundValue) || found != key)
+		return 0;
+	*value = foundValue;
+	return 1;
+}
+
+
+long
+bptreeRange(BPTree *tree, long lo, long hi,
+		void (*fn)(long key, long value, void *arg), void *arg)
+{
+	BPTreeCursor cursor;
+	long key, value, nVisited = 0;
+
+	if (!bptreeSeek(tree, lo, &cursor))
+		return 0;
+	while (bptreeNext(&cursor, &key, &value) && key <= hi) {
+		if (fn != NULL)
+			(*fn)(key, value, arg);
+		nVisited++;
+	}
+	return nVisited;
+}
+
+
+void
+bptreeFree(BPTree *tree)
+{
+	BPTreeBlock *block, *next;
+
+	for (block = tree->blocks; block != NULL; block = next) {
+		next = block->next;
+		free(block->nodes);
+		free(block);
+	}
+	bptreeInit(tree);
+}
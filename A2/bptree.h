@@ -0,0 +1,122 @@
+
+#ifndef	__BPTREE_HEADER__
+#define	__BPTREE_HEADER__
+
+#include <stdint.h>
+
+/**
+ * A B+-tree mapping long keys (FASTA ids) to long values (record
+ * indices into a FASTAstore), for ordered and range lookups.
+ *
+ * Every node is four 64-byte cache lines, aligned to a line.  The
+ * keys and the node header fill the first two lines, so a search of
+ * a node touches only those lines.  The rest of the node holds the
+ * child pointers (inner nodes) or the values and the next-leaf link
+ * (leaves).  A node is searched by counting its keys below the target
+ * two at a time with SSE2 compares, which needs no branches that
+ * depend on the data.  A plain C loop is used where SSE2 is not
+ * available.
+ *
+ * Keys may repeat; equal keys are kept in the order they were added.
+ * A tree is built either by bptreeInsert() in any order or, much
+ * faster and with full leaves, by bptreeAppend() from a stream
+ * already sorted by key.  Nodes are taken from large aligned blocks,
+ * all released by bptreeFree().
+ */
+
+#define	BPTREE_LINE_SIZE	64
+
+/** the keys in a node: 15 keys and the header fill two cache lines */
+#define	BPTREE_NODE_KEYS	15
+
+/** far more levels than 16^32 keys could need */
+#define	BPTREE_MAX_HEIGHT	32
+
+typedef struct BPTreeNode {
+	long keys[BPTREE_NODE_KEYS];
+	int16_t nKeys;
+	int16_t isLeaf;
+	union {
+		struct BPTreeNode *children[BPTREE_NODE_KEYS + 1];
+		struct {
+			long values[BPTREE_NODE_KEYS];
+			struct BPTreeNode *next;
+		} leaf;
+	} u;
+} __attribute__((aligned(BPTREE_LINE_SIZE))) BPTreeNode;
+
+/** a block of nodes, carved up in order */
+typedef struct BPTreeBlock {
+	struct BPTreeBlock *next;
+	BPTreeNode *nodes;
+	int nUsed;
+} BPTreeBlock;
+
+typedef struct BPTree {
+	BPTreeNode *root;
+	BPTreeNode *firstLeaf;
+	long nItems;
+	int height;			/* levels, counting the leaves */
+	long nNodes;
+	BPTreeBlock *blocks;
+
+	/** the right-hand edge of the tree, one node per level, used by
+	 * bptreeAppend(); rebuilt after an insert */
+	BPTreeNode *rightmost[BPTREE_MAX_HEIGHT];
+	int rightmostValid;
+} BPTree;
+
+/** a position in the leaves, for walking forward through a range */
+typedef struct BPTreeCursor {
+	BPTreeNode *leaf;
+	int slot;
+} BPTreeCursor;
+
+/** set up an empty tree */
+void bptreeInit(BPTree *tree);
+
+/** add key with value, after any entries with an equal key */
+void bptreeInsert(BPTree *tree, long key, long value);
+
+/**
+ * Add key with value to the end of the tree, which must hold only
+ * keys no greater than key.  Leaves and inner nodes are filled
+ * completely, with no searching or splitting.
+ *
+ * Returns 0, or -1 if key is less than the last key (and so is not added)
+ */
+int bptreeAppend(BPTree *tree, long key, long value);
+
+/**
+ * Point cursor at the first entry whose key is not less than key.
+ *
+ * Returns 1, or 0 if there is no such entry
+ */
+int bptreeSeek(BPTree *tree, long key, BPTreeCursor *cursor);
+
+/**
+ * Fetch the entry at cursor and advance past it.
+ *
+ * Returns 1, or 0 if the cursor has reached the end of the tree
+ */
+int bptreeNext(BPTreeCursor *cursor, long *key, long *value);
+
+/**
+ * The value of the first entry with key, through *value.
+ *
+ * Returns 1 if one was found, or 0
+ */
+int bptreeFind(BPTree *tree, long key, long *value);
+
+/**
+ * Call fn for each entry with a key from lo to hi inclusive, in order.
+ *
+ * Returns the number of entries visited
+ */
+long bptreeRange(BPTree *tree, long lo, long hi,
+		void (*fn)(long key, long value, void *arg), void *arg);
+
+/** release every node, leaving the tree empty */
+void bptreeFree(BPTree *tree);
+
+#endif /* __BPTREE_HEADER__ */
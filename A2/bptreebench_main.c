@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fasta_store.h"
+#include "fasta_sort.h"
+#include "bptree.h"
+#include "LLvNode.h"
+#include "util.h"
+
+
+/** the ranges to be looked up, from one of the ids present */
+typedef struct Query {
+	long lo;
+	long hi;
+} Query;
+
+
+static void
+reportQueries(const char *label, int nQueries, long nHits, double seconds)
+{
+	printf("%-22s : %8ld ids found in %lf seconds, %10.3f usec/query\n",
+			label, nHits, seconds, seconds * 1e6 / nQueries);
+}
+
+
+/** the array variant: every query scans all the records */
+static long
+queryArray(FASTAstore *store, Query *queries, int nQueries)
+{
+	long nHits = 0, i;
+	int q;
+
+	for (q = 0; q < nQueries; q++) {
+		for (i = 0; i < store->nRecords; i++) {
+			if (store->records[i].id >= queries[q].lo
+					&& store->records[i].id <= queries[q].hi)
+				nHits++;
+		}
+	}
+	return nHits;
+}
+
+
+/** the linked list variant: every query walks the whole list */
+static long
+queryList(LLvNode *head, Query *queries, int nQueries)
+{
+	LLvNode *node;
+	FASTArecord *fRecord;
+	long nHits = 0;
+	int q;
+
+	for (q = 0; q < nQueries; q++) {
+		for (node = head; node != NULL; node = node->next) {
+			fRecord = (FASTArecord *) node->value;
+			if (fRecord->id >= queries[q].lo && fRecord->id <= queries[q].hi)
+				nHits++;
+		}
+	}
+	return nHits;
+}
+
+
+/** a sorted array of ids: binary search for the start of each range */
+static long
+querySortedArray(long *ids, long n, Query *queries, int nQueries)
+{
+	long nHits = 0, low, high, middle;
+	int q;
+
+	for (q = 0; q < nQueries; q++) {
+		low = 0;
+		high = n;
+		while (low < high) {
+			middle = low + (high - low) / 2;
+			if (ids[middle] < queries[q].lo)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		for ( ; low < n && ids[low] <= queries[q].hi; low++)
+			nHits++;
+	}
+	return nHits;
+}
+
+
+static long
+queryTree(BPTree *tree, Query *queries, int nQueries)
+{
+	long nHits = 0;
+	int q;
+
+	for (q = 0; q < nQueries; q++)
+		nHits += bptreeRange(tree, queries[q].lo, queries[q].hi, NULL, NULL);
+	return nHits;
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Loads FASTA records from all files, indexes them by id in a\n");
+	fprintf(stderr, "B+-tree, and times id range queries against the linked list,\n");
+	fprintf(stderr, "array and sorted array.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-q <N>       : number of range queries (default 1000).\n");
+	fprintf(stderr, "-w <WIDTH>   : each query covers WIDTH ids (default 1000).\n");
+	fprintf(stderr, "-t <THREADS> : worker threads for sorting (default: one per CPU).\n");
+	fprintf(stderr, "-C           : load each file through its binary cache\n");
+	fprintf(stderr, "               (give it before the files).\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	FASTAstore store;
+	BPTree bulkTree, insertTree;
+	LLvNode *head = NULL, *tail = NULL, *node;
+	Query *queries;
+	struct timespec startTime;
+	double seconds;
+	long *order, *ids, i, nHits, nExpected;
+	int argi, q, nQueries = 1000, nFiles = 0, nWrong = 0;
+	long width = 1000;
+	int nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+	fastaStoreInit(&store);
+
+	for (argi = 1; argi < argc; argi++) {
+		if (argv[argi][0] == '-') {
+			if (argv[argi][1] == 'C') {
+				fastaStoreEnableCache(&store);
+			} else if (argi + 1 >= argc) {
+				fprintf(stderr, "Error: option '%s' needs an argument\n",
+						argv[argi]);
+				return 1;
+			} else if (argv[argi][1] == 'q') {
+				nQueries = atoi(argv[++argi]);
+			} else if (argv[argi][1] == 'w') {
+				width = atol(argv[++argi]);
+			} else if (argv[argi][1] == 't') {
+				nThreads = atoi(argv[++argi]);
+			} else {
+				fprintf(stderr,
+						"Error: unknown option '%s'\n", argv[argi]);
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			if (fastaStoreLoad(&store, argv[argi]) < 0) {
+				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+						argv[argi]);
+				fastaStoreFree(&store);
+				return 1;
+			}
+			nFiles++;
+		}
+	}
+
+	if (nFiles == 0 || store.nRecords == 0 || nQueries <= 0) {
+		fprintf(stderr,
+				"No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		fastaStoreFree(&store);
+		return 1;
+	}
+
+	/** build each structure over the same records */
+	bptreeInit(&bulkTree);
+	bptreeInit(&insertTree);
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	order = fastaSortPermutation(&store, FASTA_SORT_ID, nThreads);
+	ids = (long *) malloc(store.nRecords * sizeof(long));
+	if (ids == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	for (i = 0; i < store.nRecords; i++) {
+		ids[i] = store.records[order[i]].id;
+		bptreeAppend(&bulkTree, ids[i], order[i]);
+	}
+	seconds = secondsSince(&startTime);
+	printf("%ld records bulk loaded in %lf seconds (sorted first):"
+			" height %d, %ld nodes of %d bytes\n", bulkTree.nItems, seconds,
+			bulkTree.height, bulkTree.nNodes, (int) sizeof(BPTreeNode));
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	for (i = 0; i < store.nRecords; i++)
+		bptreeInsert(&insertTree, store.records[i].id, i);
+	seconds = secondsSince(&startTime);
+	printf("%ld records inserted in %lf seconds (load order):"
+			" height %d, %ld nodes\n", insertTree.nItems, seconds,
+			insertTree.height, insertTree.nNodes);
+
+	for (i = 0; i < store.nRecords; i++) {
+		node = llNewNode(NULL, &store.records[i]);
+		if (head == NULL)
+			head = node;
+		else
+			tail->next = node;
+		tail = node;
+	}
+
+	/** queries start at an id that is present, so most find something */
+	queries = (Query *) malloc(nQueries * sizeof(Query));
+	if (queries == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	srand(2520);
+	for (q = 0; q < nQueries; q++) {
+		queries[q].lo = store.records[rand() % store.nRecords].id;
+		queries[q].hi = queries[q].lo + width - 1;
+	}
+
+	printf("%d queries of %ld ids each:\n", nQueries, width);
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	nExpected = queryList(head, queries, nQueries);
+	reportQueries("linked list scan", nQueries, nExpected,
+			secondsSince(&startTime));
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	nHits = queryArray(&store, queries, nQueries);
+	reportQueries("array scan", nQueries, nHits, secondsSince(&startTime));
+	nWrong += (nHits != nExpected);
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	nHits = querySortedArray(ids, store.nRecords, queries, nQueries);
+	reportQueries("sorted array search", nQueries, nHits,
+			secondsSince(&startTime));
+	nWrong += (nHits != nExpected);
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	nHits = queryTree(&bulkTree, queries, nQueries);
+	reportQueries("B+-tree (bulk loaded)", nQueries, nHits,
+			secondsSince(&startTime));
+	nWrong += (nHits != nExpected);
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	nHits = queryTree(&insertTree, queries, nQueries);
+	reportQueries("B+-tree (inserted)", nQueries, nHits,
+			secondsSince(&startTime));
+	nWrong += (nHits != nExpected);
+
+	if (nWrong > 0)
+		fprintf(stderr, "Error: the structures disagree\n");
+
+	llFree(head, NULL, NULL);
+	free(queries);
+	free(ids);
+	free(order);
+	bptreeFree(&bulkTree);
+	bptreeFree(&insertTree);
+	fastaStoreFree(&store);
+
+	return (nWrong > 0) ? 1 : 0;
+}
@@ -0,0 +1,40 @@
+
+#ifndef	__COMPRESSED_INPUT_HEADER__
+#define	__COMPRESSED_INPUT_HEADER__
+
+#include <stdio.h>
+
+/**
+ * Transparent decompressing input.
+ *
+ * ciOpen() looks at the first few bytes of the named file to
+ * decide whether it is plain text, gzip, or zstd (when built with
+ * HAVE_ZSTD).  Plain files are simply returned from fopen(3).
+ * Compressed files are returned as a stdio stream whose data is
+ * produced by a separate decompression thread, so that the
+ * decompression overlaps with whatever parsing the caller is doing.
+ *
+ * Either way the result is an ordinary FILE pointer, so fgetc(3),
+ * fgets(3) and ungetc(3) all work as usual, and fclose(3) will
+ * stop and clean up the decompression thread.
+ */
+
+/** the size of each of the two buffers passed between threads */
+#define	CI_BUFFER_SIZE	(256 * 1024)
+
+typedef enum CIFormat {
+	CI_FORMAT_PLAIN = 0,
+	CI_FORMAT_GZIP,
+	CI_FORMAT_ZSTD
+} CIFormat;
+
+/** open filename for reading, decompressing if required */
+FILE *ciOpen(const char *filename);
+
+/** determine the format of filename from its magic bytes, or -1 */
+int ciDetectFormat(const char *filename);
+
+/** printable name for a format value */
+const char *ciFormatName(int format);
+
+#endif /* __COMPRESSED_INPUT_HEADER__ */
@@ -12,10 +12,22 @@ typedef struct FASTArecord {
 #define	RECOMMENDED_LINE_LENGTH 80
 #define	MAX_DESCRIPTION_LINE_LENGTH 1024
 
+struct Arena;
+struct OutWriter;
+
 int  fastaReadRecord(FILE *ifp, FASTArecord *fRecord);
+int  fastaReadRecordInArena(FILE *ifp, FASTArecord *fRecord,
+		struct Arena *arena);
+int  fastaReadRecordBatch(FILE *ifp, FASTArecord *records, int maxRecords,
+		struct Arena *arena, long *nLinesRead);
 void fastaInitializeRecord(FASTArecord *fRecord);
 FASTArecord * fastaAllocateRecord();
+FASTArecord * fastaAllocateRecordInArena(struct Arena *arena);
 int  fastaPrintRecord(FILE *ofp, FASTArecord *fRecord);
+int  fastaPrintRecordBuffered(struct OutWriter *ow, FASTArecord *fRecord);
+int  fastaWriteRecord(FILE *ofp, FASTArecord *fRecord, int lineLength);
+const char * fastaRecordName(FASTArecord *fRecord, int *nameLength);
+long fastaExtraIDfromDescription(const char *fastaIDline);
 void fastaClearRecord(FASTArecord *fRecord);
 void fastaDeallocateRecord(FASTArecord *fRecord);
 
@@ -0,0 +1,306 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fasta_cache.h"
+#include "hash64.h"
+#include "util.h"
+
+#define	FASTA_CACHE_HASH_SEED	0
+
+
+char *
+fastaCacheName(const char *sourceName)
+{
+	char *cacheName;
+
+	cacheName = (char *) malloc(strlen(sourceName)
+			+ strlen(FASTA_CACHE_SUFFIX) + 1);
+	if (cacheName == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	strcpy(cacheName, sourceName);
+	strcat(cacheName, FASTA_CACHE_SUFFIX);
+	return cacheName;
+}
+
+
+/** the offset of each column, given the sizes held in the header */
+static void
+columnOffsets_(FASTAcacheHeader *header, uint64_t *ids,
+		uint64_t *descriptions, uint64_t *sequences,
+		uint64_t *descriptionHeap, uint64_t *sequenceHeap, uint64_t *end)
+{
+	*ids = header->headerSize;
+	*descriptions = *ids + header->nRecords * sizeof(int64_t);
+	*sequences = *descriptions + header->nRecords * sizeof(uint64_t);
+	*descriptionHeap = *sequences + header->nRecords * sizeof(uint64_t);
+	*sequenceHeap = *descriptionHeap + header->descriptionHeapSize;
+	*end = *sequenceHeap + header->sequenceHeapSize;
+}
+
+
+/** fill in the source fields of the header */
+static int
+describeSource_(FASTAcacheHeader *header, const char *sourceName)
+{
+	struct stat sb;
+
+	if (stat(sourceName, &sb) < 0)
+		return -1;
+	header->sourceSize = (uint64_t) sb.st_size;
+	header->sourceMtimeSeconds = (int64_t) sb.st_mtim.tv_sec;
+	header->sourceMtimeNanoseconds = (int64_t) sb.st_mtim.tv_nsec;
+	return 0;
+}
+
+
+/** write size bytes to ofp; returns 0 on success */
+static int
+writeBlock_(FILE *ofp, const void *data, size_t size)
+{
+	return (fwrite(data, 1, size, ofp) == size) ? 0 : -1;
+}
+
+
+/**
+ * Checksum the columns and heaps of the cache just written to fd,
+ * reading it back through a mapping
+ */
+static int
+checksumFile_(int fd, size_t fileSize, FASTAcacheHeader *header)
+{
+	void *address;
+
+	address = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED)
+		return -1;
+	header->checksum = hash64((char *) address + header->headerSize,
+			fileSize - header->headerSize, FASTA_CACHE_HASH_SEED);
+	munmap(address, fileSize);
+	return 0;
+}
+
+
+int
+fastaCacheWrite(FASTAstore *store, long firstRecord, long nRecords,
+		const char *sourceName, const char *cacheName)
+{
+	FASTAcacheHeader header;
+	FASTArecord *records = &store->records[firstRecord];
+	FASTAdedup *dedup = store->dedup;
+	uint64_t *descriptionOffsets, *sequenceOffsets, *clusterOffsets = NULL;
+	uint64_t ids, descriptions, sequences, descriptionHeap, sequenceHeap, end;
+	int64_t id;
+	char *tmpName, *placesSequence;
+	FILE *ofp;
+	long i, cluster;
+	int status = 0;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, FASTA_CACHE_MAGIC, sizeof(header.magic));
+	header.byteOrder = FASTA_CACHE_BYTE_ORDER;
+	header.headerSize = sizeof(FASTAcacheHeader);
+	header.nRecords = (uint64_t) nRecords;
+	if (describeSource_(&header, sourceName) < 0)
+		return -1;
+
+	descriptionOffsets = (uint64_t *) malloc((nRecords + 1) * sizeof(uint64_t));
+	sequenceOffsets = (uint64_t *) malloc((nRecords + 1) * sizeof(uint64_t));
+	placesSequence = (char *) malloc(nRecords + 1);
+	if (dedup != NULL)
+		clusterOffsets = (uint64_t *) malloc((dedup->nClusters + 1)
+				* sizeof(uint64_t));
+	if (descriptionOffsets == NULL || sequenceOffsets == NULL
+			|| placesSequence == NULL || (dedup != NULL && clusterOffsets == NULL)) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	if (dedup != NULL)
+		memset(clusterOffsets, 0xff, (dedup->nClusters + 1) * sizeof(uint64_t));
+
+	/** lay out the heaps; a shared sequence is placed only once */
+	for (i = 0; i < nRecords; i++) {
+		descriptionOffsets[i] = header.descriptionHeapSize;
+		header.descriptionHeapSize += strlen(records[i].description) + 1;
+
+		if (dedup != NULL) {
+			cluster = dedup->recordCluster[firstRecord + i];
+			if (clusterOffsets[cluster] != UINT64_MAX) {
+				sequenceOffsets[i] = clusterOffsets[cluster];
+				placesSequence[i] = 0;
+				continue;
+			}
+			clusterOffsets[cluster] = header.sequenceHeapSize;
+		}
+		sequenceOffsets[i] = header.sequenceHeapSize;
+		placesSequence[i] = 1;
+		header.sequenceHeapSize += strlen(records[i].sequence) + 1;
+	}
+	columnOffsets_(&header, &ids, &descriptions, &sequences,
+			&descriptionHeap, &sequenceHeap, &end);
+
+	if ((ofp = tempFileOpen(cacheName, "w+b", &tmpName)) == NULL)
+		status = -1;
+
+	if (status == 0) {
+		status |= writeBlock_(ofp, &header, sizeof(header));
+		for (i = 0; i < nRecords; i++) {
+			id = records[i].id;
+			status |= writeBlock_(ofp, &id, sizeof(id));
+		}
+		status |= writeBlock_(ofp, descriptionOffsets,
+				nRecords * sizeof(uint64_t));
+		status |= writeBlock_(ofp, sequenceOffsets,
+				nRecords * sizeof(uint64_t));
+		for (i = 0; i < nRecords; i++)
+			status |= writeBlock_(ofp, records[i].description,
+					strlen(records[i].description) + 1);
+		for (i = 0; i < nRecords; i++)
+			if (placesSequence[i])
+				status |= writeBlock_(ofp, records[i].sequence,
+						strlen(records[i].sequence) + 1);
+
+		/** with everything in place, checksum it and finish the header */
+		if (status == 0 && fflush(ofp) == 0
+				&& checksumFile_(fileno(ofp), (size_t) end, &header) == 0
+				&& fseek(ofp, 0, SEEK_SET) == 0)
+			status |= writeBlock_(ofp, &header, sizeof(header));
+		else
+			status = -1;
+
+		if ( ! tempFileCommit(ofp, tmpName, cacheName, status == 0))
+			status = -1;
+	}
+
+	free(placesSequence);
+	free(descriptionOffsets);
+	free(sequenceOffsets);
+	free(clusterOffsets);
+	return (status == 0) ? 0 : -1;
+}
+
+
+/** check that the mapped cache is intact and belongs to the source */
+static int
+validateCache_(const char *cacheName, const char *sourceName,
+		const char *address, size_t fileSize)
+{
+	FASTAcacheHeader header, source;
+	uint64_t ids, descriptions, sequences, descriptionHeap, sequenceHeap, end;
+
+	if (fileSize < sizeof(FASTAcacheHeader)) {
+		fprintf(stderr, "Warning: cache '%s' is truncated\n", cacheName);
+		return -1;
+	}
+	memcpy(&header, address, sizeof(header));
+	if (memcmp(header.magic, FASTA_CACHE_MAGIC, sizeof(header.magic)) != 0
+			|| header.byteOrder != FASTA_CACHE_BYTE_ORDER
+			|| header.headerSize != sizeof(FASTAcacheHeader)) {
+		fprintf(stderr, "Warning: '%s' is not a FASTA cache for this"
+				" machine\n", cacheName);
+		return -1;
+	}
+
+	if (describeSource_(&source, sourceName) < 0
+			|| source.sourceSize != header.sourceSize
+			|| source.sourceMtimeSeconds != header.sourceMtimeSeconds
+			|| source.sourceMtimeNanoseconds
+				!= header.sourceMtimeNanoseconds) {
+		fprintf(stderr, "Warning: cache '%s' is out of date\n", cacheName);
+		return -1;
+	}
+
+	columnOffsets_(&header, &ids, &descriptions, &sequences,
+			&descriptionHeap, &sequenceHeap, &end);
+	if (header.nRecords > fileSize || end != fileSize) {
+		fprintf(stderr, "Warning: cache '%s' is truncated\n", cacheName);
+		return -1;
+	}
+	if (hash64(address + header.headerSize, fileSize - header.headerSize,
+			FASTA_CACHE_HASH_SEED) != header.checksum) {
+		fprintf(stderr, "Warning: cache '%s' fails its checksum\n",
+				cacheName);
+		return -1;
+	}
+	return 0;
+}
+
+
+long
+fastaCacheLoad(FASTAstore *store, const char *sourceName,
+		const char *cacheName)
+{
+	FASTAcacheHeader *header;
+	FASTAstoreMapping *mapping;
+	FASTArecord *record;
+	struct stat sb;
+	const int64_t *ids;
+	const uint64_t *descriptionOffsets, *sequenceOffsets;
+	uint64_t idsAt, descriptionsAt, sequencesAt;
+	uint64_t descriptionHeapAt, sequenceHeapAt, end;
+	char *address;
+	long i, n;
+	int fd;
+
+	if ((fd = open(cacheName, O_RDONLY)) < 0) {
+		if (errno != ENOENT)
+			fprintf(stderr, "Warning: cannot open cache '%s' : %s\n",
+					cacheName, strerror(errno));
+		return -1;
+	}
+	if (fstat(fd, &sb) < 0 || sb.st_size == 0) {
+		close(fd);
+		return -1;
+	}
+
+	address = (char *) mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (address == MAP_FAILED)
+		return -1;
+
+	if (validateCache_(cacheName, sourceName, address, sb.st_size) < 0) {
+		munmap(address, sb.st_size);
+		return -1;
+	}
+
+	mapping = (FASTAstoreMapping *) malloc(sizeof(FASTAstoreMapping));
+	if (mapping == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	mapping->address = address;
+	mapping->size = sb.st_size;
+	mapping->next = store->mappings;
+	store->mappings = mapping;
+
+	header = (FASTAcacheHeader *) address;
+	columnOffsets_(header, &idsAt, &descriptionsAt, &sequencesAt,
+			&descriptionHeapAt, &sequenceHeapAt, &end);
+	ids = (const int64_t *) (address + idsAt);
+	descriptionOffsets = (const uint64_t *) (address + descriptionsAt);
+	sequenceOffsets = (const uint64_t *) (address + sequencesAt);
+
+	/** the records simply point into the heaps */
+	n = (long) header->nRecords;
+	fastaStoreReserve(store, n);
+	for (i = 0; i < n; i++) {
+		record = &store->records[store->nRecords];
+		record->id = (long) ids[i];
+		record->description = address + descriptionHeapAt
+				+ descriptionOffsets[i];
+		record->sequence = address + sequenceHeapAt + sequenceOffsets[i];
+		if (store->dedup != NULL)
+			record->sequence = fastaDedupAdd(store->dedup,
+					record->sequence, store->nRecords);
+		store->nRecords++;
+	}
+
+	return n;
+}
@@ -0,0 +1,75 @@
+
+#ifndef	__FASTA_CACHE_HEADER__
+#define	__FASTA_CACHE_HEADER__
+
+#include <stdint.h>
+
+#include "fasta_store.h"
+
+/**
+ * A binary cache of a parsed FASTA file.
+ *
+ * The cache holds the records of one source file in columns, so that
+ * it can be mapped into memory and used as it stands:
+ *
+ *     header          FASTAcacheHeader
+ *     ids             int64_t  [nRecords]
+ *     descriptions    uint64_t [nRecords]  offsets into the description heap
+ *     sequences       uint64_t [nRecords]  offsets into the sequence heap
+ *     description heap  nul-terminated strings
+ *     sequence heap     nul-terminated strings
+ *
+ * The header records the size and modification time of the source
+ * file, so a cache that is older than its source is never used, and a
+ * hash64() checksum of everything after the header, so a damaged
+ * cache is never used either.  Records sharing a sequence in a
+ * deduplicated store share it in the cache as well.
+ *
+ * Caches are written in the byte order of the machine writing them,
+ * and are rejected by a machine of the other order.
+ */
+
+#define	FASTA_CACHE_SUFFIX		".fcache"
+#define	FASTA_CACHE_MAGIC		"FASTAC01"
+#define	FASTA_CACHE_BYTE_ORDER	0x01020304
+
+typedef struct FASTAcacheHeader {
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t headerSize;
+	uint64_t nRecords;
+	uint64_t sourceSize;
+	int64_t sourceMtimeSeconds;
+	int64_t sourceMtimeNanoseconds;
+	uint64_t descriptionHeapSize;
+	uint64_t sequenceHeapSize;
+	uint64_t checksum;
+} FASTAcacheHeader;
+
+/** the name of the cache kept for sourceName; free() it when done */
+char *fastaCacheName(const char *sourceName);
+
+/**
+ * Write nRecords records of store, starting at firstRecord, to
+ * cacheName as the cache of sourceName.  The cache is written under
+ * a temporary name and renamed into place, so readers never see a
+ * partly written cache.
+ *
+ * Returns 0 on success or -1 on failure
+ */
+int fastaCacheWrite(FASTAstore *store, long firstRecord, long nRecords,
+		const char *sourceName, const char *cacheName);
+
+/**
+ * Map cacheName and add its records to the end of store.  The
+ * strings of these records point into the read-only mapping, which
+ * is released by fastaStoreFree().
+ *
+ * Returns the number of records added, or -1 if the cache is
+ * missing, stale or damaged (the reason is reported unless the
+ * cache simply does not exist)
+ */
+long fastaCacheLoad(FASTAstore *store, const char *sourceName,
+		const char *cacheName);
+
+#endif /* __FASTA_CACHE_HEADER__ */
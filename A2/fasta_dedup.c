@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fasta_dedup.h"
+#include "hash64.h"
+#include "util.h"
+
+#define	DEDUP_INITIAL_CAPACITY	(1 << 12)
+#define	DEDUP_HASH_SEED			0
+
+
+FASTAdedup *
+fastaDedupCreate(void)
+{
+	FASTAdedup *dedup;
+
+	dedup = (FASTAdedup *) calloc(1, sizeof(FASTAdedup));
+	if (dedup == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+
+	dedup->capacity = DEDUP_INITIAL_CAPACITY;
+	dedup->slots = (long *) calloc(dedup->capacity, sizeof(long));
+	if (dedup->slots == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	return dedup;
+}
+
+
+/** double the slot table, re-placing every cluster by its saved hash */
+static void
+growSlots_(FASTAdedup *dedup)
+{
+	unsigned long mask, i;
+	long c;
+
+	free(dedup->slots);
+	dedup->capacity *= 2;
+	dedup->slots = (long *) calloc(dedup->capacity, sizeof(long));
+	if (dedup->slots == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+
+	mask = dedup->capacity - 1;
+	for (c = 0; c < dedup->nClusters; c++) {
+		i = dedup->clusters[c].hash & mask;
+		while (dedup->slots[i] != 0)
+			i = (i + 1) & mask;
+		dedup->slots[i] = c + 1;
+	}
+}
+
+
+/** make room for record number recordIndex in the per-record arrays */
+static void
+growRecords_(FASTAdedup *dedup, long recordIndex)
+{
+	if (recordIndex < dedup->nRecordsAllocated)
+		return;
+
+	if (dedup->nRecordsAllocated == 0)
+		dedup->nRecordsAllocated = 1024;
+	while (recordIndex >= dedup->nRecordsAllocated)
+		dedup->nRecordsAllocated *= 2;
+	dedup->nextRecord = (long *) reallocOrDie(dedup->nextRecord,
+			dedup->nRecordsAllocated * sizeof(long));
+	dedup->recordCluster = (long *) reallocOrDie(dedup->recordCluster,
+			dedup->nRecordsAllocated * sizeof(long));
+}
+
+
+char *
+fastaDedupAdd(FASTAdedup *dedup, char *sequence, long recordIndex)
+{
+	FASTAdedupCluster *cluster;
+	size_t length = strlen(sequence);
+	uint64_t hash = hash64(sequence, length, DEDUP_HASH_SEED);
+	unsigned long mask = dedup->capacity - 1, i;
+
+	growRecords_(dedup, recordIndex);
+	dedup->nextRecord[recordIndex] = -1;
+	dedup->nRecords++;
+
+	for (i = hash & mask; dedup->slots[i] != 0; i = (i + 1) & mask) {
+		cluster = &dedup->clusters[dedup->slots[i] - 1];
+		if (cluster->hash == hash && cluster->length == length
+				&& memcmp(cluster->sequence, sequence, length) == 0) {
+			dedup->nextRecord[cluster->lastRecord] = recordIndex;
+			dedup->recordCluster[recordIndex] = dedup->slots[i] - 1;
+			cluster->lastRecord = recordIndex;
+			cluster->nRecords++;
+			dedup->nDuplicates++;
+			dedup->bytesShared += length + 1;
+			return cluster->sequence;
+		}
+	}
+
+	/** a new body: it starts a cluster of its own */
+	if (dedup->nClusters >= dedup->nClustersAllocated) {
+		dedup->nClustersAllocated = (dedup->nClustersAllocated == 0)
+				? 1024 : dedup->nClustersAllocated * 2;
+		dedup->clusters = (FASTAdedupCluster *) reallocOrDie(dedup->clusters,
+				dedup->nClustersAllocated * sizeof(FASTAdedupCluster));
+	}
+	cluster = &dedup->clusters[dedup->nClusters];
+	cluster->hash = hash;
+	cluster->sequence = sequence;
+	cluster->length = length;
+	cluster->firstRecord = recordIndex;
+	cluster->lastRecord = recordIndex;
+	cluster->nRecords = 1;
+
+	dedup->slots[i] = ++dedup->nClusters;
+	dedup->recordCluster[recordIndex] = dedup->nClusters - 1;
+
+	/** keep the load factor under one half */
+	if ((unsigned long) dedup->nClusters * 2 > dedup->capacity)
+		growSlots_(dedup);
+
+	return sequence;
+}
+
+
+long
+fastaDedupSharedClusters(FASTAdedup *dedup)
+{
+	long c, nShared = 0;
+
+	for (c = 0; c < dedup->nClusters; c++)
+		if (dedup->clusters[c].nRecords > 1)
+			nShared++;
+	return nShared;
+}
+
+
+void
+fastaDedupFree(FASTAdedup *dedup)
+{
+	if (dedup == NULL)
+		return;
+	free(dedup->clusters);
+	free(dedup->slots);
+	free(dedup->nextRecord);
+	free(dedup->recordCluster);
+	free(dedup);
+}
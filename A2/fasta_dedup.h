@@ -0,0 +1,68 @@
+
+#ifndef	__FASTA_DEDUP_HEADER__
+#define	__FASTA_DEDUP_HEADER__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Sequence deduplication.
+ *
+ * Each sequence body is hashed with hash64() and looked up in an
+ * open-addressed table of the distinct bodies seen so far.  A record
+ * whose body is already present is given the existing copy, so that
+ * a body shared by many records is stored only once.
+ *
+ * The records sharing a body form a cluster; the members of each
+ * cluster are chained together in load order through nextRecord[],
+ * starting from the cluster's firstRecord.
+ */
+
+typedef struct FASTAdedupCluster {
+	uint64_t hash;
+	char *sequence;		/* the shared body */
+	size_t length;
+	long firstRecord;
+	long lastRecord;
+	long nRecords;
+} FASTAdedupCluster;
+
+typedef struct FASTAdedup {
+	FASTAdedupCluster *clusters;
+	long nClusters;
+	long nClustersAllocated;
+
+	/** cluster index + 1 for each slot, 0 for an empty slot */
+	long *slots;
+	unsigned long capacity;	/* always a power of two */
+
+	/** per record: the next record of its cluster, or -1 */
+	long *nextRecord;
+	/** per record: the index of its cluster */
+	long *recordCluster;
+	long nRecordsAllocated;
+
+	long nRecords;
+	long nDuplicates;
+	size_t bytesShared;	/* sequence bytes not stored again */
+} FASTAdedup;
+
+/** create an empty deduplication table */
+FASTAdedup *fastaDedupCreate(void);
+
+/**
+ * Add the body of record number recordIndex (records must be added
+ * in order, starting from 0).
+ *
+ * Returns the body the record should refer to: sequence itself if it
+ * is the first of its kind, or else the copy already held
+ */
+char *fastaDedupAdd(FASTAdedup *dedup, char *sequence, long recordIndex);
+
+/** the number of clusters with more than one member */
+long fastaDedupSharedClusters(FASTAdedup *dedup);
+
+/** release the table (the sequence bodies are not owned by it) */
+void fastaDedupFree(FASTAdedup *dedup);
+
+#endif /* __FASTA_DEDUP_HEADER__ */
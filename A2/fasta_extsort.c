@@ -0,0 +1,344 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "fasta_extsort.h"
+#include "compressed_input.h"
+
+/**
+ * what sorting costs on top of the records themselves, per record:
+ * the permutation and the sort's key and scratch arrays
+ */
+#define	SORT_BYTES_PER_RECORD	64
+
+/** the memory a run being merged needs: its stdio buffer and one record */
+#define	MERGE_BYTES_PER_RUN		(BUFSIZ + MAX_SEQUENCE_LINES \
+									* RECOMMENDED_LINE_LENGTH)
+
+#define	MAX_FAN_IN				128
+
+/** one input of a merge: a run and the record at its head */
+typedef struct MergeInput {
+	FILE *fp;
+	FASTArecord record;
+	int exhausted;
+} MergeInput;
+
+typedef struct LoserTree {
+	MergeInput *inputs;
+	int nInputs;
+	int *loser;		/* loser[node] for internal nodes 1 .. nInputs - 1 */
+	int winner;
+	FASTAsortKey key;
+} LoserTree;
+
+
+/** create an empty, already unlinked, temporary file */
+static FILE *
+newRun_(const char *tempDir)
+{
+	char path[FILENAME_MAX];
+	FILE *fp;
+	int fd;
+
+	if (tempDir == NULL && (tempDir = getenv("TMPDIR")) == NULL)
+		tempDir = "/tmp";
+	snprintf(path, sizeof(path), "%s/fastaxsort.XXXXXX", tempDir);
+	if ((fd = mkstemp(path)) < 0) {
+		fprintf(stderr, "Error: cannot create a run in '%s' : %s\n",
+				tempDir, strerror(errno));
+		return NULL;
+	}
+	unlink(path);
+	if ((fp = fdopen(fd, "w+")) == NULL)
+		close(fd);
+	return fp;
+}
+
+
+/** the memory held by the records in store */
+static size_t
+runBytes_(FASTAstore *store)
+{
+	return ((store->arena != NULL) ? store->arena->bytesReserved : 0)
+			+ store->nAllocated * sizeof(FASTArecord)
+			+ store->nRecords * SORT_BYTES_PER_RECORD;
+}
+
+
+/** sort the records held in store and write them to ofp */
+static int
+writeSorted_(FASTAstore *store, FILE *ofp, FASTAextSortOptions *options)
+{
+	long *order, i;
+	int status = 0;
+
+	order = fastaSortPermutation(store, options->key, options->nThreads);
+	for (i = 0; i < store->nRecords && status == 0; i++)
+		status = fastaWriteRecord(ofp, &store->records[order[i]],
+				FASTA_EXTSORT_LINE_LENGTH);
+	free(order);
+	return status;
+}
+
+
+/** sort store into a new run, which is added to the list of runs */
+static int
+spillRun_(FASTAstore *store, FILE ***runs, long *nRuns,
+		FASTAextSortOptions *options)
+{
+	FILE *run;
+
+	if ((run = newRun_(options->tempDir)) == NULL)
+		return -1;
+	if (writeSorted_(store, run, options) < 0 || fflush(run) != 0) {
+		fprintf(stderr, "Error: writing a run failed : %s\n", strerror(errno));
+		fclose(run);
+		return -1;
+	}
+
+	*runs = (FILE **) realloc(*runs, (*nRuns + 1) * sizeof(FILE *));
+	if (*runs == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	(*runs)[(*nRuns)++] = run;
+	return 0;
+}
+
+
+/** move an input on to its next record; returns -1 on a read error */
+static int
+advance_(MergeInput *input)
+{
+	int status;
+
+	fastaClearRecord(&input->record);
+	status = fastaReadRecord(input->fp, &input->record);
+	if (status <= 0)
+		input->exhausted = 1;
+	return (status < 0) ? -1 : 0;
+}
+
+
+/**
+ * does input a's record come before input b's?  Exhausted inputs come
+ * last, and equal keys are taken from the earlier run, keeping the
+ * sort stable
+ */
+static int
+precedes_(LoserTree *tree, int a, int b)
+{
+	int cmp;
+
+	if (tree->inputs[a].exhausted || tree->inputs[b].exhausted)
+		return !tree->inputs[a].exhausted && tree->inputs[b].exhausted;
+	cmp = fastaCompareRecordKeys(&tree->inputs[a].record,
+			&tree->inputs[b].record, tree->key);
+	return (cmp < 0) || (cmp == 0 && a < b);
+}
+
+
+/** play the matches below node, returning the winner */
+static int
+playMatches_(LoserTree *tree, int node)
+{
+	int left, right;
+
+	if (node >= tree->nInputs)
+		return node - tree->nInputs;
+	left = playMatches_(tree, 2 * node);
+	right = playMatches_(tree, 2 * node + 1);
+	if (precedes_(tree, right, left)) {
+		tree->loser[node] = left;
+		return right;
+	}
+	tree->loser[node] = right;
+	return left;
+}
+
+
+/**
+ * After the winner has moved to its next record, replay its path to
+ * the root, where the new winner emerges
+ */
+static void
+replay_(LoserTree *tree)
+{
+	int node, swap, winner = tree->winner;
+
+	for (node = (winner + tree->nInputs) / 2; node >= 1; node /= 2) {
+		if (precedes_(tree, tree->loser[node], winner)) {
+			swap = tree->loser[node];
+			tree->loser[node] = winner;
+			winner = swap;
+		}
+	}
+	tree->winner = winner;
+}
+
+
+/** merge the nRuns runs into ofp; the runs are closed */
+static int
+mergeRuns_(FILE **runs, int nRuns, FILE *ofp, FASTAextSortOptions *options,
+		long *nRecords)
+{
+	LoserTree tree;
+	int i, status = 0;
+
+	tree.inputs = (MergeInput *) calloc(nRuns, sizeof(MergeInput));
+	tree.loser = (int *) calloc(nRuns + 1, sizeof(int));
+	if (tree.inputs == NULL || tree.loser == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	tree.nInputs = nRuns;
+	tree.key = options->key;
+
+	for (i = 0; i < nRuns; i++) {
+		tree.inputs[i].fp = runs[i];
+		fastaInitializeRecord(&tree.inputs[i].record);
+		rewind(runs[i]);
+		status |= advance_(&tree.inputs[i]);
+	}
+	tree.winner = (nRuns > 1) ? playMatches_(&tree, 1) : 0;
+
+	while (status == 0 && !tree.inputs[tree.winner].exhausted) {
+		status = fastaWriteRecord(ofp, &tree.inputs[tree.winner].record,
+				FASTA_EXTSORT_LINE_LENGTH);
+		(*nRecords)++;
+		status |= advance_(&tree.inputs[tree.winner]);
+		replay_(&tree);
+	}
+
+	for (i = 0; i < nRuns; i++) {
+		fastaClearRecord(&tree.inputs[i].record);
+		fclose(runs[i]);
+	}
+	free(tree.inputs);
+	free(tree.loser);
+	return status;
+}
+
+
+/** read every input, spilling sorted runs as the budget fills */
+static int
+makeRuns_(char **inputs, int nInputs, FASTAstore *store, FILE ***runs,
+		long *nRuns, FASTAextSortOptions *options, FASTAextSortStats *stats)
+{
+	FASTArecord fRecord;
+	FILE *fp;
+	size_t bytes;
+	int f, status;
+
+	for (f = 0; f < nInputs; f++) {
+		if ((fp = ciOpen(inputs[f])) == NULL) {
+			fprintf(stderr, "Failure opening %s : %s\n",
+					inputs[f], strerror(errno));
+			return -1;
+		}
+
+		for (;;) {
+			if (store->arena == NULL)
+				store->arena = arenaCreate(options->memoryBudget / 16);
+			fastaInitializeRecord(&fRecord);
+			status = fastaReadRecordInArena(fp, &fRecord, store->arena);
+			if (status == 0)
+				break;
+			if (status < 0) {
+				fprintf(stderr, "Error: failure reading '%s'\n", inputs[f]);
+				fclose(fp);
+				return -1;
+			}
+			fastaStoreReserve(store, 1);
+			store->records[store->nRecords++] = fRecord;
+			stats->nRecords++;
+
+			bytes = runBytes_(store);
+			if (bytes > stats->peakRunBytes)
+				stats->peakRunBytes = bytes;
+			if (bytes >= options->memoryBudget) {
+				if (spillRun_(store, runs, nRuns, options) < 0) {
+					fclose(fp);
+					return -1;
+				}
+				fastaStoreFree(store);
+			}
+		}
+		fclose(fp);
+	}
+	return 0;
+}
+
+
+int
+fastaExternalSort(char **inputs, int nInputs, FILE *ofp,
+		FASTAextSortOptions *options, FASTAextSortStats *stats)
+{
+	FASTAstore store;
+	FILE **runs = NULL, *merged;
+	long nRuns = 0, nMerged, r, discard;
+	int fanIn, group, status = 0;
+
+	memset(stats, 0, sizeof(FASTAextSortStats));
+	if (options->memoryBudget == 0)
+		options->memoryBudget = FASTA_EXTSORT_DEFAULT_BUDGET;
+
+	fastaStoreInit(&store);
+	if (makeRuns_(inputs, nInputs, &store, &runs, &nRuns,
+			options, stats) < 0) {
+		status = -1;
+		goto done;
+	}
+
+	/** everything fitted in memory: no runs are needed at all */
+	if (nRuns == 0) {
+		status = writeSorted_(&store, ofp, options);
+		goto done;
+	}
+	if (store.nRecords > 0 && spillRun_(&store, &runs, &nRuns, options) < 0) {
+		status = -1;
+		goto done;
+	}
+	fastaStoreFree(&store);
+	stats->nRuns = nRuns;
+
+	fanIn = (int) (options->memoryBudget / MERGE_BYTES_PER_RUN);
+	if (fanIn < 2)
+		fanIn = 2;
+	if (fanIn > MAX_FAN_IN)
+		fanIn = MAX_FAN_IN;
+
+	/** merge groups of runs into longer ones until one merge will do */
+	while (nRuns > fanIn && status == 0) {
+		nMerged = 0;
+		for (r = 0; r < nRuns && status == 0; r += group) {
+			group = (nRuns - r < fanIn) ? (int) (nRuns - r) : fanIn;
+			if ((merged = newRun_(options->tempDir)) == NULL) {
+				status = -1;
+				break;
+			}
+			discard = 0;
+			status = mergeRuns_(&runs[r], group, merged, options, &discard);
+			runs[nMerged++] = merged;
+		}
+		nRuns = nMerged;
+		stats->nMergePasses++;
+	}
+
+	if (status == 0) {
+		discard = 0;
+		status = mergeRuns_(runs, (int) nRuns, ofp, options, &discard);
+		stats->nMergePasses++;
+		nRuns = 0;
+	}
+
+done:
+	for (r = 0; r < nRuns; r++)
+		fclose(runs[r]);
+	free(runs);
+	fastaStoreFree(&store);
+	return status;
+}
@@ -0,0 +1,54 @@
+
+#ifndef	__FASTA_EXTSORT_HEADER__
+#define	__FASTA_EXTSORT_HEADER__
+
+#include <stdio.h>
+
+#include "fasta_sort.h"
+
+/**
+ * External (out-of-core) sorting of FASTA files too large to load.
+ *
+ * Records are streamed in through fastaReadRecord() and collected in
+ * a FASTAstore until it reaches the memory budget.  The store is then
+ * sorted with fastaSortPermutation() and spilled to a temporary "run"
+ * file, and emptied for the next run.  The runs are then merged with
+ * a loser tree, which finds the next record of a k-way merge with one
+ * comparison per level.  When there are more runs than the budget
+ * allows open at once, groups of runs are first merged into longer
+ * runs.
+ *
+ * Runs are unlinked as soon as they are created, so they vanish even
+ * if the sort is interrupted.
+ */
+
+/** the line length of sequences in runs and in the output */
+#define	FASTA_EXTSORT_LINE_LENGTH	60
+
+/** the default budget, used when 0 is given */
+#define	FASTA_EXTSORT_DEFAULT_BUDGET	(256UL * 1024 * 1024)
+
+typedef struct FASTAextSortOptions {
+	FASTAsortKey key;
+	size_t memoryBudget;	/* bytes for records held in memory */
+	const char *tempDir;	/* where runs are written; NULL for $TMPDIR */
+	int nThreads;			/* for sorting each run */
+} FASTAextSortOptions;
+
+typedef struct FASTAextSortStats {
+	long nRecords;
+	long nRuns;				/* runs spilled from the input */
+	long nMergePasses;		/* including the final merge */
+	size_t peakRunBytes;	/* the most memory held by one run */
+} FASTAextSortStats;
+
+/**
+ * Sort the records of the nInputs files (which may be compressed),
+ * writing them to ofp.
+ *
+ * Returns 0 on success or -1 on failure
+ */
+int fastaExternalSort(char **inputs, int nInputs, FILE *ofp,
+		FASTAextSortOptions *options, FASTAextSortStats *stats);
+
+#endif /* __FASTA_EXTSORT_HEADER__ */
@@ -0,0 +1,457 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "fasta_index.h"
+#include "compressed_input.h"
+#include "hash64.h"
+#include "util.h"
+
+#define	FASTA_INDEX_INITIAL_CAPACITY	1024
+
+
+static FASTAindex *
+newIndex_(const char *fastaName)
+{
+	FASTAindex *index;
+
+	index = (FASTAindex *) calloc(1, sizeof(FASTAindex));
+	if (index == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	index->fastaName = strdup(fastaName);
+	index->names = arenaCreate(0);
+	index->fd = open(fastaName, O_RDONLY);
+	if (index->fd < 0) {
+		fprintf(stderr, "Failure opening %s : %s\n",
+				fastaName, strerror(errno));
+		fastaIndexClose(index);
+		return NULL;
+	}
+	return index;
+}
+
+
+/** the id fastaReadRecord() would give a record named name */
+static long
+idOfName_(const char *name)
+{
+	char description[MAX_DESCRIPTION_LINE_LENGTH + 2];
+
+	snprintf(description, sizeof(description), ">%s", name);
+	return fastaExtraIDfromDescription(description);
+}
+
+
+static FASTAindexEntry *
+addEntry_(FASTAindex *index, const char *name, size_t nameLength)
+{
+	FASTAindexEntry *entry;
+
+	if (index->nEntries >= index->nAllocated) {
+		index->nAllocated = (index->nAllocated == 0)
+				? FASTA_INDEX_INITIAL_CAPACITY : index->nAllocated * 2;
+		index->entries = (FASTAindexEntry *) reallocOrDie(index->entries,
+				index->nAllocated * sizeof(FASTAindexEntry));
+	}
+	entry = &index->entries[index->nEntries++];
+	memset(entry, 0, sizeof(FASTAindexEntry));
+
+	entry->name = (char *) arenaAlloc(index->names, nameLength + 1);
+	memcpy(entry->name, name, nameLength);
+	entry->name[nameLength] = '\0';
+	entry->id = idOfName_(entry->name);
+	return entry;
+}
+
+
+static uint64_t
+idHash_(long id)
+{
+	return hash64(&id, sizeof(id), 0);
+}
+
+
+/**
+ * Build the name and id lookup tables once every entry is known;
+ * the first record of any repeated name or id is the one found
+ */
+static void
+buildTables_(FASTAindex *index)
+{
+	unsigned long mask, slot;
+	long e;
+
+	index->capacity = FASTA_INDEX_INITIAL_CAPACITY;
+	while (index->capacity < (unsigned long) index->nEntries * 2)
+		index->capacity *= 2;
+	mask = index->capacity - 1;
+
+	index->nameSlots = (long *) calloc(index->capacity, sizeof(long));
+	index->idSlots = (long *) calloc(index->capacity, sizeof(long));
+	if (index->nameSlots == NULL || index->idSlots == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+
+	for (e = 0; e < index->nEntries; e++) {
+		if (fastaIndexFindName(index, index->entries[e].name) < 0) {
+			slot = hash64(index->entries[e].name,
+					strlen(index->entries[e].name), 0) & mask;
+			while (index->nameSlots[slot] != 0)
+				slot = (slot + 1) & mask;
+			index->nameSlots[slot] = e + 1;
+		}
+		if (index->entries[e].id >= 0
+				&& fastaIndexFindId(index, index->entries[e].id) < 0) {
+			slot = idHash_(index->entries[e].id) & mask;
+			while (index->idSlots[slot] != 0)
+				slot = (slot + 1) & mask;
+			index->idSlots[slot] = e + 1;
+		}
+	}
+}
+
+
+long
+fastaIndexFindName(FASTAindex *index, const char *name)
+{
+	unsigned long mask = index->capacity - 1, slot;
+
+	slot = hash64(name, strlen(name), 0) & mask;
+	for (; index->nameSlots[slot] != 0; slot = (slot + 1) & mask) {
+		if (strcmp(index->entries[index->nameSlots[slot] - 1].name, name) == 0)
+			return index->nameSlots[slot] - 1;
+	}
+	return -1;
+}
+
+
+long
+fastaIndexFindId(FASTAindex *index, long id)
+{
+	unsigned long mask = index->capacity - 1, slot;
+
+	slot = idHash_(id) & mask;
+	for (; index->idSlots[slot] != 0; slot = (slot + 1) & mask) {
+		if (index->entries[index->idSlots[slot] - 1].id == id)
+			return index->idSlots[slot] - 1;
+	}
+	return -1;
+}
+
+
+FASTAindex *
+fastaIndexBuild(const char *fastaName)
+{
+	FASTAindex *index;
+	FASTAindexEntry *entry = NULL;
+	FILE *fp;
+	char *line = NULL;
+	size_t lineAllocated = 0;
+	ssize_t lineLength;
+	long offset = 0, lineNumber = 0;
+	int bases, sawShortLine = 0;
+
+	if (ciDetectFormat(fastaName) > CI_FORMAT_PLAIN) {
+		fprintf(stderr, "Error: '%s' is compressed and cannot be indexed\n",
+				fastaName);
+		return NULL;
+	}
+	if ((index = newIndex_(fastaName)) == NULL)
+		return NULL;
+	if ((fp = fopen(fastaName, "r")) == NULL) {
+		fprintf(stderr, "Failure opening %s : %s\n",
+				fastaName, strerror(errno));
+		fastaIndexClose(index);
+		return NULL;
+	}
+
+	while ((lineLength = getline(&line, &lineAllocated, fp)) > 0) {
+		lineNumber++;
+		offset += lineLength;
+
+		if (line[0] == '>') {
+			entry = addEntry_(index, line + 1, strcspn(line + 1, " \t\r\n"));
+			entry->offset = offset;
+			sawShortLine = 0;
+			continue;
+		}
+
+		bases = (int) strcspn(line, "\r\n");
+		if (entry == NULL) {
+			if (bases == 0)
+				continue;
+			fprintf(stderr, "Error: '%s' line %ld: sequence before the"
+					" first description\n", fastaName, lineNumber);
+			break;
+		}
+
+		/** only the last line of a record may be shorter than the first */
+		if (entry->lineBases == 0) {
+			entry->lineBases = bases;
+			entry->lineWidth = (int) lineLength;
+		} else if (bases > 0 && (sawShortLine || bases > entry->lineBases
+				|| lineLength - bases != entry->lineWidth - entry->lineBases)) {
+			fprintf(stderr, "Error: '%s' line %ld: different line length"
+					" in sequence '%s'\n", fastaName, lineNumber, entry->name);
+			break;
+		}
+		if (bases < entry->lineBases)
+			sawShortLine = 1;
+		entry->length += bases;
+	}
+
+	free(line);
+	if (!feof(fp)) {
+		fclose(fp);
+		fastaIndexClose(index);
+		return NULL;
+	}
+	fclose(fp);
+
+	buildTables_(index);
+	return index;
+}
+
+
+int
+fastaIndexWrite(FASTAindex *index, const char *faiName)
+{
+	FASTAindexEntry *entry;
+	FILE *ofp;
+	long e;
+	char *tmpName;
+	int status = 0;
+
+	/** a partly written index must never replace a good one */
+	if ((ofp = tempFileOpen(faiName, "w", &tmpName)) == NULL)
+		return -1;
+	for (e = 0; e < index->nEntries; e++) {
+		entry = &index->entries[e];
+		if (fprintf(ofp, "%s\t%ld\t%ld\t%d\t%d\n", entry->name, entry->length,
+				entry->offset, entry->lineBases, entry->lineWidth) < 0)
+			status = -1;
+	}
+	if ( ! tempFileCommit(ofp, tmpName, faiName, status == 0))
+		status = -1;
+	return status;
+}
+
+
+/** read an existing ".fai" index; returns NULL if it cannot be used */
+static FASTAindex *
+readIndex_(const char *fastaName, const char *faiName)
+{
+	FASTAindex *index;
+	FASTAindexEntry *entry;
+	FILE *fp;
+	char *line = NULL, *tab;
+	size_t lineAllocated = 0;
+	long lineNumber = 0;
+	int ok = 1;
+
+	if ((fp = fopen(faiName, "r")) == NULL)
+		return NULL;
+	if ((index = newIndex_(fastaName)) == NULL) {
+		fclose(fp);
+		return NULL;
+	}
+
+	while (ok && getline(&line, &lineAllocated, fp) > 0) {
+		lineNumber++;
+		tab = strchr(line, '\t');
+		if (tab == NULL) {
+			ok = 0;
+			break;
+		}
+		entry = addEntry_(index, line, tab - line);
+		if (sscanf(tab + 1, "%ld\t%ld\t%d\t%d", &entry->length,
+				&entry->offset, &entry->lineBases, &entry->lineWidth) != 4)
+			ok = 0;
+	}
+	free(line);
+	fclose(fp);
+
+	if (!ok) {
+		fprintf(stderr, "Warning: index '%s' line %ld is not in .fai"
+				" format\n", faiName, lineNumber);
+		fastaIndexClose(index);
+		return NULL;
+	}
+
+	buildTables_(index);
+	return index;
+}
+
+
+FASTAindex *
+fastaIndexOpen(const char *fastaName)
+{
+	FASTAindex *index = NULL;
+	struct stat fastaStat, faiStat;
+	char *faiName;
+
+	faiName = (char *) malloc(strlen(fastaName) + strlen(FASTA_INDEX_SUFFIX) + 1);
+	if (faiName == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	sprintf(faiName, "%s%s", fastaName, FASTA_INDEX_SUFFIX);
+
+	if (stat(fastaName, &fastaStat) == 0 && stat(faiName, &faiStat) == 0
+			&& faiStat.st_mtime >= fastaStat.st_mtime)
+		index = readIndex_(fastaName, faiName);
+
+	if (index == NULL) {
+		index = fastaIndexBuild(fastaName);
+		if (index != NULL && fastaIndexWrite(index, faiName) < 0)
+			fprintf(stderr, "Warning: could not save index '%s'\n", faiName);
+	}
+
+	free(faiName);
+	return index;
+}
+
+
+/** the byte offset of residue position within entry */
+static long
+residueOffset_(FASTAindexEntry *entry, long position)
+{
+	if (entry->lineBases == 0)
+		return entry->offset;
+	return entry->offset + (position / entry->lineBases) * entry->lineWidth
+			+ position % entry->lineBases;
+}
+
+
+/** read size bytes at offset into a new buffer, with a terminating nul */
+static char *
+readSpan_(FASTAindex *index, long offset, size_t size)
+{
+	char *buffer;
+	ssize_t nRead;
+
+	buffer = (char *) malloc(size + 1);
+	if (buffer == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	nRead = pread(index->fd, buffer, size, offset);
+	if (nRead != (ssize_t) size) {
+		fprintf(stderr, "Error: short read from '%s' at offset %ld"
+				" -- is the index out of date?\n", index->fastaName, offset);
+		free(buffer);
+		return NULL;
+	}
+	buffer[size] = '\0';
+	return buffer;
+}
+
+
+/** squeeze the line ends out of buffer, in place; returns the length */
+static long
+removeLineEnds_(char *buffer)
+{
+	char *from, *to;
+
+	for (from = to = buffer; *from != '\0'; from++)
+		if (*from != '\n' && *from != '\r')
+			*to++ = *from;
+	*to = '\0';
+	return to - buffer;
+}
+
+
+char *
+fastaIndexFetchSequence(FASTAindex *index, long ordinal, long start, long end)
+{
+	FASTAindexEntry *entry;
+	char *sequence;
+	long first, last;
+
+	if (ordinal < 0 || ordinal >= index->nEntries)
+		return NULL;
+	entry = &index->entries[ordinal];
+	if (end < 0 || end > entry->length)
+		end = entry->length;
+	if (start < 0 || start > end)
+		return NULL;
+	if (start == end)
+		return strdup("");
+
+	first = residueOffset_(entry, start);
+	last = residueOffset_(entry, end - 1);
+	sequence = readSpan_(index, first, last - first + 1);
+	if (sequence != NULL)
+		removeLineEnds_(sequence);
+	return sequence;
+}
+
+
+int
+fastaIndexFetchRecord(FASTAindex *index, long ordinal, FASTArecord *fRecord)
+{
+	FASTAindexEntry *entry;
+	char *buffer;
+	long spanStart, spanEnd, headerEnd, headerStart;
+
+	if (ordinal < 0 || ordinal >= index->nEntries)
+		return -1;
+	entry = &index->entries[ordinal];
+
+	/**
+	 * The description line is not in the index, but it ends just
+	 * before the first residue and is at most a buffer long, so one
+	 * read can take in both it and the sequence
+	 */
+	spanStart = entry->offset - (MAX_DESCRIPTION_LINE_LENGTH + 2);
+	if (spanStart < 0)
+		spanStart = 0;
+	spanEnd = (entry->length > 0)
+			? residueOffset_(entry, entry->length - 1) + 1 : entry->offset;
+	if ((buffer = readSpan_(index, spanStart, spanEnd - spanStart)) == NULL)
+		return -1;
+
+	headerEnd = entry->offset - spanStart;
+	for (headerStart = headerEnd - 1; headerStart > 0
+			&& buffer[headerStart - 1] != '\n'; headerStart--)
+		;
+	if (buffer[headerStart] != '>'
+			|| (headerStart == 0 && spanStart > 0)) {
+		fprintf(stderr, "Error: no description found for '%s' in '%s'\n",
+				entry->name, index->fastaName);
+		free(buffer);
+		return -1;
+	}
+
+	fRecord->description = strndup(buffer + headerStart,
+			headerEnd - headerStart);
+	removeLineEnds_(buffer + headerEnd);
+	fRecord->sequence = strdup(buffer + headerEnd);
+	fRecord->id = fastaExtraIDfromDescription(fRecord->description);
+
+	free(buffer);
+	return 0;
+}
+
+
+void
+fastaIndexClose(FASTAindex *index)
+{
+	if (index == NULL)
+		return;
+	if (index->fd >= 0)
+		close(index->fd);
+	free(index->fastaName);
+	free(index->entries);
+	free(index->nameSlots);
+	free(index->idSlots);
+	arenaDestroy(index->names);
+	free(index);
+}
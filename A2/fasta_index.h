@@ -0,0 +1,99 @@
+
+#ifndef	__FASTA_INDEX_HEADER__
+#define	__FASTA_INDEX_HEADER__
+
+#include "fasta.h"
+#include "arena.h"
+
+/**
+ * Random access to the records of an uncompressed FASTA file through
+ * an index in the samtools ".fai" format.  The index holds one line
+ * per record, with five tab-separated fields:
+ *
+ *     NAME  LENGTH  OFFSET  LINEBASES  LINEWIDTH
+ *
+ * These are the first word of the description, the number of
+ * residues, the byte offset of the first residue, the residues per
+ * sequence line, and the bytes per line including the line end.
+ * With these any residue's byte position can be computed, so a record
+ * or a range of its sequence is read with a single pread().
+ *
+ * As with samtools, every sequence line of a record but the last
+ * must be the same length.
+ */
+
+#define	FASTA_INDEX_SUFFIX	".fai"
+
+typedef struct FASTAindexEntry {
+	char *name;
+	long id;		/* from the description, as fastaReadRecord() sets it */
+	long length;
+	long offset;
+	int lineBases;
+	int lineWidth;
+} FASTAindexEntry;
+
+typedef struct FASTAindex {
+	char *fastaName;
+	int fd;
+
+	FASTAindexEntry *entries;
+	long nEntries;
+	long nAllocated;
+	Arena *names;
+
+	/** entry + 1 for each slot of the name and id tables, 0 if empty */
+	long *nameSlots;
+	long *idSlots;
+	unsigned long capacity;
+} FASTAindex;
+
+/**
+ * Open fastaName for random access, using its ".fai" index if that
+ * is at least as new as the file, and otherwise building the index
+ * (and saving it, if possible).
+ *
+ * Returns NULL (having reported why) on failure
+ */
+FASTAindex *fastaIndexOpen(const char *fastaName);
+
+/**
+ * Build the index of fastaName by scanning the whole file.
+ *
+ * Returns NULL (having reported why) on failure
+ */
+FASTAindex *fastaIndexBuild(const char *fastaName);
+
+/** write the index in ".fai" format; returns 0 on success, -1 on failure */
+int fastaIndexWrite(FASTAindex *index, const char *faiName);
+
+/** the ordinal of the record named name, or -1 */
+long fastaIndexFindName(FASTAindex *index, const char *name);
+
+/** the ordinal of the (first) record with the given id, or -1 */
+long fastaIndexFindId(FASTAindex *index, long id);
+
+/**
+ * Read residues start (from 0) up to but not including end of the
+ * sequence of record number ordinal; an end past the sequence, or
+ * below 0, means the end of the sequence.
+ *
+ * Returns a malloc()ed string, or NULL if the range is invalid
+ */
+char *fastaIndexFetchSequence(FASTAindex *index, long ordinal,
+		long start, long end);
+
+/**
+ * Read the whole of record number ordinal into fRecord, as
+ * fastaReadRecord() would have read it.  The strings are malloc()ed,
+ * to be released with fastaClearRecord().
+ *
+ * Returns 0 on success or -1 on failure
+ */
+int fastaIndexFetchRecord(FASTAindex *index, long ordinal,
+		FASTArecord *fRecord);
+
+/** close the file and release the index */
+void fastaIndexClose(FASTAindex *index);
+
+#endif /* __FASTA_INDEX_HEADER__ */
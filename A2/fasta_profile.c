@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "fasta_profile.h"
+
+FPCounter fpCounters[FP_N_PHASES];
+
+#ifdef FASTA_PROFILE
+static const char *phaseNames_[FP_N_PHASES] = {
+	"buffer setup",
+	"I/O",
+	"description",
+	"sequence",
+	"strdup",
+	"container",
+	"teardown",
+};
+
+static uint64_t resetTicks_;
+static struct timespec resetTime_;
+#endif
+
+
+int
+fpIsEnabled(void)
+{
+#ifdef FASTA_PROFILE
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+void
+fpReset(void)
+{
+	memset(fpCounters, 0, sizeof(fpCounters));
+#ifdef FASTA_PROFILE
+	clock_gettime(CLOCK_MONOTONIC, &resetTime_);
+	resetTicks_ = fpNow_();
+#endif
+}
+
+void
+fpReport(FILE *ofp, long nRuns, double wallSeconds)
+{
+#ifdef FASTA_PROFILE
+	struct timespec now;
+	double elapsedSeconds, ticksPerSecond, seconds, totalSeconds = 0;
+	uint64_t elapsedTicks;
+	int p;
+
+	/** calibrate the tick rate over the whole profiled interval */
+	elapsedTicks = fpNow_() - resetTicks_;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	elapsedSeconds = (now.tv_sec - resetTime_.tv_sec)
+			+ ((now.tv_nsec - resetTime_.tv_nsec) / 1e9);
+	ticksPerSecond = (elapsedSeconds > 0)
+			? (double) elapsedTicks / elapsedSeconds : 1e9;
+
+	if (nRuns < 1)
+		nRuns = 1;
+
+	fprintf(ofp, "Phase breakdown, per run:\n");
+	fprintf(ofp, "    %-14s %12s %8s %12s %14s\n",
+			"phase", "ms", "% wall", "calls", "bytes");
+	for (p = 0; p < FP_N_PHASES; p++) {
+		seconds = fpCounters[p].ticks / ticksPerSecond;
+		totalSeconds += seconds;
+		fprintf(ofp, "    %-14s %12.3f %8.2f %12lu %14lu\n",
+				phaseNames_[p], 1000.0 * seconds / nRuns,
+				(wallSeconds > 0) ? 100.0 * seconds / wallSeconds : 0.0,
+				(unsigned long) (fpCounters[p].calls / nRuns),
+				(unsigned long) (fpCounters[p].bytes / nRuns));
+	}
+	fprintf(ofp, "    %-14s %12.3f %8.2f\n", "(all phases)",
+			1000.0 * totalSeconds / nRuns,
+			(wallSeconds > 0) ? 100.0 * totalSeconds / wallSeconds : 0.0);
+	fprintf(ofp, "    teardown falls outside the timed region,"
+			" so phases may sum past 100%%\n");
+#else
+	(void) nRuns;
+	(void) wallSeconds;
+	fprintf(ofp, "Phase profiling was not compiled in;"
+			" rebuild with 'make clean all PROFILE=-DFASTA_PROFILE'\n");
+#endif
+}
@@ -0,0 +1,102 @@
+
+#ifndef	__FASTA_PROFILE_HEADER__
+#define	__FASTA_PROFILE_HEADER__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Lightweight per-phase instrumentation of FASTA loading.
+ *
+ * Code to be measured is bracketed by fpStart() and fpStop(), which
+ * add the elapsed time, a call count and a byte count into the
+ * counter for the named phase.  When FASTA_PROFILE is not defined
+ * at compile time these are empty inline functions and cost nothing.
+ *
+ * On x86-64 the time stamp counter is used as the clock, and is
+ * converted to seconds using the elapsed CLOCK_MONOTONIC time between
+ * fpReset() and fpReport().  Elsewhere clock_gettime(2) is used.
+ */
+
+typedef enum FPPhase {
+	FP_BUFFER_SETUP = 0,	/* clearing the parser's line buffer */
+	FP_IO,					/* fgetc()/fgets() calls */
+	FP_DESCRIPTION,			/* checking the description, extracting the id */
+	FP_SEQUENCE,			/* collating the sequence lines */
+	FP_STRDUP,				/* copying out description and sequence */
+	FP_CONTAINER,			/* adding records to the array or list */
+	FP_TEARDOWN,			/* freeing the loaded collection */
+	FP_N_PHASES
+} FPPhase;
+
+typedef struct FPCounter {
+	uint64_t ticks;
+	uint64_t calls;
+	uint64_t bytes;
+} FPCounter;
+
+typedef uint64_t FPTimer;
+
+extern FPCounter fpCounters[FP_N_PHASES];
+
+/** is the instrumentation compiled in? */
+int  fpIsEnabled(void);
+
+/** zero all counters and note the start of the profiled interval */
+void fpReset(void);
+
+/**
+ * Print the breakdown, dividing by nRuns to give a per-run figure.
+ * wallSeconds is the total measured time, for the percentages.
+ */
+void fpReport(FILE *ofp, long nRuns, double wallSeconds);
+
+
+#ifdef FASTA_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t fpNow_(void) { return __rdtsc(); }
+#else
+#include <time.h>
+static inline uint64_t
+fpNow_(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+#endif
+
+static inline void
+fpStart(FPTimer *timer)
+{
+	*timer = fpNow_();
+}
+
+static inline void
+fpStop(FPTimer *timer, FPPhase phase, long nBytes)
+{
+	fpCounters[phase].ticks += fpNow_() - *timer;
+	fpCounters[phase].calls++;
+	fpCounters[phase].bytes += nBytes;
+}
+
+/** credit bytes to a phase whose size was only known after fpStop() */
+static inline void
+fpAddBytes(FPPhase phase, long nBytes)
+{
+	fpCounters[phase].bytes += nBytes;
+}
+
+#else /* ! FASTA_PROFILE */
+
+static inline void fpStart(FPTimer *timer) { (void) timer; }
+static inline void fpStop(FPTimer *timer, FPPhase phase, long nBytes)
+		{ (void) timer; (void) phase; (void) nBytes; }
+static inline void fpAddBytes(FPPhase phase, long nBytes)
+		{ (void) phase; (void) nBytes; }
+
+#endif /* FASTA_PROFILE */
+
+#endif /* __FASTA_PROFILE_HEADER__ */
@@ -5,49 +5,67 @@
 #include <errno.h>
 
 #include "fasta.h"
+#include "fasta_profile.h"
+#include "arena.h"
+#include "out_writer.h"
 
-static long
+/**
+ * Pull the numeric id out of a description such as
+ * ">sp|596784|PROT0_HUMAN ...", where it follows the first bar;
+ * returns -1 if there is none
+ */
+long
 fastaExtraIDfromDescription(const char *fastaIDline)
 {
 	char *firstBarLocation = NULL;
 	long extractedID;
 
 	firstBarLocation = index(fastaIDline, '|');
-	if (sscanf(firstBarLocation, "%ld|", &extractedID) != 1) {
+	if (firstBarLocation == NULL
+			|| sscanf(firstBarLocation + 1, "%ld|", &extractedID) != 1) {
 		return -1;
 	}
 	return extractedID;
 }
 
-int fastaReadRecord(FILE *ifp, FASTArecord *fRecord)
+/**
+ * copy a string out of the parse buffer, into the arena if we
+ * have one, otherwise with strdup()
+ */
+static char *
+fastaCopyString(const char *s, Arena *arena)
 {
-	/**
-	 * A line is "recommended" to be no more than 80 characters,
-	 * and the longest sequence is likely no more than 10 lines
-	 * of sequence.  The "description" portion is potentially
-	 * longer than 80 characters, so we ensure that the relatively
-	 * large buffer allocated here is sufficient for that length
-	 * as the first action within this function.
-	 *
-	 * We can allocate a fairly large buffer here without undue
-	 * concern that we are wasting memory as this buffer will be
-	 * returned to the system as a local variable when this function
-	 * returns. */
-	char linebuffer[MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH];
-	char *fgetstatus;
-	int curLoadIndex = 0, nLinesRead = 0;
-	int bytesRemain, curBytesRead;
+	if (arena != NULL)
+		return arenaStrdup(arena, s);
+	return strdup(s);
+}
 
-	/** if our assumption about the first line length is too large
-	 * to fit into the allocated buffer, panic
-	 */
-	assert(MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH
-			> MAX_DESCRIPTION_LINE_LENGTH);
+/** release a string made by fastaCopyString() on an error path */
+static void
+fastaReleaseString(char *s, Arena *arena)
+{
+	if (arena == NULL)
+		free(s);
+}
 
-	/** fill linebuffer with zeros */
-	bzero(linebuffer, MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH);
+/**
+ * Parse one record into fRecord using linebuffer, which holds
+ * MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH characters.  Every
+ * line read is terminated, so the buffer need not be cleared first,
+ * and may be reused from one record to the next.
+ */
+static int
+fastaParseRecord(FILE *ifp, FASTArecord *fRecord, Arena *arena,
+		char *linebuffer)
+{
+	char *fgetstatus;
+	int curLoadIndex = 0, nLinesRead = 0;
+	int bytesRemain, curBytesRead, nextChar;
+	FPTimer timer;
 
+	fpStart(&timer);
 	linebuffer[0] = fgetc(ifp);
+	fpStop(&timer, FP_IO, 1);
 	if (linebuffer[0] <= 0) {
 		return 0;
 	}
@@ -60,8 +78,10 @@ int fastaReadRecord(FILE *ifp, FASTArecord *fRecord)
 	 * adding the result into the current buffer
 	 */
 	curLoadIndex = 1;
+	fpStart(&timer);
 	fgetstatus = fgets(&linebuffer[curLoadIndex],
 			MAX_DESCRIPTION_LINE_LENGTH, ifp);
+	fpStop(&timer, FP_IO, 0);
 	if (fgetstatus == NULL) {
 		fprintf(stderr, "Error: FASTA parser encountered EOF"
 				" during partial description line\n");
@@ -70,6 +90,7 @@ int fastaReadRecord(FILE *ifp, FASTArecord *fRecord)
 	}
 
 	/* check if we have overflow */
+	fpStart(&timer);
 	if (linebuffer[strlen(linebuffer) - 1] != '\n') {
 		fprintf(stderr, "Error: FASTA parser read description"
 				" line greater than %d characters\n",
@@ -80,34 +101,47 @@ int fastaReadRecord(FILE *ifp, FASTArecord *fRecord)
 		return -1;
 	}
 	nLinesRead++;
-	fRecord->description = strdup(linebuffer);
+	fpAddBytes(FP_IO, strlen(linebuffer) - 1);
 	fRecord->id = fastaExtraIDfromDescription(linebuffer);
+	fpStop(&timer, FP_DESCRIPTION, strlen(linebuffer));
+
+	fpStart(&timer);
+	fRecord->description = fastaCopyString(linebuffer, arena);
+	fpStop(&timer, FP_STRDUP, strlen(linebuffer) + 1);
 
 
 	/** handle the sequence */
 	curLoadIndex = 0;
 	bytesRemain = (MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH) - 2;
+	fpStart(&timer);
 	linebuffer[curLoadIndex] = fgetc(ifp);
+	fpStop(&timer, FP_IO, 1);
 	if (linebuffer[curLoadIndex] <= 0) {
 		fprintf(stderr, "Error: FASTA parser encountered"
 					" unexpected end of file before sequence data\n");
-		free(fRecord->description);
+		fastaReleaseString(fRecord->description, arena);
 		printf("RETURNING from %d\n", __LINE__);
 		return -1;
 	}
 
-	/** collate all of the portions of the sequence */
+	/** collate all of the portions of the sequence.  The first
+	 * character of each line has already been read by fgetc(), so
+	 * the rest of the line is read in just after it */
 	while (linebuffer[curLoadIndex] > 0 && linebuffer[curLoadIndex] != '>') {
-		fgetstatus = fgets(&linebuffer[curLoadIndex], bytesRemain, ifp);
+		fpStart(&timer);
+		fgetstatus = fgets(&linebuffer[curLoadIndex + 1], bytesRemain - 1, ifp);
+		fpStop(&timer, FP_IO, 0);
 		if (fgetstatus == NULL) {
 			fprintf(stderr, "Error: FASTA parser encountered"
 					" unexpected end of file\n");
-			free(fRecord->description);
+			fastaReleaseString(fRecord->description, arena);
 		printf("RETURNING from %d\n", __LINE__);
 			return -1;
 		}
 		nLinesRead++;
+		fpStart(&timer);
 		curBytesRead = strlen(&linebuffer[curLoadIndex]);
+		fpAddBytes(FP_IO, curBytesRead);
 		if (curBytesRead >= 80) {
 			fprintf(stderr,
 					"Warning: FASTA parser read sequence of length (%d);",
@@ -128,19 +162,117 @@ int fastaReadRecord(FILE *ifp, FASTArecord *fRecord)
 		 * and if it is a new record, push it back */
 		bytesRemain -= curBytesRead;
 		curLoadIndex += curBytesRead - 1;
-		linebuffer[curLoadIndex] = fgetc(ifp);
-		if (linebuffer[curLoadIndex] == '>') {
+		fpStop(&timer, FP_SEQUENCE, curBytesRead);
+
+		fpStart(&timer);
+		nextChar = fgetc(ifp);
+		fpStop(&timer, FP_IO, 1);
+		if (nextChar == '>') {
 			ungetc('>', ifp);
 			linebuffer[curLoadIndex] = 0;
+		} else if (nextChar == EOF) {
+			/** terminate rather than store EOF as a character */
+			linebuffer[curLoadIndex] = 0;
+		} else {
+			linebuffer[curLoadIndex] = nextChar;
 		}
 	}
 
 	/** save the sequence */
-	fRecord->sequence = strdup(linebuffer);
+	fpStart(&timer);
+	fRecord->sequence = fastaCopyString(linebuffer, arena);
+	fpStop(&timer, FP_STRDUP, curLoadIndex + 1);
 
 	return nLinesRead;
 }
 
+/**
+ * Read a record, placing the description and sequence strings in
+ * arena.  The strings are then released with the arena rather than
+ * by fastaClearRecord().
+ */
+int fastaReadRecordInArena(FILE *ifp, FASTArecord *fRecord, Arena *arena)
+{
+	/**
+	 * A line is "recommended" to be no more than 80 characters,
+	 * and the longest sequence is likely no more than 10 lines
+	 * of sequence.  The "description" portion is potentially
+	 * longer than 80 characters, so we ensure that the relatively
+	 * large buffer allocated here is sufficient for that length
+	 * as the first action within this function.
+	 *
+	 * We can allocate a fairly large buffer here without undue
+	 * concern that we are wasting memory as this buffer will be
+	 * returned to the system as a local variable when this function
+	 * returns. */
+	char linebuffer[MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH];
+	FPTimer timer;
+
+	/** if our assumption about the first line length is too large
+	 * to fit into the allocated buffer, panic
+	 */
+	assert(MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH
+			> MAX_DESCRIPTION_LINE_LENGTH);
+
+	/** fill linebuffer with zeros */
+	fpStart(&timer);
+	bzero(linebuffer, MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH);
+	fpStop(&timer, FP_BUFFER_SETUP,
+			MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH);
+
+	return fastaParseRecord(ifp, fRecord, arena, linebuffer);
+}
+
+/**
+ * Read up to maxRecords records into records[], sharing one parse
+ * buffer (cleared once) and one hold of the stream's lock across the
+ * batch.  Strings go into arena, or are allocated when it is NULL.
+ * The lines read are added to *nLinesRead, if it is not NULL.
+ *
+ * Returns the number of records read, which is less than maxRecords
+ * only at the end of the file, or -1 on a parse error (when none of
+ * the batch is kept)
+ */
+int
+fastaReadRecordBatch(FILE *ifp, FASTArecord *records, int maxRecords,
+		Arena *arena, long *nLinesRead)
+{
+	char linebuffer[MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH];
+	int nRead, status;
+	FPTimer timer;
+
+	fpStart(&timer);
+	bzero(linebuffer, MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH);
+	fpStop(&timer, FP_BUFFER_SETUP,
+			MAX_SEQUENCE_LINES * RECOMMENDED_LINE_LENGTH);
+
+	flockfile(ifp);
+	for (nRead = 0; nRead < maxRecords; nRead++) {
+		fastaInitializeRecord(&records[nRead]);
+		status = fastaParseRecord(ifp, &records[nRead], arena, linebuffer);
+		if (status == 0)
+			break;
+		if (status < 0) {
+			if (arena == NULL) {
+				while (nRead > 0)
+					fastaClearRecord(&records[--nRead]);
+			}
+			funlockfile(ifp);
+			return -1;
+		}
+		if (nLinesRead != NULL)
+			*nLinesRead += status;
+	}
+	funlockfile(ifp);
+
+	return nRead;
+}
+
+int fastaReadRecord(FILE *ifp, FASTArecord *fRecord)
+{
+	return fastaReadRecordInArena(ifp, fRecord, NULL);
+}
+
 
 int
 fastaPrintRecord(FILE *ofp, FASTArecord *fRecord)
@@ -153,6 +285,61 @@ fastaPrintRecord(FILE *ofp, FASTArecord *fRecord)
 	return 0;
 }
 
+/**
+ * As fastaPrintRecord(), byte for byte, but through a buffered
+ * writer, for printing many records
+ */
+int
+fastaPrintRecordBuffered(OutWriter *ow, FASTArecord *fRecord)
+{
+	owWrite(ow, "FASTA Record:\nID   (", 20);
+	owPutLong(ow, fRecord->id);
+	owWrite(ow, ")\nDESC [", 8);
+	owPuts(ow, fRecord->description);
+	owWrite(ow, "]\nSEQ  [", 8);
+	owPuts(ow, fRecord->sequence);
+	owWrite(ow, "]\n", 2);
+
+	return ow->error ? -1 : 0;
+}
+
+/**
+ * Write the record back out as FASTA, its sequence broken into lines
+ * of lineLength residues, so that fastaReadRecord() can read it again.
+ * Returns 0, or -1 if the write failed
+ */
+int
+fastaWriteRecord(FILE *ofp, FASTArecord *fRecord, int lineLength)
+{
+	long length = strlen(fRecord->sequence), i;
+	size_t descriptionLength = strlen(fRecord->description);
+
+	fputs(fRecord->description, ofp);
+	if (descriptionLength == 0
+			|| fRecord->description[descriptionLength - 1] != '\n')
+		fputc('\n', ofp);
+	for (i = 0; i < length; i += lineLength)
+		fprintf(ofp, "%.*s\n", lineLength, fRecord->sequence + i);
+
+	return ferror(ofp) ? -1 : 0;
+}
+
+/**
+ * Locate the name of the record: the first word of its description,
+ * without the leading '>'.  The name is not terminated, so its length
+ * is returned through nameLength (print it with "%.*s")
+ */
+const char *
+fastaRecordName(FASTArecord *fRecord, int *nameLength)
+{
+	const char *name = fRecord->description;
+
+	if (*name == '>')
+		name++;
+	*nameLength = (int) strcspn(name, " \t\r\n");
+	return name;
+}
+
 /**
  * Allocate and initialize a new FASTA record
  */
@@ -179,6 +366,22 @@ fastaAllocateRecord()
 	return fRecord;
 }
 
+/**
+ * Allocate and initialize a new FASTA record within an arena;
+ * it is released with the arena, not by fastaDeallocateRecord()
+ */
+FASTArecord *
+fastaAllocateRecordInArena(Arena *arena)
+{
+	FASTArecord *fRecord = NULL;
+
+	fRecord = (FASTArecord *) arenaAlloc(arena, sizeof(FASTArecord));
+
+	fastaInitializeRecord(fRecord);
+
+	return fRecord;
+}
+
 /**
  * clear the record but do not free the fRecord pointer
  */
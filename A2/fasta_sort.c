@@ -0,0 +1,455 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "fasta_sort.h"
+#include "util.h"
+
+/** below this many records a sort is not worth sharing out */
+#define	FASTA_SORT_PARALLEL_MIN		4096
+
+/** sample elements taken for each splitter of the sample sort */
+#define	FASTA_SORT_OVERSAMPLE		64
+
+#define	RADIX_BITS		8
+#define	RADIX_BUCKETS	(1 << RADIX_BITS)
+
+/** a numeric key and the record it belongs to */
+typedef struct RadixItem {
+	uint64_t key;
+	long index;
+} RadixItem;
+
+/** a name and the record it belongs to */
+typedef struct NameItem {
+	const char *name;
+	int nameLength;
+	long index;
+} NameItem;
+
+/** one thread's share of a radix pass */
+typedef struct RadixWorker {
+	pthread_t thread;
+	RadixItem *from;
+	RadixItem *to;
+	long start;
+	long end;
+	int shift;
+	long counts[RADIX_BUCKETS];	/* then this thread's next slot for each */
+} RadixWorker;
+
+/** one thread's share of a sample sort */
+typedef struct SampleWorker {
+	pthread_t thread;
+	NameItem *from;
+	NameItem *to;
+	long start;
+	long end;
+	NameItem *splitters;
+	int nBuckets;
+	long *counts;		/* per bucket, then this thread's next slot */
+	int *bucketOf;		/* for each item in [start, end) */
+	NameItem *sortStart;
+	long sortLength;
+} SampleWorker;
+
+
+/** run fn over each of n worker structures, in threads if n > 1 */
+static void
+runWorkers_(void *workers, size_t workerSize, int n,
+		void *(*fn)(void *), pthread_t *(*threadOf)(void *))
+{
+	char *w = (char *) workers;
+	int t;
+
+	if (n == 1) {
+		fn(w);
+		return;
+	}
+	for (t = 0; t < n; t++)
+		pthread_create(threadOf(w + t * workerSize), NULL,
+				fn, w + t * workerSize);
+	for (t = 0; t < n; t++)
+		pthread_join(*threadOf(w + t * workerSize), NULL);
+}
+
+
+int
+fastaSortKeyFromName(const char *name)
+{
+	if (strcmp(name, "id") == 0)
+		return FASTA_SORT_ID;
+	if (strcmp(name, "length") == 0)
+		return FASTA_SORT_LENGTH;
+	if (strcmp(name, "name") == 0)
+		return FASTA_SORT_NAME;
+	return -1;
+}
+
+
+/*
+ * ---- radix sort of numeric keys ----
+ */
+
+static pthread_t *
+radixThread_(void *worker)
+{
+	return &((RadixWorker *) worker)->thread;
+}
+
+static void *
+radixCount_(void *arg)
+{
+	RadixWorker *worker = (RadixWorker *) arg;
+	long i;
+
+	memset(worker->counts, 0, sizeof(worker->counts));
+	for (i = worker->start; i < worker->end; i++)
+		worker->counts[(worker->from[i].key >> worker->shift)
+				& (RADIX_BUCKETS - 1)]++;
+	return NULL;
+}
+
+static void *
+radixScatter_(void *arg)
+{
+	RadixWorker *worker = (RadixWorker *) arg;
+	long i;
+
+	for (i = worker->start; i < worker->end; i++)
+		worker->to[worker->counts[(worker->from[i].key >> worker->shift)
+				& (RADIX_BUCKETS - 1)]++] = worker->from[i];
+	return NULL;
+}
+
+
+/**
+ * Sort items by key.  Each pass counts the digits of each thread's
+ * slice, then gives each (digit, thread) pair its own run of slots,
+ * so that the threads scatter independently and the order of equal
+ * digits is kept
+ */
+static void
+radixSort_(RadixItem *items, long n, int nThreads)
+{
+	RadixWorker *workers;
+	RadixItem *scratch, *from = items, *to, *swap;
+	uint64_t allOr = 0, allAnd = ~0ULL;
+	long i, slot;
+	int shift, digit, t;
+
+	for (i = 0; i < n; i++) {
+		allOr |= items[i].key;
+		allAnd &= items[i].key;
+	}
+
+	scratch = (RadixItem *) reallocOrDie(NULL, (n + 1) * sizeof(RadixItem));
+	to = scratch;
+	workers = (RadixWorker *) reallocOrDie(NULL,
+			nThreads * sizeof(RadixWorker));
+	for (t = 0; t < nThreads; t++) {
+		workers[t].start = n * t / nThreads;
+		workers[t].end = n * (t + 1) / nThreads;
+	}
+
+	for (shift = 0; shift < 64; shift += RADIX_BITS) {
+		/** a byte that is the same in every key does not reorder anything */
+		if ((((allOr ^ allAnd) >> shift) & (RADIX_BUCKETS - 1)) == 0)
+			continue;
+
+		for (t = 0; t < nThreads; t++) {
+			workers[t].from = from;
+			workers[t].to = to;
+			workers[t].shift = shift;
+		}
+		runWorkers_(workers, sizeof(RadixWorker), nThreads,
+				radixCount_, radixThread_);
+
+		slot = 0;
+		for (digit = 0; digit < RADIX_BUCKETS; digit++) {
+			for (t = 0; t < nThreads; t++) {
+				long count = workers[t].counts[digit];
+
+				workers[t].counts[digit] = slot;
+				slot += count;
+			}
+		}
+		runWorkers_(workers, sizeof(RadixWorker), nThreads,
+				radixScatter_, radixThread_);
+
+		swap = from;
+		from = to;
+		to = swap;
+	}
+
+	if (from != items)
+		memcpy(items, from, n * sizeof(RadixItem));
+	free(scratch);
+	free(workers);
+}
+
+
+/*
+ * ---- sample sort of names ----
+ */
+
+/** names in byte order, then load order, so that the order is total */
+static int
+compareNameItems_(const void *a, const void *b)
+{
+	const NameItem *na = (const NameItem *) a, *nb = (const NameItem *) b;
+	int length = (na->nameLength < nb->nameLength)
+			? na->nameLength : nb->nameLength;
+	int cmp = memcmp(na->name, nb->name, length);
+
+	if (cmp != 0)
+		return cmp;
+	if (na->nameLength != nb->nameLength)
+		return (na->nameLength < nb->nameLength) ? -1 : 1;
+	return (na->index < nb->index) ? -1 : (na->index > nb->index);
+}
+
+static pthread_t *
+sampleThread_(void *worker)
+{
+	return &((SampleWorker *) worker)->thread;
+}
+
+/** find the bucket of each item: the number of splitters below it */
+static void *
+sampleClassify_(void *arg)
+{
+	SampleWorker *worker = (SampleWorker *) arg;
+	int low, high, mid;
+	long i;
+
+	memset(worker->counts, 0, worker->nBuckets * sizeof(long));
+	for (i = worker->start; i < worker->end; i++) {
+		low = 0;
+		high = worker->nBuckets - 1;
+		while (low < high) {
+			mid = (low + high) / 2;
+			if (compareNameItems_(&worker->from[i], &worker->splitters[mid]) < 0)
+				high = mid;
+			else
+				low = mid + 1;
+		}
+		worker->bucketOf[i - worker->start] = low;
+		worker->counts[low]++;
+	}
+	return NULL;
+}
+
+static void *
+sampleScatter_(void *arg)
+{
+	SampleWorker *worker = (SampleWorker *) arg;
+	long i;
+
+	for (i = worker->start; i < worker->end; i++)
+		worker->to[worker->counts[worker->bucketOf[i - worker->start]]++]
+				= worker->from[i];
+	return NULL;
+}
+
+static void *
+sampleSortBucket_(void *arg)
+{
+	SampleWorker *worker = (SampleWorker *) arg;
+
+	qsort(worker->sortStart, worker->sortLength, sizeof(NameItem),
+			compareNameItems_);
+	return NULL;
+}
+
+
+static void
+sampleSort_(NameItem *items, long n, int nThreads)
+{
+	SampleWorker *workers;
+	NameItem *sample, *splitters, *scratch;
+	long nSample, i, slot, count, bucketStart;
+	int t, b;
+
+	if (nThreads == 1 || n < FASTA_SORT_PARALLEL_MIN) {
+		qsort(items, n, sizeof(NameItem), compareNameItems_);
+		return;
+	}
+
+	/** an evenly spaced sample, sorted, gives the splitters */
+	nSample = (long) nThreads * FASTA_SORT_OVERSAMPLE;
+	sample = (NameItem *) reallocOrDie(NULL, nSample * sizeof(NameItem));
+	for (i = 0; i < nSample; i++)
+		sample[i] = items[i * (n / nSample)];
+	qsort(sample, nSample, sizeof(NameItem), compareNameItems_);
+	splitters = (NameItem *) reallocOrDie(NULL, nThreads * sizeof(NameItem));
+	for (b = 0; b < nThreads - 1; b++)
+		splitters[b] = sample[(b + 1) * FASTA_SORT_OVERSAMPLE];
+
+	scratch = (NameItem *) reallocOrDie(NULL, n * sizeof(NameItem));
+	workers = (SampleWorker *) calloc(nThreads, sizeof(SampleWorker));
+	for (t = 0; t < nThreads; t++) {
+		workers[t].from = items;
+		workers[t].to = scratch;
+		workers[t].start = n * t / nThreads;
+		workers[t].end = n * (t + 1) / nThreads;
+		workers[t].splitters = splitters;
+		workers[t].nBuckets = nThreads;
+		workers[t].counts = (long *) reallocOrDie(NULL,
+				nThreads * sizeof(long));
+		workers[t].bucketOf = (int *) reallocOrDie(NULL, (workers[t].end
+				- workers[t].start + 1) * sizeof(int));
+	}
+	runWorkers_(workers, sizeof(SampleWorker), nThreads,
+			sampleClassify_, sampleThread_);
+
+	/** bucket b of thread t follows bucket b of every earlier thread */
+	slot = 0;
+	for (b = 0; b < nThreads; b++) {
+		bucketStart = slot;
+		for (t = 0; t < nThreads; t++) {
+			count = workers[t].counts[b];
+			workers[t].counts[b] = slot;
+			slot += count;
+		}
+		workers[b].sortStart = scratch + bucketStart;
+		workers[b].sortLength = slot - bucketStart;
+	}
+	runWorkers_(workers, sizeof(SampleWorker), nThreads,
+			sampleScatter_, sampleThread_);
+	runWorkers_(workers, sizeof(SampleWorker), nThreads,
+			sampleSortBucket_, sampleThread_);
+
+	memcpy(items, scratch, n * sizeof(NameItem));
+
+	for (t = 0; t < nThreads; t++) {
+		free(workers[t].counts);
+		free(workers[t].bucketOf);
+	}
+	free(workers);
+	free(scratch);
+	free(splitters);
+	free(sample);
+}
+
+
+/** the numeric sort key of a record; ids are signed, so flip the sign bit */
+static uint64_t
+numericKey_(FASTArecord *record, FASTAsortKey key)
+{
+	if (key == FASTA_SORT_ID)
+		return (uint64_t) record->id ^ (1ULL << 63);
+	return (uint64_t) strlen(record->sequence);
+}
+
+
+long *
+fastaSortPermutation(FASTAstore *store, FASTAsortKey key, int nThreads)
+{
+	long *order, n = store->nRecords, i;
+	RadixItem *radixItems;
+	NameItem *nameItems;
+
+	if (nThreads < 1 || n < FASTA_SORT_PARALLEL_MIN)
+		nThreads = 1;
+	order = (long *) reallocOrDie(NULL, (n + 1) * sizeof(long));
+
+	if (key == FASTA_SORT_NAME) {
+		nameItems = (NameItem *) reallocOrDie(NULL, (n + 1) * sizeof(NameItem));
+		for (i = 0; i < n; i++) {
+			nameItems[i].name = fastaRecordName(&store->records[i],
+					&nameItems[i].nameLength);
+			nameItems[i].index = i;
+		}
+		sampleSort_(nameItems, n, nThreads);
+		for (i = 0; i < n; i++)
+			order[i] = nameItems[i].index;
+		free(nameItems);
+	} else {
+		radixItems = (RadixItem *) reallocOrDie(NULL,
+				(n + 1) * sizeof(RadixItem));
+		for (i = 0; i < n; i++) {
+			radixItems[i].key = numericKey_(&store->records[i], key);
+			radixItems[i].index = i;
+		}
+		radixSort_(radixItems, n, nThreads);
+		for (i = 0; i < n; i++)
+			order[i] = radixItems[i].index;
+		free(radixItems);
+	}
+
+	return order;
+}
+
+
+int
+fastaCompareRecordKeys(FASTArecord *a, FASTArecord *b, FASTAsortKey key)
+{
+	NameItem na, nb;
+	uint64_t ka, kb;
+
+	if (key == FASTA_SORT_NAME) {
+		na.name = fastaRecordName(a, &na.nameLength);
+		nb.name = fastaRecordName(b, &nb.nameLength);
+		na.index = nb.index = 0;
+		return compareNameItems_(&na, &nb);
+	}
+	ka = numericKey_(a, key);
+	kb = numericKey_(b, key);
+	return (ka < kb) ? -1 : (ka > kb);
+}
+
+
+int
+fastaCompareRecords(FASTAstore *store, long a, FASTAstore *otherStore,
+		long b, FASTAsortKey key)
+{
+	return fastaCompareRecordKeys(&store->records[a],
+			&otherStore->records[b], key);
+}
+
+
+long
+fastaMergeJoin(FASTAstore *oldStore, long *oldOrder,
+		FASTAstore *newStore, long *newOrder, FASTAsortKey key,
+		FASTAdiffFn diffFn, void *context)
+{
+	FASTArecord *oldRecord, *newRecord;
+	FASTAdiffKind kind;
+	long i = 0, j = 0, nDiffer = 0;
+	int cmp;
+
+	while (i < oldStore->nRecords || j < newStore->nRecords) {
+		if (i >= oldStore->nRecords)
+			cmp = 1;
+		else if (j >= newStore->nRecords)
+			cmp = -1;
+		else
+			cmp = fastaCompareRecords(oldStore, oldOrder[i],
+					newStore, newOrder[j], key);
+
+		if (cmp < 0) {
+			diffFn(FASTA_DIFF_REMOVED, oldOrder[i++], -1, context);
+			nDiffer++;
+		} else if (cmp > 0) {
+			diffFn(FASTA_DIFF_ADDED, -1, newOrder[j++], context);
+			nDiffer++;
+		} else {
+			oldRecord = &oldStore->records[oldOrder[i]];
+			newRecord = &newStore->records[newOrder[j]];
+			if (strcmp(oldRecord->sequence, newRecord->sequence) != 0)
+				kind = FASTA_DIFF_SEQUENCE;
+			else if (strcmp(oldRecord->description,
+					newRecord->description) != 0)
+				kind = FASTA_DIFF_DESCRIPTION;
+			else
+				kind = FASTA_DIFF_SAME;
+			if (kind != FASTA_DIFF_SAME)
+				nDiffer++;
+			diffFn(kind, oldOrder[i++], newOrder[j++], context);
+		}
+	}
+	return nDiffer;
+}
@@ -0,0 +1,70 @@
+
+#ifndef	__FASTA_SORT_HEADER__
+#define	__FASTA_SORT_HEADER__
+
+#include "fasta_store.h"
+
+/**
+ * Ordering and comparing the records of a FASTAstore.
+ *
+ * The records themselves are never moved: a sort produces a
+ * permutation, an array giving the index of each record in sorted
+ * order.  Sorts are stable, so records with equal keys keep their
+ * load order.
+ *
+ * Numeric keys (id, length) are sorted by a parallel LSD radix sort,
+ * one byte per pass, skipping bytes that are the same in every key.
+ * Names are sorted by a parallel sample sort: a sorted sample picks
+ * one splitter per thread, the records are dealt into the buckets
+ * between splitters, and each thread sorts one bucket.
+ */
+
+typedef enum FASTAsortKey {
+	FASTA_SORT_ID = 0,
+	FASTA_SORT_LENGTH,
+	FASTA_SORT_NAME		/* the first word of the description */
+} FASTAsortKey;
+
+/** what a merge-join found for one record (or pair of records) */
+typedef enum FASTAdiffKind {
+	FASTA_DIFF_REMOVED = 0,		/* only in the old store */
+	FASTA_DIFF_ADDED,			/* only in the new store */
+	FASTA_DIFF_SEQUENCE,		/* in both, with a different sequence */
+	FASTA_DIFF_DESCRIPTION,		/* in both, only the description differs */
+	FASTA_DIFF_SAME
+} FASTAdiffKind;
+
+/** called for each result of a merge-join; a missing side is -1 */
+typedef void (*FASTAdiffFn)(FASTAdiffKind kind, long oldRecord,
+		long newRecord, void *context);
+
+/** parse a key name ("id", "length" or "name"); returns -1 if unknown */
+int fastaSortKeyFromName(const char *name);
+
+/**
+ * Sort the records of store by key using nThreads threads.
+ *
+ * Returns a malloc()ed array of store->nRecords record indices
+ */
+long *fastaSortPermutation(FASTAstore *store, FASTAsortKey key, int nThreads);
+
+/** compare two records by key, as the sort orders them (ignoring load order) */
+int fastaCompareRecordKeys(FASTArecord *a, FASTArecord *b, FASTAsortKey key);
+
+/** compare records a and b of store by key, as the sort orders them */
+int fastaCompareRecords(FASTAstore *store, long a, FASTAstore *otherStore,
+		long b, FASTAsortKey key);
+
+/**
+ * Walk two stores, each in the order of its permutation sorted by
+ * key (FASTA_SORT_ID or FASTA_SORT_NAME), pairing records with equal
+ * keys and reporting each pair or unpaired record to diffFn in key
+ * order.  Records sharing a key are paired off in order.
+ *
+ * Returns the number of records that differ (all but FASTA_DIFF_SAME)
+ */
+long fastaMergeJoin(FASTAstore *oldStore, long *oldOrder,
+		FASTAstore *newStore, long *newOrder, FASTAsortKey key,
+		FASTAdiffFn diffFn, void *context);
+
+#endif /* __FASTA_SORT_HEADER__ */
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "fasta_store.h"
+#include "fasta_cache.h"
+#include "compressed_input.h"
+
+#define	FASTA_STORE_INITIAL_SIZE	1024
+
+/** records are parsed straight into the array this many at a time */
+#define	FASTA_STORE_READ_BATCH		256
+
+
+void
+fastaStoreInit(FASTAstore *store)
+{
+	store->records = NULL;
+	store->nRecords = 0;
+	store->nAllocated = 0;
+	store->arena = NULL;
+	store->dedup = NULL;
+	store->mappings = NULL;
+	store->useCache = 0;
+}
+
+
+void
+fastaStoreEnableDedup(FASTAstore *store)
+{
+	FASTArecord *fRecord;
+	long i;
+
+	if (store->dedup != NULL)
+		return;
+
+	/**
+	 * Records already loaded join the table too, so that they share
+	 * bodies with the rest; their duplicate copies stay where they
+	 * are, as only the last thing put in the arena can be handed back
+	 */
+	store->dedup = fastaDedupCreate();
+	for (i = 0; i < store->nRecords; i++) {
+		fRecord = &store->records[i];
+		fRecord->sequence = fastaDedupAdd(store->dedup,
+				fRecord->sequence, i);
+	}
+	store->dedup->bytesShared = 0;
+}
+
+
+void
+fastaStoreEnableCache(FASTAstore *store)
+{
+	store->useCache = 1;
+}
+
+
+void
+fastaStoreReserve(FASTAstore *store, long nMore)
+{
+	if (store->nRecords + nMore <= store->nAllocated)
+		return;
+
+	if (store->nAllocated == 0)
+		store->nAllocated = FASTA_STORE_INITIAL_SIZE;
+	while (store->nAllocated < store->nRecords + nMore)
+		store->nAllocated *= 2;
+	store->records = (FASTArecord *) realloc(store->records,
+			store->nAllocated * sizeof(FASTArecord));
+	if (store->records == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+}
+
+
+/** parse filename, adding its records to the store */
+static long
+fastaStoreParse(FASTAstore *store, char *filename)
+{
+	FILE *fp;
+	FASTArecord *fRecord;
+	char *sharedSequence;
+	long lineNumber = 0, nLoaded = 0;
+	int i, nRead, batchSize;
+
+	fp = ciOpen(filename);
+	if (fp == NULL) {
+		fprintf(stderr, "Failure opening %s : %s\n",
+				filename, strerror(errno));
+		return -1;
+	}
+
+	if (store->arena == NULL)
+		store->arena = arenaCreate(0);
+
+	/**
+	 * A duplicate sequence body is handed back to the arena, which
+	 * can only be done while it is the last thing the reader put
+	 * there, so deduplicating stores read one record at a time
+	 */
+	batchSize = (store->dedup != NULL) ? 1 : FASTA_STORE_READ_BATCH;
+
+	for (;;) {
+		fastaStoreReserve(store, batchSize);
+		nRead = fastaReadRecordBatch(fp, &store->records[store->nRecords],
+				batchSize, store->arena, &lineNumber);
+		if (nRead == 0)
+			break;
+
+		if (nRead < 0) {
+			fprintf(stderr, "Error: failure at line %ld of '%s'\n",
+					lineNumber, filename);
+			fclose(fp);
+			return -1;
+		}
+
+		for (i = 0; i < nRead && store->dedup != NULL; i++) {
+			fRecord = &store->records[store->nRecords + i];
+			sharedSequence = fastaDedupAdd(store->dedup,
+					fRecord->sequence, store->nRecords + i);
+			if (sharedSequence != fRecord->sequence) {
+				arenaUnwind(store->arena, fRecord->sequence,
+						strlen(fRecord->sequence) + 1);
+				fRecord->sequence = sharedSequence;
+			}
+		}
+
+		store->nRecords += nRead;
+		nLoaded += nRead;
+	}
+
+	fclose(fp);
+	return nLoaded;
+}
+
+
+long
+fastaStoreLoad(FASTAstore *store, char *filename)
+{
+	char *cacheName;
+	long firstRecord = store->nRecords, nLoaded;
+
+	if (!store->useCache)
+		return fastaStoreParse(store, filename);
+
+	cacheName = fastaCacheName(filename);
+	nLoaded = fastaCacheLoad(store, filename, cacheName);
+	if (nLoaded < 0) {
+		nLoaded = fastaStoreParse(store, filename);
+		if (nLoaded >= 0 && fastaCacheWrite(store, firstRecord, nLoaded,
+				filename, cacheName) < 0) {
+			fprintf(stderr, "Warning: could not cache '%s' as '%s'\n",
+					filename, cacheName);
+		}
+	}
+	free(cacheName);
+	return nLoaded;
+}
+
+
+long
+fastaStoreResidues(FASTAstore *store)
+{
+	long i, total = 0;
+
+	for (i = 0; i < store->nRecords; i++)
+		total += strlen(store->records[i].sequence);
+	return total;
+}
+
+
+void
+fastaStoreFree(FASTAstore *store)
+{
+	FASTAstoreMapping *mapping, *next;
+
+	free(store->records);
+	if (store->arena != NULL)
+		arenaDestroy(store->arena);
+	fastaDedupFree(store->dedup);
+	for (mapping = store->mappings; mapping != NULL; mapping = next) {
+		next = mapping->next;
+		munmap(mapping->address, mapping->size);
+		free(mapping);
+	}
+	fastaStoreInit(store);
+}
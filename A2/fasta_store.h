@@ -0,0 +1,71 @@
+
+#ifndef	__FASTA_STORE_HEADER__
+#define	__FASTA_STORE_HEADER__
+
+#include "fasta.h"
+#include "arena.h"
+#include "fasta_dedup.h"
+
+/** a binary cache mapped into the store (see fasta_cache.h) */
+typedef struct FASTAstoreMapping {
+	void *address;
+	size_t size;
+	struct FASTAstoreMapping *next;
+} FASTAstoreMapping;
+
+/**
+ * A loaded set of FASTA records.
+ *
+ * This is the arraydouble design packaged for reuse by the analysis
+ * tools: a doubling array of FASTArecord whose strings live in an
+ * arena, or in a mapped binary cache, so a whole store is released
+ * with fastaStoreFree().
+ */
+typedef struct FASTAstore {
+	FASTArecord *records;
+	long nRecords;
+	long nAllocated;
+	Arena *arena;
+	FASTAdedup *dedup;	/* NULL unless deduplication is enabled */
+	FASTAstoreMapping *mappings;
+	int useCache;
+} FASTAstore;
+
+/** set up an empty store */
+void fastaStoreInit(FASTAstore *store);
+
+/**
+ * Store each distinct sequence body only once: records loaded from
+ * now on whose sequence matches one already held share that copy.
+ * Records already in the store are added to the table as well, and
+ * share bodies from then on, though their copies are not freed.
+ * The clusters of records sharing a body are kept in store->dedup
+ */
+void fastaStoreEnableDedup(FASTAstore *store);
+
+/**
+ * Load files through their binary caches from now on: a file with an
+ * up to date cache is mapped rather than parsed, and one without is
+ * parsed and then cached for next time.  Records loaded from a cache
+ * point into read-only memory.
+ */
+void fastaStoreEnableCache(FASTAstore *store);
+
+/** make room for at least nMore further records */
+void fastaStoreReserve(FASTAstore *store, long nMore);
+
+/**
+ * Load every record of filename (which may be compressed) onto the
+ * end of the store.
+ *
+ * Returns the number of records loaded, or -1 on failure
+ */
+long fastaStoreLoad(FASTAstore *store, char *filename);
+
+/** the total number of sequence residues held in the store */
+long fastaStoreResidues(FASTAstore *store);
+
+/** release everything held by the store, leaving it empty */
+void fastaStoreFree(FASTAstore *store);
+
+#endif /* __FASTA_STORE_HEADER__ */
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "fasta_store.h"
+#include "fasta_cache.h"
+#include "util.h"
+
+
+/** returns 1 if both stores hold the same records */
+int sameRecords(FASTAstore *a, FASTAstore *b)
+{
+	long i;
+
+	if (a->nRecords != b->nRecords)
+		return 0;
+	for (i = 0; i < a->nRecords; i++) {
+		if (a->records[i].id != b->records[i].id
+				|| strcmp(a->records[i].description,
+					b->records[i].description) != 0
+				|| strcmp(a->records[i].sequence,
+					b->records[i].sequence) != 0)
+			return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Parse filename, write its cache, and load the cache back,
+ * reporting how long each step took
+ */
+int buildCache(char *filename, int dedup)
+{
+	FASTAstore parsed, cached;
+	struct timespec startTime;
+	struct stat sb;
+	double parseSeconds, writeSeconds, loadSeconds;
+	char *cacheName = fastaCacheName(filename);
+	int status = 0;
+
+	fastaStoreInit(&parsed);
+	fastaStoreInit(&cached);
+	if (dedup)
+		fastaStoreEnableDedup(&parsed);
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	if (fastaStoreLoad(&parsed, filename) < 0) {
+		free(cacheName);
+		return -1;
+	}
+	parseSeconds = secondsSince(&startTime);
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	if (fastaCacheWrite(&parsed, 0, parsed.nRecords,
+			filename, cacheName) < 0) {
+		fprintf(stderr, "Error: cannot write cache '%s'\n", cacheName);
+		status = -1;
+	}
+	writeSeconds = secondsSince(&startTime);
+
+	if (status == 0) {
+		clock_gettime(CLOCK_MONOTONIC, &startTime);
+		if (fastaCacheLoad(&cached, filename, cacheName) < 0)
+			status = -1;
+		loadSeconds = secondsSince(&startTime);
+
+		if (status == 0 && !sameRecords(&parsed, &cached)) {
+			fprintf(stderr, "Error: cache '%s' does not match '%s'\n",
+					cacheName, filename);
+			status = -1;
+		}
+	}
+
+	if (status == 0) {
+		stat(cacheName, &sb);
+		printf("%s: %ld records parsed in %lf seconds\n",
+				filename, parsed.nRecords, parseSeconds);
+		printf("    %s: %ld bytes written in %lf seconds,"
+				" loaded in %lf seconds (%.1fx faster than parsing)\n",
+				cacheName, (long) sb.st_size, writeSeconds, loadSeconds,
+				(loadSeconds > 0) ? parseSeconds / loadSeconds : 0.0);
+	}
+
+	fastaStoreFree(&parsed);
+	fastaStoreFree(&cached);
+	free(cacheName);
+	return status;
+}
+
+
+/** report whether the cache of filename can be used */
+int checkCache(char *filename)
+{
+	FASTAstore cached;
+	char *cacheName = fastaCacheName(filename);
+	long nRecords;
+
+	fastaStoreInit(&cached);
+	nRecords = fastaCacheLoad(&cached, filename, cacheName);
+	if (nRecords < 0)
+		printf("%s: no usable cache\n", filename);
+	else
+		printf("%s: cache '%s' is up to date (%ld records)\n",
+				filename, cacheName, nRecords);
+
+	fastaStoreFree(&cached);
+	free(cacheName);
+	return (nRecords < 0) ? -1 : 0;
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Writes a binary cache beside each FASTA file (named <file>%s),\n",
+			FASTA_CACHE_SUFFIX);
+	fprintf(stderr, "which the analysis tools load in place of the file with -C.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-c           : only check whether each cache is up to date.\n");
+	fprintf(stderr, "-u           : store each distinct sequence once in the cache.\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	int i, checkOnly = 0, dedup = 0, nFiles = 0, nFailed = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			if (argv[i][1] == 'c') {
+				checkOnly = 1;
+			} else if (argv[i][1] == 'u') {
+				dedup = 1;
+			} else {
+				fprintf(stderr,
+						"Error: unknown option '%s'\n", argv[i]);
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			if ((checkOnly ? checkCache(argv[i])
+					: buildCache(argv[i], dedup)) < 0)
+				nFailed++;
+			nFiles++;
+		}
+	}
+
+	if (nFiles == 0) {
+		fprintf(stderr,
+				"No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+
+	return (nFailed > 0) ? 1 : 0;
+}
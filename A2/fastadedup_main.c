@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fasta_store.h"
+#include "util.h"
+
+
+/** the clusters are sorted by this during the report */
+static FASTAdedup *sortDedup_;
+
+/** largest clusters first, then in the order their bodies were first seen */
+static int
+compareClusters(const void *a, const void *b)
+{
+	const FASTAdedupCluster *ca = &sortDedup_->clusters[*(const long *) a];
+	const FASTAdedupCluster *cb = &sortDedup_->clusters[*(const long *) b];
+
+	if (ca->nRecords != cb->nRecords)
+		return (ca->nRecords > cb->nRecords) ? -1 : 1;
+	return (ca->firstRecord < cb->firstRecord) ? -1 : 1;
+}
+
+
+/**
+ * list every cluster of at least minSize records, naming the
+ * records that share each body
+ */
+void printClusters(FASTAstore *store, long minSize)
+{
+	FASTAdedup *dedup = store->dedup;
+	FASTAdedupCluster *cluster;
+	const char *name;
+	long *order, nListed = 0, c, r;
+	int nameLength;
+
+	order = (long *) malloc(dedup->nClusters * sizeof(long));
+	for (c = 0; c < dedup->nClusters; c++)
+		if (dedup->clusters[c].nRecords >= minSize)
+			order[nListed++] = c;
+
+	sortDedup_ = dedup;
+	qsort(order, nListed, sizeof(long), compareClusters);
+
+	for (c = 0; c < nListed; c++) {
+		cluster = &dedup->clusters[order[c]];
+		printf("Cluster %ld: %ld records, length %lu, hash %016llx\n",
+				c + 1, cluster->nRecords, (unsigned long) cluster->length,
+				(unsigned long long) cluster->hash);
+		for (r = cluster->firstRecord; r >= 0; r = dedup->nextRecord[r]) {
+			name = fastaRecordName(&store->records[r], &nameLength);
+			printf("    %.*s\n", nameLength, name);
+		}
+	}
+
+	free(order);
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Loads FASTA records from all files, storing each distinct\n");
+	fprintf(stderr, "sequence only once, and reports the records sharing a sequence.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-l           : list the duplicate clusters.\n");
+	fprintf(stderr, "-m <N>       : list only clusters of at least N records (default 2).\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	FASTAstore store;
+	FASTAdedup *dedup;
+	struct timespec startTime;
+	double loadSeconds;
+	int i, listClusters = 0, nFiles = 0;
+	long status, minSize = 2;
+	size_t storedBytes;
+
+	fastaStoreInit(&store);
+	fastaStoreEnableDedup(&store);
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			if (argv[i][1] == 'l') {
+				listClusters = 1;
+			} else if (argv[i][1] == 'm' && i + 1 < argc) {
+				minSize = atol(argv[++i]);
+			} else {
+				fprintf(stderr,
+						"Error: unknown option '%s'\n", argv[i]);
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			status = fastaStoreLoad(&store, argv[i]);
+			if (status < 0) {
+				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+						argv[i]);
+				fastaStoreFree(&store);
+				return 1;
+			}
+			nFiles++;
+		}
+	}
+
+	if (nFiles == 0) {
+		fprintf(stderr,
+				"No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+
+	loadSeconds = secondsSince(&startTime);
+	dedup = store.dedup;
+	storedBytes = store.arena->bytesRequested;
+
+	printf("%ld FASTA records loaded from %d files in %lf seconds\n",
+			store.nRecords, nFiles, loadSeconds);
+	printf("%ld distinct sequences, %ld duplicate records"
+			" in %ld shared clusters\n",
+			dedup->nClusters, dedup->nDuplicates,
+			fastaDedupSharedClusters(dedup));
+	printf("%lu bytes stored, %lu sequence bytes shared"
+			" rather than stored again (%.1f%% saved)\n",
+			(unsigned long) storedBytes, (unsigned long) dedup->bytesShared,
+			(storedBytes + dedup->bytesShared > 0)
+				? 100.0 * dedup->bytesShared
+					/ (storedBytes + dedup->bytesShared)
+				: 0.0);
+
+	if (listClusters && minSize > 0)
+		printClusters(&store, minSize);
+
+	fastaStoreFree(&store);
+
+	return 0;
+}
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fasta_store.h"
+#include "fasta_sort.h"
+#include "util.h"
+
+
+/** the stores being compared, and the tallies of each kind of result */
+typedef struct DiffReport {
+	FASTAstore *oldStore;
+	FASTAstore *newStore;
+	long tally[FASTA_DIFF_SAME + 1];
+	int listSame;
+} DiffReport;
+
+static const char diffMarks_[] = "-+~d=";
+
+
+/** print one result of the join as a mark and the record name */
+void printDifference(FASTAdiffKind kind, long oldRecord, long newRecord,
+		void *context)
+{
+	DiffReport *report = (DiffReport *) context;
+	FASTArecord *record;
+	const char *name;
+	int nameLength;
+
+	report->tally[kind]++;
+	if (kind == FASTA_DIFF_SAME && !report->listSame)
+		return;
+
+	record = (oldRecord >= 0) ? &report->oldStore->records[oldRecord]
+			: &report->newStore->records[newRecord];
+	name = fastaRecordName(record, &nameLength);
+	printf("%c\t%.*s\n", diffMarks_[kind], nameLength, name);
+}
+
+
+int loadStore(FASTAstore *store, char *filename, int useCache)
+{
+	fastaStoreInit(store);
+	if (useCache)
+		fastaStoreEnableCache(store);
+	if (fastaStoreLoad(store, filename) < 0) {
+		fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+				filename);
+		return -1;
+	}
+	return 0;
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <old file> <new file>\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Compares two FASTA files (such as two releases of a database)\n");
+	fprintf(stderr, "record by record, matching records by name or id, and lists\n");
+	fprintf(stderr, "each difference as a mark and the record name:\n");
+	fprintf(stderr, "    -  removed      + added\n");
+	fprintf(stderr, "    ~  sequence changed\n");
+	fprintf(stderr, "    d  only the description changed\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-k <KEY>     : match records by name (default) or id.\n");
+	fprintf(stderr, "-a           : also list unchanged records (marked '=').\n");
+	fprintf(stderr, "-t <THREADS> : sort threads (default: one per CPU).\n");
+	fprintf(stderr, "-C           : load the files through their binary caches.\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	FASTAstore oldStore, newStore;
+	DiffReport report;
+	struct timespec startTime;
+	double sortSeconds, joinSeconds;
+	char *files[2];
+	long *oldOrder, *newOrder, nDiffer;
+	int i, key = FASTA_SORT_NAME, useCache = 0, nFiles = 0;
+	int nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+	memset(&report, 0, sizeof(report));
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			if (argv[i][1] == 'a') {
+				report.listSame = 1;
+			} else if (argv[i][1] == 'C') {
+				useCache = 1;
+			} else if (i + 1 >= argc) {
+				fprintf(stderr, "Error: option '%s' needs an argument\n",
+						argv[i]);
+				return 1;
+			} else if (argv[i][1] == 't') {
+				nThreads = atoi(argv[++i]);
+			} else if (argv[i][1] == 'k') {
+				key = fastaSortKeyFromName(argv[++i]);
+				if (key != FASTA_SORT_NAME && key != FASTA_SORT_ID) {
+					fprintf(stderr, "Error: records are matched by"
+							" name or id, not '%s'\n", argv[i]);
+					return 1;
+				}
+			} else {
+				fprintf(stderr,
+						"Error: unknown option '%s'\n", argv[i]);
+				usage(argv[0]);
+				return 1;
+			}
+		} else if (nFiles < 2) {
+			files[nFiles++] = argv[i];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (nFiles != 2) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (loadStore(&oldStore, files[0], useCache) < 0
+			|| loadStore(&newStore, files[1], useCache) < 0)
+		return 1;
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	oldOrder = fastaSortPermutation(&oldStore, key, nThreads);
+	newOrder = fastaSortPermutation(&newStore, key, nThreads);
+	sortSeconds = secondsSince(&startTime);
+
+	report.oldStore = &oldStore;
+	report.newStore = &newStore;
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	nDiffer = fastaMergeJoin(&oldStore, oldOrder, &newStore, newOrder, key,
+			printDifference, &report);
+	joinSeconds = secondsSince(&startTime);
+
+	fprintf(stderr, "%ld old and %ld new records: %ld removed, %ld added,"
+			" %ld sequences changed, %ld descriptions changed,"
+			" %ld unchanged\n", oldStore.nRecords, newStore.nRecords,
+			report.tally[FASTA_DIFF_REMOVED], report.tally[FASTA_DIFF_ADDED],
+			report.tally[FASTA_DIFF_SEQUENCE],
+			report.tally[FASTA_DIFF_DESCRIPTION],
+			report.tally[FASTA_DIFF_SAME]);
+	fprintf(stderr, "sorted in %lf seconds, joined in %lf seconds\n",
+			sortSeconds, joinSeconds);
+
+	free(oldOrder);
+	free(newOrder);
+	fastaStoreFree(&oldStore);
+	fastaStoreFree(&newStore);
+
+	return (nDiffer > 0) ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "fasta_index.h"
+#include "util.h"
+
+/** the line length used for the sequence of a region */
+#define	REGION_LINE_LENGTH	60
+
+
+/**
+ * find a record by key: "#N" for the Nth record, otherwise its
+ * name, or failing that its numeric id
+ */
+long lookupKey(FASTAindex *index, const char *key)
+{
+	long ordinal;
+	const char *p;
+	char *end;
+
+	/** only a whole "#N", so "#N:BEGIN-END" is left to parseRegion() */
+	if (key[0] == '#') {
+		ordinal = strtol(key + 1, &end, 10);
+		if (end == key + 1 || *end != '\0' || ordinal < 1)
+			return -1;
+		return ordinal - 1;
+	}
+
+	ordinal = fastaIndexFindName(index, key);
+	if (ordinal >= 0 || *key == '\0')
+		return ordinal;
+
+	for (p = key; *p != '\0'; p++)
+		if (!isdigit((unsigned char) *p))
+			return -1;
+	return fastaIndexFindId(index, atol(key));
+}
+
+
+/**
+ * Parse a region of the form KEY or KEY:BEGIN-END (positions from 1,
+ * inclusive, as in samtools), giving the residues [*start, *end)
+ */
+long parseRegion(FASTAindex *index, const char *region, long *start, long *end)
+{
+	char *key, *colon;
+	long ordinal, begin, last;
+	int n;
+
+	*start = 0;
+	*end = -1;
+	if ((ordinal = lookupKey(index, region)) >= 0)
+		return ordinal;
+
+	key = strdup(region);
+	colon = strrchr(key, ':');
+	if (colon == NULL) {
+		free(key);
+		return -1;
+	}
+	*colon = '\0';
+
+	n = sscanf(colon + 1, "%ld-%ld", &begin, &last);
+	if (n < 1 || begin < 1 || (n == 2 && last < begin)) {
+		free(key);
+		return -1;
+	}
+	*start = begin - 1;
+	*end = (n == 2) ? last : -1;
+
+	ordinal = lookupKey(index, key);
+	free(key);
+	return ordinal;
+}
+
+
+void printWrapped(const char *sequence, int lineLength)
+{
+	long length = strlen(sequence), i;
+
+	if (lineLength <= 0)
+		lineLength = REGION_LINE_LENGTH;
+	for (i = 0; i < length; i += lineLength)
+		printf("%.*s\n", lineLength, sequence + i);
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s <file> [ <region> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "With only a file, (re)builds its samtools compatible index\n");
+	fprintf(stderr, "<file>%s.  Otherwise prints each region, read directly using\n",
+			FASTA_INDEX_SUFFIX);
+	fprintf(stderr, "the index (which is built first if it is missing or old).\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "A region is a record, or part of one, given as:\n");
+	fprintf(stderr, "    NAME           the record named NAME\n");
+	fprintf(stderr, "    ID             the record with this numeric id\n");
+	fprintf(stderr, "    #N             the Nth record of the file\n");
+	fprintf(stderr, "    KEY:BEGIN-END  residues BEGIN to END (from 1) of a record\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	FASTAindex *index;
+	FASTArecord fRecord;
+	struct timespec startTime;
+	double seconds;
+	char *sequence, faiName[FILENAME_MAX];
+	long ordinal, start, end;
+	int i, nFetched, nFailed = 0;
+
+	if (argc < 2 || argv[1][0] == '-') {
+		usage(argv[0]);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	if (argc == 2) {
+		index = fastaIndexBuild(argv[1]);
+		snprintf(faiName, sizeof(faiName), "%s%s", argv[1], FASTA_INDEX_SUFFIX);
+		if (index == NULL || fastaIndexWrite(index, faiName) < 0) {
+			fprintf(stderr, "Error: cannot index '%s'\n", argv[1]);
+			fastaIndexClose(index);
+			return 1;
+		}
+		printf("%ld records of '%s' indexed in %lf seconds\n",
+				index->nEntries, argv[1], secondsSince(&startTime));
+		fastaIndexClose(index);
+		return 0;
+	}
+
+	if ((index = fastaIndexOpen(argv[1])) == NULL)
+		return 1;
+	fprintf(stderr, "Index of %ld records opened in %lf seconds\n",
+			index->nEntries, secondsSince(&startTime));
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	for (i = 2; i < argc; i++) {
+		ordinal = parseRegion(index, argv[i], &start, &end);
+		if (ordinal < 0 || ordinal >= index->nEntries) {
+			fprintf(stderr, "Error: no record matches '%s'\n", argv[i]);
+			nFailed++;
+			continue;
+		}
+
+		/** a whole record is printed as it appears in the file */
+		if (start == 0 && end < 0) {
+			fastaInitializeRecord(&fRecord);
+			if (fastaIndexFetchRecord(index, ordinal, &fRecord) < 0) {
+				nFailed++;
+				continue;
+			}
+			printf("%s", fRecord.description);
+			printWrapped(fRecord.sequence, index->entries[ordinal].lineBases);
+			fastaClearRecord(&fRecord);
+			continue;
+		}
+
+		sequence = fastaIndexFetchSequence(index, ordinal, start, end);
+		if (sequence == NULL) {
+			fprintf(stderr, "Error: '%s' is outside the record\n", argv[i]);
+			nFailed++;
+			continue;
+		}
+		printf(">%s:%ld-%ld\n", index->entries[ordinal].name, start + 1,
+				start + (long) strlen(sequence));
+		printWrapped(sequence, REGION_LINE_LENGTH);
+		free(sequence);
+	}
+	seconds = secondsSince(&startTime);
+	nFetched = argc - 2 - nFailed;
+	fprintf(stderr, "%d regions fetched in %lf seconds", nFetched, seconds);
+	if (nFetched > 0)
+		fprintf(stderr, " (%.1f microseconds each)", seconds * 1e6 / nFetched);
+	if (nFailed > 0)
+		fprintf(stderr, ", %d failed", nFailed);
+	fprintf(stderr, "\n");
+
+	fastaIndexClose(index);
+	return (nFailed > 0) ? 1 : 0;
+}
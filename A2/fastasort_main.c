@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fasta_store.h"
+#include "fasta_sort.h"
+#include "util.h"
+
+/** the line length used when writing sequences back out */
+#define	OUTPUT_LINE_LENGTH	60
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Loads FASTA records from all files and writes them to standard\n");
+	fprintf(stderr, "output in sorted order.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-k <KEY>     : sort by id (default), length or name.\n");
+	fprintf(stderr, "-r           : write the records in reverse order.\n");
+	fprintf(stderr, "-q           : only sort, and report the time taken.\n");
+	fprintf(stderr, "-t <THREADS> : worker threads (default: one per CPU).\n");
+	fprintf(stderr, "-C           : load each file through its binary cache\n");
+	fprintf(stderr, "               (give it before the files).\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	FASTAstore store;
+	struct timespec startTime;
+	double sortSeconds;
+	long *order, i;
+	int argi, key = FASTA_SORT_ID, reverse = 0, quiet = 0, nFiles = 0;
+	int nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+	fastaStoreInit(&store);
+
+	for (argi = 1; argi < argc; argi++) {
+		if (argv[argi][0] == '-') {
+			if (argv[argi][1] == 'r') {
+				reverse = 1;
+			} else if (argv[argi][1] == 'q') {
+				quiet = 1;
+			} else if (argv[argi][1] == 'C') {
+				fastaStoreEnableCache(&store);
+			} else if (argi + 1 >= argc) {
+				fprintf(stderr, "Error: option '%s' needs an argument\n",
+						argv[argi]);
+				return 1;
+			} else if (argv[argi][1] == 't') {
+				nThreads = atoi(argv[++argi]);
+			} else if (argv[argi][1] == 'k') {
+				key = fastaSortKeyFromName(argv[++argi]);
+				if (key < 0) {
+					fprintf(stderr, "Error: unknown sort key '%s'\n",
+							argv[argi]);
+					return 1;
+				}
+			} else {
+				fprintf(stderr,
+						"Error: unknown option '%s'\n", argv[argi]);
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			if (fastaStoreLoad(&store, argv[argi]) < 0) {
+				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+						argv[argi]);
+				fastaStoreFree(&store);
+				return 1;
+			}
+			nFiles++;
+		}
+	}
+
+	if (nFiles == 0) {
+		fprintf(stderr,
+				"No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	order = fastaSortPermutation(&store, key, nThreads);
+	sortSeconds = secondsSince(&startTime);
+
+	fprintf(stderr, "%ld records sorted in %lf seconds using %d threads\n",
+			store.nRecords, sortSeconds, nThreads);
+
+	if (!quiet) {
+		for (i = 0; i < store.nRecords; i++)
+			fastaWriteRecord(stdout, &store.records[order[reverse
+					? store.nRecords - 1 - i : i]], OUTPUT_LINE_LENGTH);
+	}
+
+	free(order);
+	fastaStoreFree(&store);
+
+	return 0;
+}
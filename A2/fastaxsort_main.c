@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fasta_extsort.h"
+#include "util.h"
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Sorts the FASTA records of all files within a memory budget,\n");
+	fprintf(stderr, "spilling sorted runs to temporary files and merging them.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-k <KEY>     : sort by id (default), length or name.\n");
+	fprintf(stderr, "-m <MB>      : memory budget in megabytes (default %lu).\n",
+			FASTA_EXTSORT_DEFAULT_BUDGET / (1024 * 1024));
+	fprintf(stderr, "-T <DIR>     : directory for the runs (default $TMPDIR or /tmp).\n");
+	fprintf(stderr, "-o <FILE>    : write the sorted records to FILE (default stdout).\n");
+	fprintf(stderr, "-t <THREADS> : worker threads for sorting runs (default: one per CPU).\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	FASTAextSortOptions options;
+	FASTAextSortStats stats;
+	struct timespec startTime;
+	double seconds;
+	char **inputs, *outputName = NULL;
+	FILE *ofp = stdout;
+	int argi, key, nInputs = 0;
+
+	options.key = FASTA_SORT_ID;
+	options.memoryBudget = FASTA_EXTSORT_DEFAULT_BUDGET;
+	options.tempDir = NULL;
+	options.nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+	inputs = (char **) malloc(argc * sizeof(char *));
+	if (inputs == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+
+	for (argi = 1; argi < argc; argi++) {
+		if (argv[argi][0] == '-') {
+			if (argi + 1 >= argc) {
+				fprintf(stderr, "Error: option '%s' needs an argument\n",
+						argv[argi]);
+				return 1;
+			} else if (argv[argi][1] == 't') {
+				options.nThreads = atoi(argv[++argi]);
+			} else if (argv[argi][1] == 'm') {
+				options.memoryBudget = (size_t) atol(argv[++argi])
+						* 1024 * 1024;
+			} else if (argv[argi][1] == 'T') {
+				options.tempDir = argv[++argi];
+			} else if (argv[argi][1] == 'o') {
+				outputName = argv[++argi];
+			} else if (argv[argi][1] == 'k') {
+				key = fastaSortKeyFromName(argv[++argi]);
+				if (key < 0) {
+					fprintf(stderr, "Error: unknown sort key '%s'\n",
+							argv[argi]);
+					return 1;
+				}
+				options.key = key;
+			} else {
+				fprintf(stderr,
+						"Error: unknown option '%s'\n", argv[argi]);
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			inputs[nInputs++] = argv[argi];
+		}
+	}
+
+	if (nInputs == 0) {
+		fprintf(stderr,
+				"No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		free(inputs);
+		return 1;
+	}
+
+	if (outputName != NULL && (ofp = fopen(outputName, "w")) == NULL) {
+		fprintf(stderr, "Error: cannot create '%s' : %s\n",
+				outputName, strerror(errno));
+		free(inputs);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	if (fastaExternalSort(inputs, nInputs, ofp, &options, &stats) < 0
+			|| fflush(ofp) != 0) {
+		fprintf(stderr, "Error: sorting failed -- exitting\n");
+		if (ofp != stdout)
+			fclose(ofp);
+		free(inputs);
+		return 1;
+	}
+	seconds = secondsSince(&startTime);
+
+	fprintf(stderr, "%ld records sorted in %lf seconds: %ld runs,"
+			" %ld merge passes, %.1f MB peak run (budget %.1f MB)\n",
+			stats.nRecords, seconds, stats.nRuns, stats.nMergePasses,
+			stats.peakRunBytes / (1024.0 * 1024.0),
+			options.memoryBudget / (1024.0 * 1024.0));
+
+	if (ofp != stdout)
+		fclose(ofp);
+	free(inputs);
+	return 0;
+}
@@ -0,0 +1,110 @@
+#include <string.h>
+
+#include "hash64.h"
+
+static const uint64_t PRIME1_ = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME2_ = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME3_ = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME4_ = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME5_ = 0x27D4EB2F165667C5ULL;
+
+
+static inline uint64_t
+rotl64_(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+/** unaligned little-endian reads; memcpy compiles to a single load */
+static inline uint64_t
+read64_(const unsigned char *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t
+read32_(const unsigned char *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t
+round_(uint64_t acc, uint64_t input)
+{
+	acc += input * PRIME2_;
+	acc = rotl64_(acc, 31);
+	return acc * PRIME1_;
+}
+
+static inline uint64_t
+mergeRound_(uint64_t acc, uint64_t value)
+{
+	acc ^= round_(0, value);
+	return acc * PRIME1_ + PRIME4_;
+}
+
+
+uint64_t
+hash64(const void *data, size_t len, uint64_t seed)
+{
+	const unsigned char *p = (const unsigned char *) data;
+	const unsigned char *end = p + len;
+	uint64_t h, v1, v2, v3, v4;
+
+	if (len >= 32) {
+		const unsigned char *limit = end - 32;
+
+		v1 = seed + PRIME1_ + PRIME2_;
+		v2 = seed + PRIME2_;
+		v3 = seed;
+		v4 = seed - PRIME1_;
+		do {
+			v1 = round_(v1, read64_(p));
+			v2 = round_(v2, read64_(p + 8));
+			v3 = round_(v3, read64_(p + 16));
+			v4 = round_(v4, read64_(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		h = rotl64_(v1, 1) + rotl64_(v2, 7)
+				+ rotl64_(v3, 12) + rotl64_(v4, 18);
+		h = mergeRound_(h, v1);
+		h = mergeRound_(h, v2);
+		h = mergeRound_(h, v3);
+		h = mergeRound_(h, v4);
+	} else {
+		h = seed + PRIME5_;
+	}
+
+	h += (uint64_t) len;
+
+	/** the tail: whole words, then a half word, then single bytes */
+	for (; p + 8 <= end; p += 8) {
+		h ^= round_(0, read64_(p));
+		h = rotl64_(h, 27) * PRIME1_ + PRIME4_;
+	}
+	if (p + 4 <= end) {
+		h ^= (uint64_t) read32_(p) * PRIME1_;
+		h = rotl64_(h, 23) * PRIME2_ + PRIME3_;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		h ^= (*p) * PRIME5_;
+		h = rotl64_(h, 11) * PRIME1_;
+	}
+
+	/** final avalanche so that every input bit affects every output bit */
+	h ^= h >> 33;
+	h *= PRIME2_;
+	h ^= h >> 29;
+	h *= PRIME3_;
+	h ^= h >> 32;
+
+	return h;
+}
@@ -0,0 +1,21 @@
+
+#ifndef	__HASH64_HEADER__
+#define	__HASH64_HEADER__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A fast 64-bit non-cryptographic hash of a block of bytes.
+ *
+ * This is the XXH64 algorithm: four independent accumulators each
+ * consume 8 bytes per step, so the bulk of a long sequence is hashed
+ * 32 bytes at a time with no per-byte work.  It is good enough to
+ * treat two sequences with different hashes as different; equal
+ * hashes are still confirmed by comparing the bytes.
+ */
+
+/** hash len bytes of data, starting from seed */
+uint64_t hash64(const void *data, size_t len, uint64_t seed);
+
+#endif /* __HASH64_HEADER__ */
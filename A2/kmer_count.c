@@ -0,0 +1,487 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "kmer_count.h"
+
+/** number of records a worker claims at a time */
+#define	KMER_RECORD_BATCH	64
+
+/** initial slots in each worker's table */
+#define	KMER_INITIAL_CAPACITY	(1 << 16)
+
+static const char dnaLetters_[] = "ACGT";
+static const char proteinLetters_[] = "ACDEFGHIKLMNPQRSTVWY";
+
+/** per-character codes for each alphabet; -1 breaks the window */
+static int8_t dnaCode_[256];
+static int8_t proteinCode_[256];
+static pthread_once_t codesOnce_ = PTHREAD_ONCE_INIT;
+
+typedef struct KmerWorker {
+	pthread_t thread;
+	FASTAstore *store;
+	KmerOptions *options;
+	long *nextRecord;
+	KmerTable table;
+	uint64_t nKmers;
+
+	/** used during the merge */
+	KmerTable *partition;
+	int partitionIndex;
+	struct KmerWorker *allWorkers;
+} KmerWorker;
+
+
+static void
+initCodes_(void)
+{
+	int i;
+
+	memset(dnaCode_, -1, sizeof(dnaCode_));
+	memset(proteinCode_, -1, sizeof(proteinCode_));
+	for (i = 0; dnaLetters_[i] != '\0'; i++) {
+		dnaCode_[(unsigned char) dnaLetters_[i]] = i;
+		dnaCode_[(unsigned char) (dnaLetters_[i] - 'A' + 'a')] = i;
+	}
+	dnaCode_['U'] = dnaCode_['u'] = 3; /* RNA */
+	for (i = 0; proteinLetters_[i] != '\0'; i++) {
+		proteinCode_[(unsigned char) proteinLetters_[i]] = i;
+		proteinCode_[(unsigned char) (proteinLetters_[i] - 'A' + 'a')] = i;
+	}
+}
+
+
+/** the splitmix64 finalizer: cheap, and mixes every input bit */
+static inline uint64_t
+mix64_(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+/** partitions are chosen from the top bits; slots from the bottom */
+static inline int
+partitionOf_(uint64_t hash, int nPartitions)
+{
+	return (int) ((hash >> 40) % (uint64_t) nPartitions);
+}
+
+
+static void
+tableInit_(KmerTable *table, uint64_t capacity)
+{
+	table->capacity = capacity;
+	table->nUsed = 0;
+	table->keys = (uint64_t *) calloc(capacity, sizeof(uint64_t));
+	table->counts = (uint32_t *) calloc(capacity, sizeof(uint32_t));
+	if (table->keys == NULL || table->counts == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+}
+
+static void
+tableFree_(KmerTable *table)
+{
+	free(table->keys);
+	free(table->counts);
+	table->keys = NULL;
+	table->counts = NULL;
+	table->capacity = table->nUsed = 0;
+}
+
+static void tableAdd_(KmerTable *table, uint64_t kmer, uint32_t n);
+
+/** double the table, re-inserting everything */
+static void
+tableGrow_(KmerTable *table)
+{
+	KmerTable bigger;
+	uint64_t i;
+
+	tableInit_(&bigger, table->capacity * 2);
+	for (i = 0; i < table->capacity; i++) {
+		if (table->keys[i] != 0)
+			tableAdd_(&bigger, table->keys[i] - 1, table->counts[i]);
+	}
+	tableFree_(table);
+	*table = bigger;
+}
+
+/** add n to the tally of kmer, using linear probing */
+static void
+tableAdd_(KmerTable *table, uint64_t kmer, uint32_t n)
+{
+	uint64_t key = kmer + 1;
+	uint64_t mask = table->capacity - 1;
+	uint64_t slot = mix64_(kmer) & mask;
+
+	for (;;) {
+		if (table->keys[slot] == key) {
+			table->counts[slot] += n;
+			return;
+		}
+		if (table->keys[slot] == 0)
+			break;
+		slot = (slot + 1) & mask;
+	}
+
+	table->keys[slot] = key;
+	table->counts[slot] = n;
+	table->nUsed++;
+
+	/** keep the load factor below 0.7 so probe runs stay short */
+	if (table->nUsed * 10 > table->capacity * 7)
+		tableGrow_(table);
+}
+
+
+/**
+ * Roll a window across sequence, adding every complete k-mer
+ * to table weight times.  Returns the number of k-mers added.
+ */
+static uint64_t
+countSequence_(KmerTable *table, const char *sequence, uint32_t weight,
+		KmerOptions *options)
+{
+	const int8_t *code;
+	int bitsPerSymbol, k = options->k;
+	uint64_t fwd = 0, rev = 0, mask, nAdded = 0;
+	int revShift, windowLen = 0;
+	const unsigned char *p;
+	int c;
+
+	if (options->alphabet == KMER_ALPHABET_DNA) {
+		code = dnaCode_;
+		bitsPerSymbol = 2;
+	} else {
+		code = proteinCode_;
+		bitsPerSymbol = 5;
+	}
+	mask = (bitsPerSymbol * k >= 64)
+			? ~0ULL : ((1ULL << (bitsPerSymbol * k)) - 1);
+	revShift = 2 * (k - 1);
+
+	for (p = (const unsigned char *) sequence; *p != '\0'; p++) {
+		c = code[*p];
+		if (c < 0) {
+			windowLen = 0;
+			fwd = rev = 0;
+			continue;
+		}
+
+		fwd = ((fwd << bitsPerSymbol) | (uint64_t) c) & mask;
+		if (options->canonical)
+			rev = (rev >> 2) | ((uint64_t) (3 - c) << revShift);
+
+		if (++windowLen >= k) {
+			if (options->canonical && rev < fwd)
+				tableAdd_(table, rev, weight);
+			else
+				tableAdd_(table, fwd, weight);
+			nAdded += weight;
+		}
+	}
+
+	return nAdded;
+}
+
+
+/**
+ * Claim batches of records and count them.  When the store has been
+ * deduplicated each distinct body is counted once instead, weighted
+ * by the number of records that share it.
+ */
+static void *
+countWorkerMain_(void *arg)
+{
+	KmerWorker *worker = (KmerWorker *) arg;
+	FASTAdedup *dedup = worker->store->dedup;
+	long start, end, i, nItems;
+
+	nItems = (dedup != NULL) ? dedup->nClusters : worker->store->nRecords;
+
+	for (;;) {
+		start = __atomic_fetch_add(worker->nextRecord, KMER_RECORD_BATCH,
+				__ATOMIC_RELAXED);
+		if (start >= nItems)
+			break;
+		end = start + KMER_RECORD_BATCH;
+		if (end > nItems)
+			end = nItems;
+
+		for (i = start; i < end; i++) {
+			if (dedup != NULL) {
+				worker->nKmers += countSequence_(&worker->table,
+						dedup->clusters[i].sequence,
+						(uint32_t) dedup->clusters[i].nRecords,
+						worker->options);
+			} else {
+				worker->nKmers += countSequence_(&worker->table,
+						worker->store->records[i].sequence, 1,
+						worker->options);
+			}
+		}
+	}
+	return NULL;
+}
+
+
+/** gather this worker's share of the hash space from every table */
+static void *
+mergeWorkerMain_(void *arg)
+{
+	KmerWorker *worker = (KmerWorker *) arg;
+	int nWorkers = worker->options->nThreads;
+	KmerTable *source;
+	uint64_t i;
+	int w;
+
+	tableInit_(worker->partition, KMER_INITIAL_CAPACITY);
+	for (w = 0; w < nWorkers; w++) {
+		source = &worker->allWorkers[w].table;
+		for (i = 0; i < source->capacity; i++) {
+			if (source->keys[i] == 0)
+				continue;
+			if (partitionOf_(mix64_(source->keys[i] - 1), nWorkers)
+					!= worker->partitionIndex)
+				continue;
+			tableAdd_(worker->partition, source->keys[i] - 1,
+					source->counts[i]);
+		}
+	}
+	return NULL;
+}
+
+
+int
+kmerMaxK(int alphabet)
+{
+	return (alphabet == KMER_ALPHABET_DNA)
+			? KMER_MAX_K_DNA : KMER_MAX_K_PROTEIN;
+}
+
+
+int
+kmerCount(FASTAstore *store, KmerOptions *options, KmerCounts *counts)
+{
+	KmerWorker *workers;
+	long nextRecord = 0;
+	int nThreads, t;
+
+	if (options->k < 1 || options->k > kmerMaxK(options->alphabet)) {
+		fprintf(stderr, "Error: k must be between 1 and %d\n",
+				kmerMaxK(options->alphabet));
+		return -1;
+	}
+	if (options->canonical && options->alphabet != KMER_ALPHABET_DNA) {
+		fprintf(stderr, "Error: canonical k-mers only apply to DNA\n");
+		return -1;
+	}
+	if (options->nThreads < 1)
+		options->nThreads = 1;
+	nThreads = options->nThreads;
+
+	pthread_once(&codesOnce_, initCodes_);
+
+	counts->k = options->k;
+	counts->alphabet = options->alphabet;
+	counts->canonical = options->canonical;
+	counts->totalKmers = 0;
+	counts->nPartitions = nThreads;
+	counts->partitions = (KmerTable *) calloc(nThreads, sizeof(KmerTable));
+
+	workers = (KmerWorker *) calloc(nThreads, sizeof(KmerWorker));
+	for (t = 0; t < nThreads; t++) {
+		workers[t].store = store;
+		workers[t].options = options;
+		workers[t].nextRecord = &nextRecord;
+		workers[t].partition = &counts->partitions[t];
+		workers[t].partitionIndex = t;
+		workers[t].allWorkers = workers;
+		tableInit_(&workers[t].table, KMER_INITIAL_CAPACITY);
+	}
+
+	/** with a single thread there is nothing to merge */
+	if (nThreads == 1) {
+		countWorkerMain_(&workers[0]);
+		counts->totalKmers = workers[0].nKmers;
+		counts->partitions[0] = workers[0].table;
+		free(workers);
+		return 0;
+	}
+
+	for (t = 0; t < nThreads; t++)
+		pthread_create(&workers[t].thread, NULL, countWorkerMain_, &workers[t]);
+	for (t = 0; t < nThreads; t++) {
+		pthread_join(workers[t].thread, NULL);
+		counts->totalKmers += workers[t].nKmers;
+	}
+
+	for (t = 0; t < nThreads; t++)
+		pthread_create(&workers[t].thread, NULL, mergeWorkerMain_, &workers[t]);
+	for (t = 0; t < nThreads; t++)
+		pthread_join(workers[t].thread, NULL);
+
+	for (t = 0; t < nThreads; t++)
+		tableFree_(&workers[t].table);
+	free(workers);
+
+	return 0;
+}
+
+
+uint64_t
+kmerDistinct(KmerCounts *counts)
+{
+	uint64_t total = 0;
+	int p;
+
+	for (p = 0; p < counts->nPartitions; p++)
+		total += counts->partitions[p].nUsed;
+	return total;
+}
+
+uint64_t
+kmerSingletons(KmerCounts *counts)
+{
+	uint64_t i, total = 0;
+	KmerTable *table;
+	int p;
+
+	for (p = 0; p < counts->nPartitions; p++) {
+		table = &counts->partitions[p];
+		for (i = 0; i < table->capacity; i++) {
+			if (table->keys[i] != 0 && table->counts[i] == 1)
+				total++;
+		}
+	}
+	return total;
+}
+
+
+/**
+ * whether entry a ranks below entry b: less frequent, or with equal
+ * tallies the larger k-mer, so the top K do not depend on table layout
+ */
+static inline int
+ranksBelow_(uint64_t kmerA, uint32_t tallyA, uint64_t kmerB, uint32_t tallyB)
+{
+	return (tallyA < tallyB) || (tallyA == tallyB && kmerA > kmerB);
+}
+
+
+/** sift entry i down a min-heap of n entries, lowest ranked at the top */
+static void
+heapSiftDown_(uint64_t *kmers, uint32_t *tallies, int n, int i)
+{
+	int smallest, left, right;
+	uint64_t tk;
+	uint32_t tt;
+
+	for (;;) {
+		smallest = i;
+		left = 2 * i + 1;
+		right = left + 1;
+		if (left < n && ranksBelow_(kmers[left], tallies[left],
+				kmers[smallest], tallies[smallest]))
+			smallest = left;
+		if (right < n && ranksBelow_(kmers[right], tallies[right],
+				kmers[smallest], tallies[smallest]))
+			smallest = right;
+		if (smallest == i)
+			return;
+		tk = kmers[i]; kmers[i] = kmers[smallest]; kmers[smallest] = tk;
+		tt = tallies[i]; tallies[i] = tallies[smallest]; tallies[smallest] = tt;
+		i = smallest;
+	}
+}
+
+int
+kmerTopK(KmerCounts *counts, int K, uint64_t *kmers, uint32_t *tallies)
+{
+	KmerTable *table;
+	uint64_t i, tk;
+	uint32_t tt;
+	int p, n = 0, j;
+
+	if (K <= 0)
+		return 0;
+
+	/** keep the K largest seen so far in a min-heap */
+	for (p = 0; p < counts->nPartitions; p++) {
+		table = &counts->partitions[p];
+		for (i = 0; i < table->capacity; i++) {
+			if (table->keys[i] == 0)
+				continue;
+			if (n < K) {
+				kmers[n] = table->keys[i] - 1;
+				tallies[n] = table->counts[i];
+				if (++n == K) {
+					for (j = K / 2 - 1; j >= 0; j--)
+						heapSiftDown_(kmers, tallies, K, j);
+				}
+			} else if (ranksBelow_(kmers[0], tallies[0],
+					table->keys[i] - 1, table->counts[i])) {
+				kmers[0] = table->keys[i] - 1;
+				tallies[0] = table->counts[i];
+				heapSiftDown_(kmers, tallies, K, 0);
+			}
+		}
+	}
+
+	if (n < K) {
+		for (j = n / 2 - 1; j >= 0; j--)
+			heapSiftDown_(kmers, tallies, n, j);
+	}
+
+	/** heap sort into descending order of tally, then ascending k-mer */
+	for (j = n - 1; j > 0; j--) {
+		tk = kmers[0]; kmers[0] = kmers[j]; kmers[j] = tk;
+		tt = tallies[0]; tallies[0] = tallies[j]; tallies[j] = tt;
+		heapSiftDown_(kmers, tallies, j, 0);
+	}
+
+	return n;
+}
+
+
+void
+kmerDecode(KmerCounts *counts, uint64_t kmer, char *buf)
+{
+	int bitsPerSymbol, i;
+	const char *letters;
+
+	if (counts->alphabet == KMER_ALPHABET_DNA) {
+		letters = dnaLetters_;
+		bitsPerSymbol = 2;
+	} else {
+		letters = proteinLetters_;
+		bitsPerSymbol = 5;
+	}
+
+	for (i = counts->k - 1; i >= 0; i--) {
+		buf[i] = letters[kmer & ((1 << bitsPerSymbol) - 1)];
+		kmer >>= bitsPerSymbol;
+	}
+	buf[counts->k] = '\0';
+}
+
+
+void
+kmerCountsFree(KmerCounts *counts)
+{
+	int p;
+
+	for (p = 0; p < counts->nPartitions; p++)
+		tableFree_(&counts->partitions[p]);
+	free(counts->partitions);
+	counts->partitions = NULL;
+	counts->nPartitions = 0;
+}
@@ -0,0 +1,85 @@
+
+#ifndef	__KMER_COUNT_HEADER__
+#define	__KMER_COUNT_HEADER__
+
+#include <stdint.h>
+
+#include "fasta_store.h"
+
+/**
+ * Parallel k-mer counting over the sequences of a FASTAstore.
+ *
+ * Each k-mer is packed into a 64-bit integer (2 bits per base for
+ * DNA, 5 bits per residue for protein) by a rolling window that
+ * advances one character at a time, restarting whenever a character
+ * outside the alphabet is seen.  Worker threads count into their own
+ * open-addressed hash tables, and a merge step then combines these
+ * into one table per partition of the hash space, each partition
+ * being built by its own thread.
+ *
+ * For DNA the canonical k-mer (the lesser of the k-mer and its
+ * reverse complement) may be counted instead, so that both strands
+ * are tallied together.
+ */
+
+#define	KMER_ALPHABET_DNA		0
+#define	KMER_ALPHABET_PROTEIN	1
+
+/** the longest k that fits into 64 bits for each alphabet */
+#define	KMER_MAX_K_DNA			31
+#define	KMER_MAX_K_PROTEIN		12
+
+typedef struct KmerTable {
+	uint64_t *keys;		/* k-mer + 1, so that 0 marks an empty slot */
+	uint32_t *counts;
+	uint64_t capacity;	/* always a power of two */
+	uint64_t nUsed;
+} KmerTable;
+
+typedef struct KmerOptions {
+	int k;
+	int alphabet;
+	int canonical;
+	int nThreads;
+} KmerOptions;
+
+typedef struct KmerCounts {
+	KmerTable *partitions;
+	int nPartitions;
+	int k;
+	int alphabet;
+	int canonical;
+	uint64_t totalKmers;
+} KmerCounts;
+
+/** the longest k allowed for alphabet */
+int kmerMaxK(int alphabet);
+
+/**
+ * Count the k-mers of every sequence in store.
+ *
+ * Returns 0 on success or -1 if the options are invalid
+ */
+int kmerCount(FASTAstore *store, KmerOptions *options, KmerCounts *counts);
+
+/** the number of distinct k-mers seen */
+uint64_t kmerDistinct(KmerCounts *counts);
+
+/** the number of k-mers seen exactly once */
+uint64_t kmerSingletons(KmerCounts *counts);
+
+/**
+ * Find the K most frequent k-mers, most frequent first; k-mers with
+ * equal tallies are taken, and listed, in ascending order of k-mer.
+ *
+ * Returns the number of entries filled in (at most K)
+ */
+int kmerTopK(KmerCounts *counts, int K, uint64_t *kmers, uint32_t *tallies);
+
+/** write the text of kmer into buf, which must hold k + 1 chars */
+void kmerDecode(KmerCounts *counts, uint64_t kmer, char *buf);
+
+/** release the tables */
+void kmerCountsFree(KmerCounts *counts);
+
+#endif /* __KMER_COUNT_HEADER__ */
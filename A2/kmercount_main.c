@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fasta_store.h"
+#include "kmer_count.h"
+#include "util.h"
+
+
+/** print the tally summary in the style of the hapax tool */
+void printKmerReport(KmerCounts *counts, int nTop)
+{
+	uint64_t *topKmers;
+	uint32_t *topTallies;
+	char *kmerText;
+	int i, nFound;
+
+	printf("%lu distinct %d-mers, %lu singletons (hapax %d-mers)\n",
+			(unsigned long) kmerDistinct(counts), counts->k,
+			(unsigned long) kmerSingletons(counts), counts->k);
+
+	if (nTop <= 0)
+		return;
+
+	topKmers = (uint64_t *) malloc(nTop * sizeof(uint64_t));
+	topTallies = (uint32_t *) malloc(nTop * sizeof(uint32_t));
+	kmerText = (char *) malloc(counts->k + 1);
+
+	nFound = kmerTopK(counts, nTop, topKmers, topTallies);
+	printf("Most frequent %d-mers:\n", counts->k);
+	for (i = 0; i < nFound; i++) {
+		kmerDecode(counts, topKmers[i], kmerText);
+		printf("    %s %u\n", kmerText, topTallies[i]);
+	}
+
+	free(topKmers);
+	free(topTallies);
+	free(kmerText);
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Loads FASTA records from all files and counts their k-mers.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-k <K>       : k-mer length (default 5).\n");
+	fprintf(stderr, "-a <ALPHA>   : sequence alphabet: protein (default) or dna.\n");
+	fprintf(stderr, "-c           : count canonical k-mers (DNA only).\n");
+	fprintf(stderr, "-t <THREADS> : worker threads (default: one per CPU).\n");
+	fprintf(stderr, "-n <N>       : print the N most frequent k-mers (default 10).\n");
+	fprintf(stderr, "-u           : store and count each distinct sequence once.\n");
+	fprintf(stderr, "-C           : load each file through its binary cache,\n");
+	fprintf(stderr, "               writing the cache if needed (give it before the files).\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	FASTAstore store;
+	KmerOptions options;
+	KmerCounts counts;
+	struct timespec startTime;
+	double loadSeconds, countSeconds;
+	int i, nTop = 10, nFiles = 0;
+	long status;
+
+	options.k = 5;
+	options.alphabet = KMER_ALPHABET_PROTEIN;
+	options.canonical = 0;
+	options.nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+	fastaStoreInit(&store);
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			if (argv[i][1] == 'c') {
+				options.canonical = 1;
+			} else if (argv[i][1] == 'u') {
+				fastaStoreEnableDedup(&store);
+			} else if (argv[i][1] == 'C') {
+				fastaStoreEnableCache(&store);
+			} else if (i + 1 >= argc) {
+				fprintf(stderr, "Error: option '%s' needs an argument\n",
+						argv[i]);
+				return 1;
+			} else if (argv[i][1] == 'k') {
+				options.k = atoi(argv[++i]);
+			} else if (argv[i][1] == 't') {
+				options.nThreads = atoi(argv[++i]);
+			} else if (argv[i][1] == 'n') {
+				nTop = atoi(argv[++i]);
+			} else if (argv[i][1] == 'a') {
+				i++;
+				if (strcmp(argv[i], "dna") == 0) {
+					options.alphabet = KMER_ALPHABET_DNA;
+				} else if (strcmp(argv[i], "protein") == 0) {
+					options.alphabet = KMER_ALPHABET_PROTEIN;
+				} else {
+					fprintf(stderr, "Error: unknown alphabet '%s'\n", argv[i]);
+					return 1;
+				}
+			} else {
+				fprintf(stderr,
+						"Error: unknown option '%s'\n", argv[i]);
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			status = fastaStoreLoad(&store, argv[i]);
+			if (status < 0) {
+				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+						argv[i]);
+				fastaStoreFree(&store);
+				return 1;
+			}
+			nFiles++;
+		}
+	}
+
+	if (nFiles == 0) {
+		fprintf(stderr,
+				"No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+
+	loadSeconds = secondsSince(&startTime);
+	printf("%ld FASTA records (%ld residues) loaded from %d files"
+			" in %lf seconds\n", store.nRecords, fastaStoreResidues(&store),
+			nFiles, loadSeconds);
+	if (store.dedup != NULL)
+		printf("%ld distinct sequences (%ld duplicate records)\n",
+				store.dedup->nClusters, store.dedup->nDuplicates);
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	if (kmerCount(&store, &options, &counts) < 0) {
+		fastaStoreFree(&store);
+		return 1;
+	}
+	countSeconds = secondsSince(&startTime);
+
+	printf("%lu %d-mers (%s%s) counted in %lf seconds using %d threads"
+			" : %.2f million k-mers/sec\n",
+			(unsigned long) counts.totalKmers, counts.k,
+			(options.alphabet == KMER_ALPHABET_DNA) ? "dna" : "protein",
+			options.canonical ? ", canonical" : "",
+			countSeconds, options.nThreads,
+			(countSeconds > 0) ? counts.totalKmers / countSeconds / 1e6 : 0.0);
+
+	printKmerReport(&counts, nTop);
+
+	kmerCountsFree(&counts);
+	fastaStoreFree(&store);
+
+	return 0;
+}
@@ -5,6 +5,10 @@
 #include <errno.h>
 
 #include "fasta.h"
+#include "compressed_input.h"
+#include "benchmark.h"
+#include "fasta_profile.h"
+#include "arena.h"
 #include "LLvNode.h"
 
 // FASTArecord * LLNewNode(char *key, void *value) {
@@ -58,16 +62,18 @@ void deleteFastaRecord(LLvNode *head, void* data){  // funtion to call fastaDeal
 	free(fRecord2);
 }
 
-int processFasta(char *filename, double *timeTaken) 
+int processFasta(char *filename, BMOptions *options, BMSample *sample)
 {
 	FILE *fp;
 	                      // data is read in but not stored
 	FASTArecord *fRecord;
 	int lineNumber = 0, recordNumber = 0, status;
 	int eofSeen = 0;
-	clock_t startTime, endTime;
+	BMTimer timer, freeTimer;
+	FPTimer phaseTimer;
+	Arena *arena = NULL;
 
-	fp = fopen(filename, "r");
+	fp = ciOpen(filename);
 	if (fp == NULL) {
 		fprintf(stderr, "Failure opening %s : %s\n",
 				filename, strerror(errno));
@@ -76,6 +82,11 @@ int processFasta(char *filename, double *timeTaken)
 
 	LLvNode *head = NULL;   // declare head of the list using LLvNode data structure
 
+	// with -A, nodes, records and their strings all come from one
+	// arena, so the whole list is released in one go
+	if (options->useArena)
+		arena = arenaCreate(0);
+
 
 	//FASTArecord *head = malloc(sizeof(FASTArecord));   
 	
@@ -88,7 +99,7 @@ int processFasta(char *filename, double *timeTaken)
 
 
 	/** record the time now, before we do the work */
-	startTime = clock();
+	bmTimerStart(&timer);
 
 	do {
 		/** print a '.' every 10,000 records so
@@ -99,9 +110,12 @@ int processFasta(char *filename, double *timeTaken)
 		}
 
 		// fastaInitializeRecord(&fRecord);
-		fRecord = fastaAllocateRecord();      // call funciton to allocate and initialize a new FASTA record to NULL for each fRecord loaded in
+		if (arena != NULL)
+			fRecord = fastaAllocateRecordInArena(arena);
+		else
+			fRecord = fastaAllocateRecord();      // call funciton to allocate and initialize a new FASTA record to NULL for each fRecord loaded in
 
-		status = fastaReadRecord(fp, fRecord);
+		status = fastaReadRecordInArena(fp, fRecord, arena);
 		if (status == 0) {
 			eofSeen = 1;
 
@@ -112,9 +126,15 @@ int processFasta(char *filename, double *timeTaken)
 
 		//FASTArecord *newNode = LLNewNode(strdup(fRecord.description), NULL); // old funciton call N/A
 
-		LLvNode *newNode = llNewNode(strdup(fRecord->description), fRecord); // Create new node using llNewNode function and use void* to pass in FASTArecord as value
+		fpStart(&phaseTimer);
+		LLvNode *newNode; // Create new node and use void* to pass in FASTArecord as value
+		if (arena != NULL)
+			newNode = llNewNodeInArena(arena, arenaStrdup(arena, fRecord->description), fRecord);
+		else
+			newNode = llNewNode(strdup(fRecord->description), fRecord);
 
 		head = llAppend(head, newNode); // Append the new node to the end of the list
+		fpStop(&phaseTimer, FP_CONTAINER, sizeof(LLvNode));
 
 			///fastaPrintRecord(stdout, &fRecord);
 			//fastaClearRecord(fRecord);
@@ -125,55 +145,40 @@ int processFasta(char *filename, double *timeTaken)
 			fprintf(stderr, "status = %d\n", status);
 			fprintf(stderr, "Error: failure at line %d of '%s'\n",
 					lineNumber, filename);
+			if (arena != NULL) {
+				arenaDestroy(arena);
+			} else {
+				free(fRecord);
+				llFree(head, deleteFastaRecord, NULL);
+			}
 			return -1;
 		}
 
 	} while ( ! eofSeen);
 	printf(" %d FASTA records\n", recordNumber);
 
-	/** record the time now, when the work is done,
-	 *  and calculate the difference*/
-	endTime = clock();
-
-	(*timeTaken) = ((double) (endTime - startTime)) / CLOCKS_PER_SEC;
+	/** record the time now, when the work is done */
+	bmTimerStop(&timer, sample);
 
 
 	fclose(fp);
-	
-	free(fRecord); // Free memory allocated for fRecord after file pointer is closed
 
-	llFree(head, deleteFastaRecord, NULL); // Free memory allocated in linked list
+	if (arena == NULL)
+		free(fRecord); // Free memory allocated for fRecord after file pointer is closed
+
+	bmTimerStart(&freeTimer);
+	fpStart(&phaseTimer);
+	if (arena != NULL)
+		arenaDestroy(arena); // Free every node, record and string in the list at once
+	else
+		llFree(head, deleteFastaRecord, NULL); // Free memory allocated in linked list
+	fpStop(&phaseTimer, FP_TEARDOWN, recordNumber * sizeof(LLvNode));
+	sample->freeSeconds = bmTimerElapsed(&freeTimer);
 
 	return recordNumber;
 }
 
 
-int processFastaRepeatedly(char *filename, long repeatsRequested) // figure out how to reference head in main
-{
-	double timeThisIterationInSeconds;
-	double totalTimeInSeconds = 0;
-	int minutesPortion;
-	int status;
-	long i;
-
-	for (i = 0; i < repeatsRequested; i++) {
-		status = processFasta(filename, &timeThisIterationInSeconds);  // figure out how to reference head in main
-		if (status < 0)	return -1;
-		totalTimeInSeconds += timeThisIterationInSeconds;
-	}
-
-	printf("%lf seconds taken for processing total\n", totalTimeInSeconds);
-
-	totalTimeInSeconds /= (double) repeatsRequested;
-
-	minutesPortion = (int) (totalTimeInSeconds / 60);
-	totalTimeInSeconds = totalTimeInSeconds - (60 * minutesPortion);
-	printf("On average: %d minutes, %lf second per run\n",
-            minutesPortion, totalTimeInSeconds);
-
-	return status;
-}
-
 void usage(char *progname)
 {
 	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
@@ -181,8 +186,7 @@ void usage(char *progname)
 	fprintf(stderr, "Prints timing of loading and storing FASTA records.\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Options: \n");
-	fprintf(stderr, "-R <REPEATS> : Number of times to repeat load.\n");
-	fprintf(stderr, "             : Time reported will be average time.\n");
+	bmUsage(stderr);
 	fprintf(stderr, "\n");
 }
 
@@ -191,30 +195,24 @@ void usage(char *progname)
  */
 int main(int argc, char **argv)
 {
-	int i, recordsProcessed = 0;
-	long repeatsRequested = 1;
+	BMOptions options;
+	int i, status, recordsProcessed = 0;
+
+	bmInitOptions(&options, argv[0]);
 
 	for (i = 1; i < argc; i++) {
 		if (argv[i][0] == '-') {
-			if (argv[i][1] == 'R') {
-				if (i >= argc) {
-					fprintf(stderr,
-							"Error: need argument for repeats requested\n");
-					return 1;
-				}
-				if (sscanf(argv[++i], "%ld", &repeatsRequested) != 1) {
-					fprintf(stderr,
-							"Error: cannot parse repeats requested from '%s'\n",
-							argv[i]);
-					return 1;
-				}
-			} else {
+			status = bmParseOption(&options, argc, argv, &i);
+			if (status < 0) {
+				return 1;
+			} else if (status == 0) {
 				fprintf(stderr,
 						"Error: unknown option '%s'\n", argv[i]);
 				usage(argv[0]);
 			}
 		} else {
-			recordsProcessed = processFastaRepeatedly(argv[i], repeatsRequested);
+			recordsProcessed = bmProcessRepeatedly(argv[i], &options,
+					processFasta);
 			if (recordsProcessed < 0) {
 				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
 						argv[i]);
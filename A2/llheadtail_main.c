@@ -5,6 +5,10 @@
 #include <errno.h>
 
 #include "fasta.h"
+#include "compressed_input.h"
+#include "benchmark.h"
+#include "fasta_profile.h"
+#include "arena.h"
 #include "LLvNode.h"
 
 // void deleteFastaRecord(LLvNode *head, LLvNode *tail, void* data);
@@ -14,15 +18,34 @@
 // 	fastaDeallocateRecord(fRecord1);
 // }
 
-int processFasta(char *filename, double *timeTaken)
+/** release a list of malloc()ed nodes and the records they hold */
+static void
+freeRecordList(LLvNode *head)
+{
+	LLvNode *next;  // used functionality of llFree to free memory allocated in linked list
+
+	for ( ; head != NULL; head = next) {
+
+		/** hang on to the next pointer */
+		next = head->next;
+
+		/** free the record and the list node itself */
+		fastaDeallocateRecord((FASTArecord *) head->value);
+		free(head);
+	}
+}
+
+int processFasta(char *filename, BMOptions *options, BMSample *sample)
 {
 	FILE *fp;
-	FASTArecord fRecord;
+	FASTArecord *fRecord;
 	int lineNumber = 0, recordNumber = 0, status;
 	int eofSeen = 0;
-	clock_t startTime, endTime;
+	BMTimer timer, freeTimer;
+	FPTimer phaseTimer;
+	Arena *arena = NULL;
 
-	fp = fopen(filename, "r");
+	fp = ciOpen(filename);
 	if (fp == NULL) {
 		fprintf(stderr, "Failure opening %s : %s\n",
 				filename, strerror(errno));
@@ -32,8 +55,13 @@ int processFasta(char *filename, double *timeTaken)
 	LLvNode *head = NULL;   // declare head of the list
 	LLvNode *tail = NULL;   // declare tail of the list
 
+	// with -A, nodes, records and their strings all come from one
+	// arena, so the whole list is released in one go
+	if (options->useArena)
+		arena = arenaCreate(0);
+
 	/** record the time now, before we do the work */
-	startTime = clock();
+	bmTimerStart(&timer);
 
 	do {
 		/** print a '.' every 10,000 records so
@@ -43,9 +71,12 @@ int processFasta(char *filename, double *timeTaken)
 			fflush(stdout);
 		}
 
-		fastaInitializeRecord(&fRecord); // initialize fRecord
+		if (arena != NULL) // each record gets its own storage
+			fRecord = fastaAllocateRecordInArena(arena);
+		else
+			fRecord = fastaAllocateRecord();
 
-		status = fastaReadRecord(fp, &fRecord);
+		status = fastaReadRecordInArena(fp, fRecord, arena);
 		if (status == 0) {
 			eofSeen = 1;
 
@@ -53,7 +84,10 @@ int processFasta(char *filename, double *timeTaken)
 			lineNumber += status;
 			recordNumber++;
 
-			LLvNode *newNode = llNewNode(NULL, &fRecord); // create new node for each record
+			fpStart(&phaseTimer);
+			LLvNode *newNode = (arena != NULL) // create new node for each record
+					? llNewNodeInArena(arena, NULL, fRecord)
+					: llNewNode(NULL, fRecord);
 
 			if (head == NULL) {  // if head is null, then the list is empty
 				head = newNode;  // declare head and tail to same memory address 
@@ -62,82 +96,49 @@ int processFasta(char *filename, double *timeTaken)
 				tail->next = newNode; // if head isn't null, then the list is not empty
 				tail = tail->next;   // point tail's next to new node then redeclare tail to keep a reference point of most recent node
 			}                        // this way we have a reference point to the most recent node when we want to add a new node or add data rather them chasing through the entire linked list.
+			fpStop(&phaseTimer, FP_CONTAINER, sizeof(LLvNode));
 
-			//fastaDeallocateRecord(&fRecord); // deallocate memory for fRecord
-
-			//fastaPrintRecord(stdout, &fRecord);
-			//fRecord.description = NULL;
-			fastaClearRecord(&fRecord); // clear FASTA record
+			//fastaPrintRecord(stdout, fRecord);
 
 		} else {
 			fprintf(stderr, "status = %d\n", status);
 			fprintf(stderr, "Error: failure at line %d of '%s'\n",
 					lineNumber, filename);
+			if (arena != NULL) {
+				arenaDestroy(arena);
+			} else {
+				free(fRecord);
+				freeRecordList(head);
+			}
 			return -1;
 		}
 
 	} while ( ! eofSeen);
 	printf(" %d FASTA records\n", recordNumber);
 
-	/** record the time now, when the work is done,
-	 *  and calculate the difference*/
-	endTime = clock();
-
-	(*timeTaken) = ((double) (endTime - startTime)) / CLOCKS_PER_SEC;
+	/** record the time now, when the work is done */
+	bmTimerStop(&timer, sample);
 
 
 	fclose(fp);
 
-	//free(&fRecord); // Free memory allocated for fRecord after file pointer is closed
+	if (arena == NULL)
+		free(fRecord); // the record allocated for the read that found EOF
 
-	LLvNode *next;  // used functionality of llFree to free memory allocated in linked list
-
-	for ( ; head != NULL; head = next) {
-
-		/** hang on to the next pointer */
-		next = head->next;
-		
-		/** free the list node itself */
-		free(head);
-	}
-
-	//llFree(head, deleteRecord, NULL); // Free memory allocated in linked list
-	//llFree(tail, deleteRecord, NULL); // Free memory allocated in linked list
+	bmTimerStart(&freeTimer);
+	fpStart(&phaseTimer);
+	if (arena != NULL)
+		arenaDestroy(arena); // Free every node, record and string in the list at once
+	else
+		freeRecordList(head);
+	fpStop(&phaseTimer, FP_TEARDOWN, recordNumber * sizeof(LLvNode));
+	sample->freeSeconds = bmTimerElapsed(&freeTimer);
 
 
 	return recordNumber;
 }
 
 
-int processFastaRepeatedly(
-		char *filename,
-		long repeatsRequested
-	)
-{
-	double timeThisIterationInSeconds;
-	double totalTimeInSeconds = 0;
-	int minutesPortion;
-	int status;
-	long i;
-
-	for (i = 0; i < repeatsRequested; i++) {
-		status = processFasta(filename, &timeThisIterationInSeconds);
-		if (status < 0)	return -1;
-		totalTimeInSeconds += timeThisIterationInSeconds;
-	}
-
-	printf("%lf seconds taken for processing total\n", totalTimeInSeconds);
-
-	totalTimeInSeconds /= (double) repeatsRequested;
-
-	minutesPortion = (int) (totalTimeInSeconds / 60);
-	totalTimeInSeconds = totalTimeInSeconds - (60 * minutesPortion);
-	printf("On average: %d minutes, %lf second per run\n",
-            minutesPortion, totalTimeInSeconds);
-
-	return status;
-}
-
 void usage(char *progname)
 {
 	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
@@ -145,8 +146,7 @@ void usage(char *progname)
 	fprintf(stderr, "Prints timing of loading and storing FASTA records.\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Options: \n");
-	fprintf(stderr, "-R <REPEATS> : Number of times to repeat load.\n");
-	fprintf(stderr, "             : Time reported will be average time.\n");
+	bmUsage(stderr);
 	fprintf(stderr, "\n");
 }
 
@@ -155,31 +155,24 @@ void usage(char *progname)
  */
 int main(int argc, char **argv)
 {
-	int i, recordsProcessed = 0;
-	long repeatsRequested = 1;
+	BMOptions options;
+	int i, status, recordsProcessed = 0;
+
+	bmInitOptions(&options, argv[0]);
 
 	for (i = 1; i < argc; i++) {
 		if (argv[i][0] == '-') {
-			if (argv[i][1] == 'R') {
-				if (i >= argc) {
-					fprintf(stderr,
-							"Error: need argument for repeats requested\n");
-					return 1;
-				}
-				if (sscanf(argv[++i], "%ld", &repeatsRequested) != 1) {
-					fprintf(stderr,
-							"Error: cannot parse repeats requested from '%s'\n",
-							argv[i]);
-					return 1;
-				}
-			} else {
+			status = bmParseOption(&options, argc, argv, &i);
+			if (status < 0) {
+				return 1;
+			} else if (status == 0) {
 				fprintf(stderr,
 						"Error: unknown option '%s'\n", argv[i]);
 				usage(argv[0]);
 			}
 		} else {
-			recordsProcessed = processFastaRepeatedly(argv[i],
-					repeatsRequested);
+			recordsProcessed = bmProcessRepeatedly(argv[i], &options,
+					processFasta);
 			if (recordsProcessed < 0) {
 				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
 						argv[i]);
@@ -5,16 +5,20 @@
 #include <errno.h>
 
 #include "fasta.h"
+#include "compressed_input.h"
+#include "benchmark.h"
+#include "fasta_profile.h"
 
-int processFasta(char *filename, double *timeTaken)
+int processFasta(char *filename, BMOptions *options, BMSample *sample)
 {
 	FILE *fp;
 	FASTArecord fRecord;
 	int lineNumber = 0, recordNumber = 0, status;
 	int eofSeen = 0;
-	clock_t startTime, endTime;
+	BMTimer timer;
+	FPTimer phaseTimer;
 
-	fp = fopen(filename, "r");
+	fp = ciOpen(filename);
 	if (fp == NULL) {
 		fprintf(stderr, "Failure opening %s : %s\n",
 				filename, strerror(errno));
@@ -22,7 +26,7 @@ int processFasta(char *filename, double *timeTaken)
 	}
 
 	/** record the time now, before we do the work */
-	startTime = clock();
+	bmTimerStart(&timer);
 
 	do {
 		/** print a '.' every 10,000 records so
@@ -42,7 +46,9 @@ int processFasta(char *filename, double *timeTaken)
 			lineNumber += status;
 			recordNumber++;
 			//fastaPrintRecord(stdout, &fRecord);
+			fpStart(&phaseTimer);
 			fastaClearRecord(&fRecord);
+			fpStop(&phaseTimer, FP_TEARDOWN, 0);
 		} else {
 			fprintf(stderr, "status = %d\n", status);
 			fprintf(stderr, "Error: failure at line %d of '%s'\n",
@@ -53,11 +59,8 @@ int processFasta(char *filename, double *timeTaken)
 	} while ( ! eofSeen);
 	printf(" %d FASTA records\n", recordNumber);
 
-	/** record the time now, when the work is done,
-	 *  and calculate the difference*/
-	endTime = clock();
-
-	(*timeTaken) = ((double) (endTime - startTime)) / CLOCKS_PER_SEC;
+	/** record the time now, when the work is done */
+	bmTimerStop(&timer, sample);
 
 
 	fclose(fp);
@@ -66,35 +69,6 @@ int processFasta(char *filename, double *timeTaken)
 }
 
 
-int processFastaRepeatedly(
-		char *filename,
-		long repeatsRequested
-	)
-{
-	double timeThisIterationInSeconds;
-	double totalTimeInSeconds = 0;
-	int minutesPortion;
-	int status;
-	long i;
-
-	for (i = 0; i < repeatsRequested; i++) {
-		status = processFasta(filename, &timeThisIterationInSeconds);
-		if (status < 0)	return -1;
-		totalTimeInSeconds += timeThisIterationInSeconds;
-	}
-
-	printf("%lf seconds taken for processing total\n", totalTimeInSeconds);
-
-	totalTimeInSeconds /= (double) repeatsRequested;
-
-	minutesPortion = (int) (totalTimeInSeconds / 60);
-	totalTimeInSeconds = totalTimeInSeconds - (60 * minutesPortion);
-	printf("On average: %d minutes, %lf second per run\n",
-            minutesPortion, totalTimeInSeconds);
-
-	return status;
-}
-
 void usage(char *progname)
 {
 	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
@@ -102,8 +76,7 @@ void usage(char *progname)
 	fprintf(stderr, "Prints timing of loading and storing FASTA records.\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Options: \n");
-	fprintf(stderr, "-R <REPEATS> : Number of times to repeat load.\n");
-	fprintf(stderr, "             : Time reported will be average time.\n");
+	bmUsage(stderr);
 	fprintf(stderr, "\n");
 }
 
@@ -112,31 +85,28 @@ void usage(char *progname)
  */
 int main(int argc, char **argv)
 {
-	int i, recordsProcessed = 0;
-	long repeatsRequested = 1;
+	BMOptions options;
+	int i, status, recordsProcessed = 0;
+
+	bmInitOptions(&options, argv[0]);
 
 	for (i = 1; i < argc; i++) {
 		if (argv[i][0] == '-') {
-			if (argv[i][1] == 'R') {
-				if (i >= argc) {
-					fprintf(stderr,
-							"Error: need argument for repeats requested\n");
-					return 1;
-				}
-				if (sscanf(argv[++i], "%ld", &repeatsRequested) != 1) {
-					fprintf(stderr,
-							"Error: cannot parse repeats requested from '%s'\n",
-							argv[i]);
-					return 1;
-				}
-			} else {
+			status = bmParseOption(&options, argc, argv, &i);
+			if (status < 0) {
+				return 1;
+			} else if (options.useArena) {
+				fprintf(stderr, "Error: -A has no effect here, as no"
+						" records are kept\n");
+				return 1;
+			} else if (status == 0) {
 				fprintf(stderr,
 						"Error: unknown option '%s'\n", argv[i]);
 				usage(argv[0]);
 			}
 		} else {
-			recordsProcessed = processFastaRepeatedly(argv[i],
-					repeatsRequested);
+			recordsProcessed = bmProcessRepeatedly(argv[i], &options,
+					processFasta);
 			if (recordsProcessed < 0) {
 				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
 						argv[i]);
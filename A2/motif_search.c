@@ -0,0 +1,536 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "motif_search.h"
+#include "util.h"
+
+/** number of records a worker claims at a time */
+#define	MOTIF_RECORD_BATCH	64
+
+#define	MOTIF_OTHER_SYMBOL	(MOTIF_SYMBOLS - 1)
+
+/** the letters 'x' and {...} range over */
+static const char standardResidues_[] = "ACDEFGHIKLMNPQRSTVWY";
+
+/** one position of a pattern, as a set of letters (bit 0 is 'A') */
+typedef struct MotifElement {
+	uint32_t letters;
+	int minRepeat;
+	int maxRepeat;
+} MotifElement;
+
+/** a batch of records searched by a worker, and the hits found */
+typedef struct MotifBatch {
+	MotifHit *hits;
+	long nHits;
+	long nAllocated;
+	int done;
+} MotifBatch;
+
+typedef struct MotifWorker {
+	pthread_t thread;
+	MotifSet *set;
+	FASTAstore *store;
+	MotifBatch *batches;
+	long nBatches;
+	long *nextBatch;
+	pthread_mutex_t *lock;
+	pthread_cond_t *batchDone;
+} MotifWorker;
+
+
+static uint32_t
+standardMask_(void)
+{
+	uint32_t mask = 0;
+	const char *r;
+
+	for (r = standardResidues_; *r != '\0'; r++)
+		mask |= 1U << (*r - 'A');
+	return mask;
+}
+
+
+static int
+countLetters_(uint32_t letters)
+{
+	return __builtin_popcount(letters);
+}
+
+
+/**
+ * Break a pattern into its elements.
+ *
+ * Returns the number of elements, or -1 if the pattern is invalid
+ */
+static int
+parsePattern_(const char *text, MotifPattern *pattern, MotifElement *elements)
+{
+	const char *p = text;
+	char *end;
+	char close;
+	uint32_t letters;
+	int nElements = 0, complement;
+
+	pattern->anchorStart = pattern->anchorEnd = 0;
+	if (*p == '<') {
+		pattern->anchorStart = 1;
+		p++;
+	}
+
+	while (*p != '\0') {
+		if (*p == '-') {
+			p++;
+			continue;
+		}
+		if (*p == '.' && p[1] == '\0')
+			break;
+		if (*p == '>' && (p[1] == '\0' || (p[1] == '.' && p[2] == '\0'))) {
+			pattern->anchorEnd = 1;
+			p++;
+			continue;
+		}
+
+		if (*p == 'x') {
+			letters = standardMask_();
+		} else if (isalpha((unsigned char) *p)) {
+			letters = 1U << (toupper((unsigned char) *p) - 'A');
+		} else if (*p == '[' || *p == '{') {
+			complement = (*p == '{');
+			close = complement ? '}' : ']';
+			letters = 0;
+			for (p++; *p != close; p++) {
+				if (!isalpha((unsigned char) *p)) {
+					fprintf(stderr, "Error: pattern '%s': bad residue"
+							" class\n", text);
+					return -1;
+				}
+				letters |= 1U << (toupper((unsigned char) *p) - 'A');
+			}
+			if (complement)
+				letters = standardMask_() & ~letters;
+		} else {
+			fprintf(stderr, "Error: pattern '%s': unexpected '%c'\n",
+					text, *p);
+			return -1;
+		}
+		p++;
+
+		elements[nElements].letters = letters;
+		elements[nElements].minRepeat = 1;
+		elements[nElements].maxRepeat = 1;
+		if (*p == '(') {
+			elements[nElements].minRepeat = (int) strtol(p + 1, &end, 10);
+			elements[nElements].maxRepeat = elements[nElements].minRepeat;
+			if (*end == ',')
+				elements[nElements].maxRepeat = (int) strtol(end + 1, &end, 10);
+			if (*end != ')' || elements[nElements].minRepeat < 0
+					|| elements[nElements].maxRepeat
+						< elements[nElements].minRepeat) {
+				fprintf(stderr, "Error: pattern '%s': bad repeat count\n",
+						text);
+				return -1;
+			}
+			p = end + 1;
+		}
+		if (letters == 0) {
+			fprintf(stderr, "Error: pattern '%s': empty residue class\n",
+					text);
+			return -1;
+		}
+		nElements++;
+	}
+
+	return nElements;
+}
+
+
+/** the number of strings the elements expand to, capped at limit */
+static long
+countExpansions_(MotifElement *elements, int nElements, long limit)
+{
+	long total = 1, choices, power;
+	int i, r, nLetters;
+
+	for (i = 0; i < nElements; i++) {
+		nLetters = countLetters_(elements[i].letters);
+		choices = 0;
+		power = 1;
+		for (r = 0; r <= elements[i].maxRepeat; r++) {
+			if (r >= elements[i].minRepeat)
+				choices += power;
+			if (choices > limit)
+				return limit + 1;
+			power *= nLetters;
+			if (power > limit)
+				power = limit + 1;
+		}
+		total *= choices;
+		if (total > limit)
+			return limit + 1;
+	}
+	return total;
+}
+
+
+/** add a state to the trie, returning its index */
+static int
+newState_(MotifSet *set, int depth)
+{
+	int s, state;
+
+	if (set->nStates >= set->nAllocated) {
+		set->nAllocated = (set->nAllocated == 0) ? 1024 : set->nAllocated * 2;
+		set->next = (int *) reallocOrDie(set->next,
+				(size_t) set->nAllocated * MOTIF_SYMBOLS * sizeof(int));
+		set->depth = (int *) reallocOrDie(set->depth,
+				set->nAllocated * sizeof(int));
+		set->firstOutput = (int *) reallocOrDie(set->firstOutput,
+				set->nAllocated * sizeof(int));
+		set->outputLink = (int *) reallocOrDie(set->outputLink,
+				set->nAllocated * sizeof(int));
+	}
+
+	state = set->nStates++;
+	for (s = 0; s < MOTIF_SYMBOLS; s++)
+		set->next[state * MOTIF_SYMBOLS + s] = -1;
+	set->depth[state] = depth;
+	set->firstOutput[state] = -1;
+	set->outputLink[state] = -1;
+	return state;
+}
+
+
+/** record that pattern is recognised on reaching state */
+static void
+addOutput_(MotifSet *set, int state, int pattern)
+{
+	int o;
+
+	/** different routes through a pattern may spell the same string */
+	for (o = set->firstOutput[state]; o >= 0; o = set->outputs[o].next)
+		if (set->outputs[o].pattern == pattern)
+			return;
+
+	if (set->nOutputs >= set->nOutputsAllocated) {
+		set->nOutputsAllocated = (set->nOutputsAllocated == 0)
+				? 256 : set->nOutputsAllocated * 2;
+		set->outputs = reallocOrDie(set->outputs,
+				set->nOutputsAllocated * sizeof(set->outputs[0]));
+	}
+	set->outputs[set->nOutputs].pattern = pattern;
+	set->outputs[set->nOutputs].next = set->firstOutput[state];
+	set->firstOutput[state] = set->nOutputs++;
+}
+
+
+/**
+ * Insert every string the elements (from element index on, with
+ * nRepeats of it already placed) spell, continuing from trie state
+ */
+static void
+expand_(MotifSet *set, MotifElement *elements, int nElements, int index,
+		int nRepeats, int state, int pattern)
+{
+	MotifElement *element = &elements[index];
+	int letter, child;
+
+	if (index == nElements) {
+		addOutput_(set, state, pattern);
+		return;
+	}
+
+	if (nRepeats >= element->minRepeat)
+		expand_(set, elements, nElements, index + 1, 0, state, pattern);
+
+	if (nRepeats < element->maxRepeat) {
+		for (letter = 0; letter < MOTIF_OTHER_SYMBOL; letter++) {
+			if ((element->letters & (1U << letter)) == 0)
+				continue;
+			child = set->next[state * MOTIF_SYMBOLS + letter];
+			if (child < 0) {
+				child = newState_(set, set->depth[state] + 1);
+				set->next[state * MOTIF_SYMBOLS + letter] = child;
+			}
+			expand_(set, elements, nElements, index, nRepeats + 1,
+					child, pattern);
+		}
+	}
+}
+
+
+/**
+ * Turn the trie into a complete automaton: every missing transition
+ * is filled in from the failure state (the longest proper suffix of
+ * the state's string that is also in the trie), found breadth first
+ */
+static void
+buildAutomaton_(MotifSet *set)
+{
+	int *fail, *queue, head = 0, tail = 0, u, v, s, f;
+	int *next = set->next;
+
+	fail = (int *) reallocOrDie(NULL, set->nStates * sizeof(int));
+	queue = (int *) reallocOrDie(NULL, set->nStates * sizeof(int));
+
+	fail[0] = 0;
+	for (s = 0; s < MOTIF_SYMBOLS; s++) {
+		v = next[s];
+		if (v < 0) {
+			next[s] = 0;
+		} else {
+			fail[v] = 0;
+			queue[tail++] = v;
+		}
+	}
+
+	while (head < tail) {
+		u = queue[head++];
+		for (s = 0; s < MOTIF_SYMBOLS; s++) {
+			v = next[u * MOTIF_SYMBOLS + s];
+			if (v < 0) {
+				next[u * MOTIF_SYMBOLS + s] = next[fail[u] * MOTIF_SYMBOLS + s];
+				continue;
+			}
+			f = next[fail[u] * MOTIF_SYMBOLS + s];
+			fail[v] = f;
+			set->outputLink[v] = (set->firstOutput[f] >= 0)
+					? f : set->outputLink[f];
+			queue[tail++] = v;
+		}
+	}
+
+	free(fail);
+	free(queue);
+}
+
+
+MotifSet *
+motifCompile(char **patterns, int nPatterns)
+{
+	MotifSet *set;
+	MotifElement *elements;
+	long nExpansions;
+	int i, c, nElements;
+
+	set = (MotifSet *) calloc(1, sizeof(MotifSet));
+	if (set == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	set->patterns = (MotifPattern *) reallocOrDie(NULL,
+			(nPatterns + 1) * sizeof(MotifPattern));
+	set->nPatterns = nPatterns;
+
+	for (c = 0; c < 256; c++) {
+		set->symbol[c] = isalpha(c)
+				? (unsigned char) (toupper(c) - 'A') : MOTIF_OTHER_SYMBOL;
+	}
+
+	newState_(set, 0);
+	for (i = 0; i < nPatterns; i++) {
+		set->patterns[i].text = strdup(patterns[i]);
+
+		elements = (MotifElement *) reallocOrDie(NULL,
+				(strlen(patterns[i]) + 1) * sizeof(MotifElement));
+		nElements = parsePattern_(patterns[i], &set->patterns[i], elements);
+		if (nElements < 0) {
+			free(elements);
+			set->nPatterns = i + 1;
+			motifFree(set);
+			return NULL;
+		}
+
+		nExpansions = countExpansions_(elements, nElements,
+				MOTIF_MAX_EXPANSIONS);
+		if (nExpansions > MOTIF_MAX_EXPANSIONS)
+			fprintf(stderr, "Error: pattern '%s' expands to more than"
+					" %d strings\n", patterns[i], MOTIF_MAX_EXPANSIONS);
+		else if (nElements == 0)
+			fprintf(stderr, "Error: pattern '%s' is empty\n", patterns[i]);
+
+		if (nExpansions > MOTIF_MAX_EXPANSIONS || nElements == 0) {
+			free(elements);
+			set->nPatterns = i + 1;
+			motifFree(set);
+			return NULL;
+		}
+
+		expand_(set, elements, nElements, 0, 0, 0, i);
+		free(elements);
+
+		/** an empty match would be reported at every position */
+		if (set->firstOutput[0] >= 0) {
+			fprintf(stderr, "Error: pattern '%s' can match an empty"
+					" string\n", patterns[i]);
+			set->nPatterns = i + 1;
+			motifFree(set);
+			return NULL;
+		}
+	}
+
+	buildAutomaton_(set);
+	return set;
+}
+
+
+long
+motifSearchSequence(MotifSet *set, const char *sequence,
+		long recordIndex, MotifHitFn hitFn, void *context)
+{
+	const unsigned char *p = (const unsigned char *) sequence;
+	MotifPattern *pattern;
+	MotifHit hit;
+	long i, nHits = 0;
+	int state = 0, t, o;
+
+	hit.record = recordIndex;
+	for (i = 0; p[i] != '\0'; i++) {
+		state = set->next[state * MOTIF_SYMBOLS + set->symbol[p[i]]];
+
+		/** every pattern ending here: this state's, then down the links */
+		t = (set->firstOutput[state] >= 0) ? state : set->outputLink[state];
+		for (; t >= 0; t = set->outputLink[t]) {
+			for (o = set->firstOutput[t]; o >= 0; o = set->outputs[o].next) {
+				pattern = &set->patterns[set->outputs[o].pattern];
+				hit.length = set->depth[t];
+				hit.offset = i + 1 - hit.length;
+				if (pattern->anchorStart && hit.offset != 0)
+					continue;
+				if (pattern->anchorEnd && p[i + 1] != '\0')
+					continue;
+				hit.pattern = set->outputs[o].pattern;
+				hitFn(&hit, context);
+				nHits++;
+			}
+		}
+	}
+	return nHits;
+}
+
+
+/** hit callback used by the workers: keep the hit in the batch */
+static void
+collectHit_(const MotifHit *hit, void *context)
+{
+	MotifBatch *batch = (MotifBatch *) context;
+
+	if (batch->nHits >= batch->nAllocated) {
+		batch->nAllocated = (batch->nAllocated == 0)
+				? 64 : batch->nAllocated * 2;
+		batch->hits = (MotifHit *) reallocOrDie(batch->hits,
+				batch->nAllocated * sizeof(MotifHit));
+	}
+	batch->hits[batch->nHits++] = *hit;
+}
+
+
+static void *
+motifWorkerMain_(void *arg)
+{
+	MotifWorker *worker = (MotifWorker *) arg;
+	long b, r, end;
+
+	for (;;) {
+		b = __atomic_fetch_add(worker->nextBatch, 1, __ATOMIC_RELAXED);
+		if (b >= worker->nBatches)
+			break;
+
+		end = (b + 1) * MOTIF_RECORD_BATCH;
+		if (end > worker->store->nRecords)
+			end = worker->store->nRecords;
+		for (r = b * MOTIF_RECORD_BATCH; r < end; r++) {
+			motifSearchSequence(worker->set,
+					worker->store->records[r].sequence, r,
+					collectHit_, &worker->batches[b]);
+		}
+
+		pthread_mutex_lock(worker->lock);
+		worker->batches[b].done = 1;
+		pthread_cond_broadcast(worker->batchDone);
+		pthread_mutex_unlock(worker->lock);
+	}
+	return NULL;
+}
+
+
+long
+motifSearchStore(MotifSet *set, FASTAstore *store, int nThreads,
+		MotifHitFn hitFn, void *context)
+{
+	MotifWorker *workers;
+	MotifBatch *batches;
+	pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+	pthread_cond_t batchDone = PTHREAD_COND_INITIALIZER;
+	long nBatches, nextBatch = 0, nHits = 0, b, h, r;
+	int t;
+
+	if (nThreads <= 1) {
+		for (r = 0; r < store->nRecords; r++)
+			nHits += motifSearchSequence(set, store->records[r].sequence,
+					r, hitFn, context);
+		return nHits;
+	}
+
+	nBatches = (store->nRecords + MOTIF_RECORD_BATCH - 1) / MOTIF_RECORD_BATCH;
+	batches = (MotifBatch *) calloc(nBatches + 1, sizeof(MotifBatch));
+	workers = (MotifWorker *) calloc(nThreads, sizeof(MotifWorker));
+	if (batches == NULL || workers == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+
+	for (t = 0; t < nThreads; t++) {
+		workers[t].set = set;
+		workers[t].store = store;
+		workers[t].batches = batches;
+		workers[t].nBatches = nBatches;
+		workers[t].nextBatch = &nextBatch;
+		workers[t].lock = &lock;
+		workers[t].batchDone = &batchDone;
+		pthread_create(&workers[t].thread, NULL, motifWorkerMain_, &workers[t]);
+	}
+
+	/** hand on each batch's hits as soon as it and all before it are done */
+	for (b = 0; b < nBatches; b++) {
+		pthread_mutex_lock(&lock);
+		while (!batches[b].done)
+			pthread_cond_wait(&batchDone, &lock);
+		pthread_mutex_unlock(&lock);
+
+		for (h = 0; h < batches[b].nHits; h++)
+			hitFn(&batches[b].hits[h], context);
+		nHits += batches[b].nHits;
+		free(batches[b].hits);
+	}
+
+	for (t = 0; t < nThreads; t++)
+		pthread_join(workers[t].thread, NULL);
+
+	free(workers);
+	free(batches);
+	return nHits;
+}
+
+
+void
+motifFree(MotifSet *set)
+{
+	int i;
+
+	if (set == NULL)
+		return;
+	for (i = 0; i < set->nPatterns; i++)
+		free(set->patterns[i].text);
+	free(set->patterns);
+	free(set->next);
+	free(set->depth);
+	free(set->firstOutput);
+	free(set->outputLink);
+	free(set->outputs);
+	free(set);
+}
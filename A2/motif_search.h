@@ -0,0 +1,104 @@
+
+#ifndef	__MOTIF_SEARCH_HEADER__
+#define	__MOTIF_SEARCH_HEADER__
+
+#include "fasta_store.h"
+
+/**
+ * Multi-pattern motif search with an Aho-Corasick automaton.
+ *
+ * A set of patterns is compiled once into a deterministic automaton
+ * over the letters A-Z (case is ignored), which then finds every
+ * occurrence of every pattern in a single pass over each sequence.
+ * The compiled set may be reused for any number of stores.
+ *
+ * Patterns are plain strings ("RGD") or PROSITE-style patterns:
+ *     [ST]-x(2)-[DE]   elements separated by '-'
+ *     x                any of the 20 standard amino acids
+ *     [ABC]            any of the listed residues
+ *     {ABC}            any standard amino acid except those listed
+ *     e(n) or e(n,m)   the element repeated n, or n to m, times
+ *     < and >          anchor the match to the start or end of the
+ *                      sequence (at the start or end of the pattern)
+ * Each pattern is expanded into the set of strings it matches, all of
+ * which are placed in the automaton; patterns expanding to more than
+ * MOTIF_MAX_EXPANSIONS strings are rejected.
+ */
+
+#define	MOTIF_MAX_EXPANSIONS	(1 << 18)
+
+/** the 26 letters, and a 27th symbol for everything else */
+#define	MOTIF_SYMBOLS			27
+
+typedef struct MotifHit {
+	long record;	/* index of the record in the store */
+	long offset;	/* of the first matching residue, from 0 */
+	int length;
+	int pattern;	/* index of the pattern in the compiled set */
+} MotifHit;
+
+typedef struct MotifPattern {
+	char *text;
+	int anchorStart;
+	int anchorEnd;
+} MotifPattern;
+
+typedef struct MotifSet {
+	MotifPattern *patterns;
+	int nPatterns;
+
+	/** the symbol of each input byte */
+	unsigned char symbol[256];
+
+	/** the automaton: next[state * MOTIF_SYMBOLS + symbol] */
+	int *next;
+	int *depth;
+	int *firstOutput;	/* index into outputs, or -1 */
+	int *outputLink;	/* nearest matching state on the failure chain */
+	int nStates;
+	int nAllocated;
+
+	/** the patterns recognised at each state, as linked lists */
+	struct {
+		int pattern;
+		int next;
+	} *outputs;
+	int nOutputs;
+	int nOutputsAllocated;
+} MotifSet;
+
+/**
+ * called for each hit: record by record, and within a record in the
+ * order of the position at which each hit ends
+ */
+typedef void (*MotifHitFn)(const MotifHit *hit, void *context);
+
+/**
+ * Compile nPatterns patterns into a searchable set.
+ *
+ * Returns NULL (having described the problem) if a pattern is invalid
+ */
+MotifSet *motifCompile(char **patterns, int nPatterns);
+
+/**
+ * Report every hit in the sequence of record number recordIndex.
+ *
+ * Returns the number of hits
+ */
+long motifSearchSequence(MotifSet *set, const char *sequence,
+		long recordIndex, MotifHitFn hitFn, void *context);
+
+/**
+ * Search every record in store using nThreads worker threads.
+ * Hits are passed to hitFn, on the calling thread, in the same order
+ * a single-threaded search would produce them.
+ *
+ * Returns the number of hits
+ */
+long motifSearchStore(MotifSet *set, FASTAstore *store, int nThreads,
+		MotifHitFn hitFn, void *context);
+
+/** release the compiled set */
+void motifFree(MotifSet *set);
+
+#endif /* __MOTIF_SEARCH_HEADER__ */
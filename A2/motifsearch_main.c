@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fasta_store.h"
+#include "motif_search.h"
+#include "util.h"
+
+
+/** what the hit callback needs to print a hit */
+typedef struct HitPrinter {
+	MotifSet *set;
+	FASTAstore *store;
+	char *filename;
+	long *patternHits;
+	int countOnly;
+} HitPrinter;
+
+
+/** print a hit as: file, record name, position (from 1), pattern, match */
+void printHit(const MotifHit *hit, void *context)
+{
+	HitPrinter *printer = (HitPrinter *) context;
+	FASTArecord *record = &printer->store->records[hit->record];
+	const char *name;
+	int nameLength;
+
+	printer->patternHits[hit->pattern]++;
+	if (printer->countOnly)
+		return;
+
+	name = fastaRecordName(record, &nameLength);
+	printf("%s\t%.*s\t%ld\t%s\t%.*s\n", printer->filename,
+			nameLength, name, hit->offset + 1,
+			printer->set->patterns[hit->pattern].text,
+			hit->length, record->sequence + hit->offset);
+}
+
+
+/** add a pattern to the growing list */
+void addPattern(char ***patterns, int *nPatterns, const char *text)
+{
+	*patterns = (char **) realloc(*patterns, (*nPatterns + 1) * sizeof(char *));
+	if (*patterns == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	(*patterns)[(*nPatterns)++] = strdup(text);
+}
+
+
+/**
+ * read patterns from filename, one per line; blank lines and
+ * lines starting with '#' are skipped
+ */
+int readPatternFile(char *filename, char ***patterns, int *nPatterns)
+{
+	char line[MAX_DESCRIPTION_LINE_LENGTH];
+	FILE *fp;
+
+	if ((fp = fopen(filename, "r")) == NULL) {
+		fprintf(stderr, "Failure opening pattern file %s\n", filename);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '\0' || line[0] == '#')
+			continue;
+		addPattern(patterns, nPatterns, line);
+	}
+	fclose(fp);
+	return 0;
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Searches the FASTA records of each file for a set of motifs,\n");
+	fprintf(stderr, "printing one tab separated line per hit:\n");
+	fprintf(stderr, "    file, record, position, pattern, matched residues\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-p <PATTERN> : a motif, as a string or PROSITE pattern"
+			" such as [ST]-x(2)-[DE].\n");
+	fprintf(stderr, "-f <FILE>    : read motifs from FILE, one per line.\n");
+	fprintf(stderr, "-c           : only count the hits for each motif.\n");
+	fprintf(stderr, "-t <THREADS> : worker threads (default: one per CPU).\n");
+	fprintf(stderr, "-C           : load each file through its binary cache,\n");
+	fprintf(stderr, "               writing the cache if needed.\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	FASTAstore store;
+	MotifSet *set;
+	HitPrinter printer;
+	struct timespec startTime;
+	double searchSeconds = 0;
+	char **patterns = NULL, **files;
+	int i, nPatterns = 0, nFiles = 0, countOnly = 0, useCache = 0;
+	int nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	long nHits = 0, nRecords = 0, nResidues = 0;
+
+	files = (char **) malloc(argc * sizeof(char *));
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			if (argv[i][1] == 'c') {
+				countOnly = 1;
+			} else if (argv[i][1] == 'C') {
+				useCache = 1;
+			} else if (i + 1 >= argc) {
+				fprintf(stderr, "Error: option '%s' needs an argument\n",
+						argv[i]);
+				return 1;
+			} else if (argv[i][1] == 'p') {
+				addPattern(&patterns, &nPatterns, argv[++i]);
+			} else if (argv[i][1] == 'f') {
+				if (readPatternFile(argv[++i], &patterns, &nPatterns) < 0)
+					return 1;
+			} else if (argv[i][1] == 't') {
+				nThreads = atoi(argv[++i]);
+			} else {
+				fprintf(stderr,
+						"Error: unknown option '%s'\n", argv[i]);
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			files[nFiles++] = argv[i];
+		}
+	}
+
+	if (nPatterns == 0 || nFiles == 0) {
+		fprintf(stderr, "Provide at least one motif and one file"
+				" on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+
+	/** the motifs are compiled once, and used for every file */
+	set = motifCompile(patterns, nPatterns);
+	if (set == NULL)
+		return 1;
+
+	printer.set = set;
+	printer.store = &store;
+	printer.countOnly = countOnly;
+	printer.patternHits = (long *) calloc(nPatterns, sizeof(long));
+
+	for (i = 0; i < nFiles; i++) {
+		fastaStoreInit(&store);
+		if (useCache)
+			fastaStoreEnableCache(&store);
+		if (fastaStoreLoad(&store, files[i]) < 0) {
+			fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+					files[i]);
+			fastaStoreFree(&store);
+			return 1;
+		}
+
+		printer.filename = files[i];
+		clock_gettime(CLOCK_MONOTONIC, &startTime);
+		nHits += motifSearchStore(set, &store, nThreads, printHit, &printer);
+		searchSeconds += secondsSince(&startTime);
+
+		nRecords += store.nRecords;
+		nResidues += fastaStoreResidues(&store);
+		fastaStoreFree(&store);
+	}
+
+	if (countOnly) {
+		for (i = 0; i < nPatterns; i++)
+			printf("%ld\t%s\n", printer.patternHits[i], patterns[i]);
+	}
+
+	fprintf(stderr, "%ld hits for %d motifs in %ld records (%ld residues)"
+			" searched in %lf seconds : %.2f million residues/sec\n",
+			nHits, nPatterns, nRecords, nResidues, searchSeconds,
+			(searchSeconds > 0) ? nResidues / searchSeconds / 1e6 : 0.0);
+
+	motifFree(set);
+	for (i = 0; i < nPatterns; i++)
+		free(patterns[i]);
+	free(patterns);
+	free(printer.patternHits);
+	free(files);
+
+	return 0;
+}
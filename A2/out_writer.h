@@ -0,0 +1,75 @@
+
+#ifndef	__OUT_WRITER_HEADER__
+#define	__OUT_WRITER_HEADER__
+
+#include <stddef.h>
+
+/**
+ * A buffered writer for bulk text output.
+ *
+ * Output is gathered in a large buffer owned by the writer and handed
+ * to write(2) only when the buffer fills, with no stdio locking and
+ * no format parsing: strings are copied and integers are formatted by
+ * hand.  A piece too large for the buffer goes out in the same
+ * writev(2) call as whatever the buffer holds, rather than being
+ * copied through it.
+ *
+ * The writer goes straight to the file descriptor, so anything a
+ * FILE on the same descriptor has buffered must be flushed with
+ * fflush() first, and the writer flushed before the FILE is used
+ * again.
+ */
+
+#define	OW_DEFAULT_BUFFER_SIZE	(256 * 1024)
+
+typedef struct OutWriter {
+	int fd;				/* -1 for a writer that collects in memory */
+	char *buffer;
+	size_t size;
+	size_t used;
+	long long nBytes;	/* bytes written through the writer so far */
+	int error;			/* set once a write has failed */
+} OutWriter;
+
+/**
+ * Set up a writer on fd with a buffer of bufferSize bytes (or
+ * OW_DEFAULT_BUFFER_SIZE if 0).
+ *
+ * Returns 0, or -1 if the buffer cannot be allocated
+ */
+int  owInit(OutWriter *ow, int fd, size_t bufferSize);
+
+/**
+ * Set up a writer that collects its output in memory, in a buffer
+ * that starts at bufferSize bytes and grows as needed, so that text
+ * can be formatted on one thread and written out by another.  The
+ * text is in ow->buffer, ow->used bytes of it, until owClose().
+ *
+ * Returns 0, or -1 if the buffer cannot be allocated
+ */
+int  owInitMemory(OutWriter *ow, size_t bufferSize);
+
+/** write n bytes from p */
+void owWrite(OutWriter *ow, const char *p, size_t n);
+
+/** write a string, without its terminator */
+void owPuts(OutWriter *ow, const char *s);
+
+/** write one character */
+void owPutc(OutWriter *ow, int c);
+
+/** write value in decimal, as "%ld" would */
+void owPutLong(OutWriter *ow, long value);
+
+/**
+ * Write out whatever is buffered (for a memory writer, this does
+ * nothing).
+ *
+ * Returns 0, or -1 if this or any earlier write failed
+ */
+int  owFlush(OutWriter *ow);
+
+/** flush, then release the buffer; returns as owFlush() */
+int  owClose(OutWriter *ow);
+
+#endif /* __OUT_WRITER_HEADER__ */
@@ -0,0 +1,345 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "seq_stats.h"
+
+/** number of records a worker claims at a time */
+#define	SEQSTATS_RECORD_BATCH	64
+
+/** the 32-bit histogram tables are emptied before they can overflow */
+#define	SEQSTATS_FLUSH_LIMIT	(1UL << 30)
+
+/** members of each residue class, in lower case */
+static const char dnaClass_[] = "gc";
+static const char proteinClass_[] = "acfilmv";
+
+/** Kyte-Doolittle hydropathy of the standard amino acids */
+static const struct {
+	char residue;
+	double hydropathy;
+} kyteDoolittle_[] = {
+	{ 'A',  1.8 }, { 'R', -4.5 }, { 'N', -3.5 }, { 'D', -3.5 },
+	{ 'C',  2.5 }, { 'Q', -3.5 }, { 'E', -3.5 }, { 'G', -0.4 },
+	{ 'H', -3.2 }, { 'I',  4.5 }, { 'L',  3.8 }, { 'K', -3.9 },
+	{ 'M',  1.9 }, { 'F',  2.8 }, { 'P', -1.6 }, { 'S', -0.8 },
+	{ 'T', -0.7 }, { 'W', -0.9 }, { 'Y', -1.3 }, { 'V',  4.2 },
+};
+
+typedef struct StatsWorker {
+	pthread_t thread;
+	FASTAstore *store;
+	const char *classLetters;
+	long *nextRecord;
+	long *lengths;
+	SeqStats stats;
+
+	uint32_t tables[4][256];
+	uint64_t sinceFlush;
+} StatsWorker;
+
+
+/** move the interleaved 32-bit tables into the 64-bit totals */
+static void
+flushTables_(StatsWorker *worker)
+{
+	int c, t;
+
+	for (c = 0; c < 256; c++) {
+		for (t = 0; t < 4; t++)
+			worker->stats.residueCounts[c] += worker->tables[t][c];
+	}
+	memset(worker->tables, 0, sizeof(worker->tables));
+	worker->sinceFlush = 0;
+}
+
+
+/** add the n bytes at p to the histogram tables, 8 at a time */
+static void
+histogram_(uint32_t tables[4][256], const unsigned char *p, size_t n)
+{
+	uint64_t w;
+	size_t i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		memcpy(&w, p + i, sizeof(w));
+		tables[0][w & 0xff]++;
+		tables[1][(w >> 8) & 0xff]++;
+		tables[2][(w >> 16) & 0xff]++;
+		tables[3][(w >> 24) & 0xff]++;
+		tables[0][(w >> 32) & 0xff]++;
+		tables[1][(w >> 40) & 0xff]++;
+		tables[2][(w >> 48) & 0xff]++;
+		tables[3][w >> 56]++;
+	}
+	for (; i < n; i++)
+		tables[i & 3][p[i]]++;
+}
+
+
+/**
+ * Count the n bytes at p that are one of letters (given in lower
+ * case; either case matches)
+ */
+static size_t
+countClass_(const unsigned char *p, size_t n, const char *letters)
+{
+	size_t i = 0, total = 0;
+	const char *l;
+
+#ifdef __SSE2__
+	const __m128i caseBit = _mm_set1_epi8(0x20);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i targets[16], block, hits, counts, sums = zero;
+	int nTargets = 0, t, nBlocks;
+
+	for (l = letters; *l != '\0' && nTargets < 16; l++)
+		targets[nTargets++] = _mm_set1_epi8(*l);
+
+	while (i + 16 <= n) {
+		/**
+		 * each byte lane counts its matches (a compare gives -1),
+		 * and is emptied into the 64-bit sums before it can wrap
+		 */
+		counts = zero;
+		for (nBlocks = 0; nBlocks < 255 && i + 16 <= n; nBlocks++, i += 16) {
+			block = _mm_or_si128(_mm_loadu_si128((const __m128i *) (p + i)),
+					caseBit);
+			hits = _mm_cmpeq_epi8(block, targets[0]);
+			for (t = 1; t < nTargets; t++)
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, targets[t]));
+			counts = _mm_sub_epi8(counts, hits);
+		}
+		sums = _mm_add_epi64(sums, _mm_sad_epu8(counts, zero));
+	}
+	total = (size_t) _mm_cvtsi128_si64(sums)
+			+ (size_t) _mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums));
+#endif
+
+	for (; i < n; i++) {
+		for (l = letters; *l != '\0'; l++) {
+			if ((p[i] | 0x20) == *l) {
+				total++;
+				break;
+			}
+		}
+	}
+	return total;
+}
+
+
+static int
+lengthBucket_(long length)
+{
+	int bucket = 0;
+
+	while (length > 1 && bucket < SEQSTATS_LENGTH_BUCKETS - 1) {
+		length >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+
+static void
+addRecord_(StatsWorker *worker, long index)
+{
+	const unsigned char *sequence
+			= (const unsigned char *) worker->store->records[index].sequence;
+	SeqStats *stats = &worker->stats;
+	long length = (long) strlen((const char *) sequence);
+	size_t inClass;
+	int bucket;
+
+	worker->lengths[index] = length;
+	stats->nRecords++;
+	stats->nResidues += length;
+	if (stats->minLength < 0 || length < stats->minLength)
+		stats->minLength = length;
+	if (length > stats->maxLength)
+		stats->maxLength = length;
+	stats->lengthBuckets[lengthBucket_(length)]++;
+
+	if (worker->sinceFlush + length >= SEQSTATS_FLUSH_LIMIT)
+		flushTables_(worker);
+	histogram_(worker->tables, sequence, length);
+	worker->sinceFlush += length;
+
+	if (length > 0) {
+		inClass = countClass_(sequence, length, worker->classLetters);
+		stats->classResidues += inClass;
+		stats->classFractionSum += (double) inClass / length;
+		bucket = (int) (inClass * SEQSTATS_FRACTION_BUCKETS / length);
+		if (bucket >= SEQSTATS_FRACTION_BUCKETS)
+			bucket = SEQSTATS_FRACTION_BUCKETS - 1;
+		stats->classFractionBuckets[bucket]++;
+	}
+}
+
+
+static void *
+statsWorkerMain_(void *arg)
+{
+	StatsWorker *worker = (StatsWorker *) arg;
+	long start, end, i, nRecords = worker->store->nRecords;
+
+	for (;;) {
+		start = __atomic_fetch_add(worker->nextRecord, SEQSTATS_RECORD_BATCH,
+				__ATOMIC_RELAXED);
+		if (start >= nRecords)
+			break;
+		end = start + SEQSTATS_RECORD_BATCH;
+		if (end > nRecords)
+			end = nRecords;
+
+		for (i = start; i < end; i++)
+			addRecord_(worker, i);
+	}
+	flushTables_(worker);
+	return NULL;
+}
+
+
+static void
+initStats_(SeqStats *stats, int alphabet)
+{
+	memset(stats, 0, sizeof(SeqStats));
+	stats->alphabet = alphabet;
+	stats->className = (alphabet == SEQSTATS_ALPHABET_DNA)
+			? "GC" : "hydrophobic";
+	stats->minLength = -1;
+}
+
+
+/** add the totals of one worker into stats */
+static void
+mergeStats_(SeqStats *stats, SeqStats *partial)
+{
+	int i;
+
+	stats->nRecords += partial->nRecords;
+	stats->nResidues += partial->nResidues;
+	for (i = 0; i < 256; i++)
+		stats->residueCounts[i] += partial->residueCounts[i];
+	if (partial->minLength >= 0 && (stats->minLength < 0
+			|| partial->minLength < stats->minLength))
+		stats->minLength = partial->minLength;
+	if (partial->maxLength > stats->maxLength)
+		stats->maxLength = partial->maxLength;
+	for (i = 0; i < SEQSTATS_LENGTH_BUCKETS; i++)
+		stats->lengthBuckets[i] += partial->lengthBuckets[i];
+	stats->classResidues += partial->classResidues;
+	for (i = 0; i < SEQSTATS_FRACTION_BUCKETS; i++)
+		stats->classFractionBuckets[i] += partial->classFractionBuckets[i];
+	stats->classFractionSum += partial->classFractionSum;
+}
+
+
+static int
+compareLengths_(const void *a, const void *b)
+{
+	long la = *(const long *) a, lb = *(const long *) b;
+
+	return (la < lb) ? -1 : (la > lb);
+}
+
+
+/** the median and N50 need every length, sorted */
+static void
+orderStatistics_(SeqStats *stats, long *lengths, long nRecords)
+{
+	uint64_t covered = 0;
+	long i;
+
+	if (nRecords == 0)
+		return;
+
+	qsort(lengths, nRecords, sizeof(long), compareLengths_);
+	stats->medianLength = lengths[nRecords / 2];
+
+	/** N50: the length at which the longest records cover half the residues */
+	for (i = nRecords - 1; i >= 0; i--) {
+		covered += lengths[i];
+		if (covered * 2 >= stats->nResidues) {
+			stats->n50Length = lengths[i];
+			break;
+		}
+	}
+}
+
+
+int
+seqStatsCompute(FASTAstore *store, int alphabet, int nThreads,
+		SeqStats *stats)
+{
+	StatsWorker *workers;
+	long nextRecord = 0, *lengths;
+	int t;
+
+	if (alphabet != SEQSTATS_ALPHABET_DNA
+			&& alphabet != SEQSTATS_ALPHABET_PROTEIN) {
+		fprintf(stderr, "Error: unknown alphabet %d\n", alphabet);
+		return -1;
+	}
+	if (nThreads < 1)
+		nThreads = 1;
+
+	initStats_(stats, alphabet);
+	lengths = (long *) malloc((store->nRecords + 1) * sizeof(long));
+	workers = (StatsWorker *) calloc(nThreads, sizeof(StatsWorker));
+	if (lengths == NULL || workers == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+
+	for (t = 0; t < nThreads; t++) {
+		workers[t].store = store;
+		workers[t].classLetters = (alphabet == SEQSTATS_ALPHABET_DNA)
+				? dnaClass_ : proteinClass_;
+		workers[t].nextRecord = &nextRecord;
+		workers[t].lengths = lengths;
+		initStats_(&workers[t].stats, alphabet);
+	}
+
+	if (nThreads == 1) {
+		statsWorkerMain_(&workers[0]);
+	} else {
+		for (t = 0; t < nThreads; t++)
+			pthread_create(&workers[t].thread, NULL,
+					statsWorkerMain_, &workers[t]);
+		for (t = 0; t < nThreads; t++)
+			pthread_join(workers[t].thread, NULL);
+	}
+
+	for (t = 0; t < nThreads; t++)
+		mergeStats_(stats, &workers[t].stats);
+	if (stats->minLength < 0)
+		stats->minLength = 0;
+	orderStatistics_(stats, lengths, store->nRecords);
+
+	free(workers);
+	free(lengths);
+	return 0;
+}
+
+
+double
+seqStatsGravy(SeqStats *stats)
+{
+	double total = 0;
+	uint64_t n = 0, count;
+	size_t i;
+
+	for (i = 0; i < sizeof(kyteDoolittle_) / sizeof(kyteDoolittle_[0]); i++) {
+		count = stats->residueCounts[(unsigned char) kyteDoolittle_[i].residue]
+				+ stats->residueCounts[(unsigned char)
+						(kyteDoolittle_[i].residue | 0x20)];
+		total += count * kyteDoolittle_[i].hydropathy;
+		n += count;
+	}
+	return (n > 0) ? total / n : 0.0;
+}
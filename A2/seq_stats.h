@@ -0,0 +1,71 @@
+
+#ifndef	__SEQ_STATS_HEADER__
+#define	__SEQ_STATS_HEADER__
+
+#include <stdint.h>
+
+#include "fasta_store.h"
+
+/**
+ * Composition and length statistics over the sequences of a FASTAstore.
+ *
+ * The residue histogram is counted into four interleaved tables
+ * that are summed at the end.  Consecutive residues land in different
+ * tables, so a run of one letter does not stall on repeated
+ * increments of the same counter.  Sequences are read 8 bytes per load.
+ *
+ * Each record's share of a residue class (G+C for DNA, the
+ * hydrophobic residues for protein) is counted 16 bytes at a time
+ * with SSE2 compares.  A plain C loop is used where SSE2 is not
+ * available.
+ *
+ * Records are divided among worker threads, each of which keeps its
+ * own totals; these are added together when the threads finish.
+ */
+
+#define	SEQSTATS_ALPHABET_DNA		0
+#define	SEQSTATS_ALPHABET_PROTEIN	1
+
+/** lengths are binned by their base-2 logarithm */
+#define	SEQSTATS_LENGTH_BUCKETS		32
+
+/** per-record class fractions are binned in tenths */
+#define	SEQSTATS_FRACTION_BUCKETS	10
+
+typedef struct SeqStats {
+	int alphabet;
+	const char *className;	/* e.g. "GC" */
+
+	uint64_t nRecords;
+	uint64_t nResidues;
+	uint64_t residueCounts[256];
+
+	long minLength;
+	long maxLength;
+	long medianLength;
+	long n50Length;
+	uint64_t lengthBuckets[SEQSTATS_LENGTH_BUCKETS];
+
+	/** residues of the class, over all records */
+	uint64_t classResidues;
+	/** records binned by the fraction of their residues in the class */
+	uint64_t classFractionBuckets[SEQSTATS_FRACTION_BUCKETS];
+	double classFractionSum;
+} SeqStats;
+
+/**
+ * Gather the statistics of every sequence in store using nThreads
+ * worker threads.
+ *
+ * Returns 0 on success or -1 if the alphabet is unknown
+ */
+int seqStatsCompute(FASTAstore *store, int alphabet, int nThreads,
+		SeqStats *stats);
+
+/**
+ * The grand average of hydropathy (GRAVY): the mean Kyte-Doolittle
+ * value of the standard amino acids counted
+ */
+double seqStatsGravy(SeqStats *stats);
+
+#endif /* __SEQ_STATS_HEADER__ */
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fasta_store.h"
+#include "seq_stats.h"
+#include "util.h"
+
+
+/** print the length, composition and class summaries */
+void printStatsReport(SeqStats *stats)
+{
+	int i;
+
+	printf("Lengths: min %ld, max %ld, mean %.1f, median %ld, N50 %ld\n",
+			stats->minLength, stats->maxLength,
+			(stats->nRecords > 0)
+				? (double) stats->nResidues / stats->nRecords : 0.0,
+			stats->medianLength, stats->n50Length);
+	for (i = 0; i < SEQSTATS_LENGTH_BUCKETS; i++) {
+		if (stats->lengthBuckets[i] == 0)
+			continue;
+		printf("    %10lu - %-10lu : %lu\n",
+				(i == 0) ? 0UL : 1UL << i, (1UL << (i + 1)) - 1,
+				(unsigned long) stats->lengthBuckets[i]);
+	}
+
+	printf("Composition:\n");
+	for (i = 0; i < 256; i++) {
+		if (stats->residueCounts[i] == 0)
+			continue;
+		if (isprint(i))
+			printf("    %c     ", i);
+		else
+			printf("    \\x%02x  ", i);
+		printf(" %12lu  %6.2f%%\n", (unsigned long) stats->residueCounts[i],
+				100.0 * stats->residueCounts[i] / stats->nResidues);
+	}
+
+	if (stats->nResidues == 0)
+		return;
+
+	printf("%s residues: %.2f%% overall, %.2f%% mean per record\n",
+			stats->className,
+			100.0 * stats->classResidues / stats->nResidues,
+			100.0 * stats->classFractionSum / stats->nRecords);
+	for (i = 0; i < SEQSTATS_FRACTION_BUCKETS; i++) {
+		printf("    %3d%% - %3d%% : %lu\n",
+				i * 100 / SEQSTATS_FRACTION_BUCKETS,
+				(i + 1) * 100 / SEQSTATS_FRACTION_BUCKETS,
+				(unsigned long) stats->classFractionBuckets[i]);
+	}
+
+	if (stats->alphabet == SEQSTATS_ALPHABET_PROTEIN)
+		printf("GRAVY (mean Kyte-Doolittle hydropathy): %.4f\n",
+				seqStatsGravy(stats));
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Loads FASTA records from all files and reports their length\n");
+	fprintf(stderr, "and residue composition statistics.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-a <ALPHA>   : sequence alphabet: protein (default) or dna.\n");
+	fprintf(stderr, "-t <THREADS> : worker threads (default: one per CPU).\n");
+	fprintf(stderr, "-C           : load each file through its binary cache,\n");
+	fprintf(stderr, "               writing the cache if needed (give it before the files).\n");
+	fprintf(stderr, "\n");
+}
+
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	FASTAstore store;
+	SeqStats stats;
+	struct timespec startTime;
+	double loadSeconds, statsSeconds;
+	int i, alphabet = SEQSTATS_ALPHABET_PROTEIN, nFiles = 0;
+	int nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	long status;
+
+	fastaStoreInit(&store);
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			if (argv[i][1] == 'C') {
+				fastaStoreEnableCache(&store);
+			} else if (i + 1 >= argc) {
+				fprintf(stderr, "Error: option '%s' needs an argument\n",
+						argv[i]);
+				return 1;
+			} else if (argv[i][1] == 't') {
+				nThreads = atoi(argv[++i]);
+			} else if (argv[i][1] == 'a') {
+				i++;
+				if (strcmp(argv[i], "dna") == 0) {
+					alphabet = SEQSTATS_ALPHABET_DNA;
+				} else if (strcmp(argv[i], "protein") == 0) {
+					alphabet = SEQSTATS_ALPHABET_PROTEIN;
+				} else {
+					fprintf(stderr, "Error: unknown alphabet '%s'\n", argv[i]);
+					return 1;
+				}
+			} else {
+				fprintf(stderr,
+						"Error: unknown option '%s'\n", argv[i]);
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			status = fastaStoreLoad(&store, argv[i]);
+			if (status < 0) {
+				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+						argv[i]);
+				fastaStoreFree(&store);
+				return 1;
+			}
+			nFiles++;
+		}
+	}
+
+	if (nFiles == 0) {
+		fprintf(stderr,
+				"No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+	if (nThreads < 1)
+		nThreads = 1;
+
+	loadSeconds = secondsSince(&startTime);
+	printf("%ld FASTA records loaded from %d files in %lf seconds\n",
+			store.nRecords, nFiles, loadSeconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	if (seqStatsCompute(&store, alphabet, nThreads, &stats) < 0) {
+		fastaStoreFree(&store);
+		return 1;
+	}
+	statsSeconds = secondsSince(&startTime);
+
+	printf("%lu residues in %lu records scanned in %lf seconds using"
+			" %d threads : %.2f million residues/sec\n",
+			(unsigned long) stats.nResidues, (unsigned long) stats.nRecords,
+			statsSeconds, nThreads,
+			(statsSeconds > 0) ? stats.nResidues / statsSeconds / 1e6 : 0.0);
+
+	printStatsReport(&stats);
+
+	fastaStoreFree(&store);
+
+	return 0;
+}
@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "skiplist.h"
+
+/** towers are carved from chunks big enough for many of them */
+#define	SKIPLIST_CHUNK_SIZE		(64 * 1024)
+
+
+static int
+compareKeys_(SkipList *list, SkipKey a, SkipKey b)
+{
+	if (list->keyType == SKIPLIST_KEY_STRING)
+		return strcmp(a.string, b.string);
+	return (a.id > b.id) - (a.id < b.id);
+}
+
+
+/**
+ * Choose a height with P(height > h) = 4^-h, taking two random bits
+ * per level from a xorshift64* generator
+ */
+static int
+randomHeight_(SkipList *list)
+{
+	uint64_t bits;
+	int height = 1;
+
+	list->randomState ^= list->randomState >> 12;
+	list->randomState ^= list->randomState << 25;
+	list->randomState ^= list->randomState >> 27;
+	bits = list->randomState * 0x2545F4914F6CDD1DULL;
+
+	while (height < SKIPLIST_MAX_LEVEL && (bits & 3) == 0) {
+		height++;
+		bits >>= 2;
+	}
+	return height;
+}
+
+
+/** a tower of the given height, reusing a deleted one if we can */
+static SkipNode *
+newTower_(SkipList *list, int height)
+{
+	SkipNode *node;
+
+	if ((node = list->freeTowers[height]) != NULL) {
+		list->freeTowers[height] = node->next[0];
+	} else {
+		node = (SkipNode *) arenaAlloc(list->arena,
+				sizeof(SkipNode) + height * sizeof(SkipNode *));
+	}
+	node->height = height;
+	return node;
+}
+
+
+/**
+ * Walk down from the top level to the last node before key, noting
+ * in update[] the last node before key at each level
+ */
+static SkipNode *
+findPredecessors_(SkipList *list, SkipKey key, SkipNode **update)
+{
+	SkipNode *node = list->head;
+	int level;
+
+	for (level = list->level - 1; level >= 0; level--) {
+		while (node->next[level] != NULL
+				&& compareKeys_(list, node->next[level]->key, key) < 0)
+			node = node->next[level];
+		if (update != NULL)
+			update[level] = node;
+	}
+	return node;
+}
+
+
+SkipList *
+skipListCreate(int keyType)
+{
+	SkipList *list;
+	int i;
+
+	list = (SkipList *) malloc(sizeof(SkipList));
+	if (list == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	list->keyType = keyType;
+	list->level = 1;
+	list->nItems = 0;
+	list->randomState = 0x9E3779B97F4A7C15ULL;
+	for (i = 0; i <= SKIPLIST_MAX_LEVEL; i++)
+		list->freeTowers[i] = NULL;
+
+	list->arena = arenaCreate(SKIPLIST_CHUNK_SIZE);
+	list->head = newTower_(list, SKIPLIST_MAX_LEVEL);
+	list->head->value = NULL;
+	for (i = 0; i < SKIPLIST_MAX_LEVEL; i++)
+		list->head->next[i] = NULL;
+
+	return list;
+}
+
+
+SkipNode *
+skipListInsert(SkipList *list, SkipKey key, void *value, int *inserted)
+{
+	SkipNode *update[SKIPLIST_MAX_LEVEL], *node;
+	int level, height;
+
+	node = findPredecessors_(list, key, update)->next[0];
+	if (node != NULL && compareKeys_(list, node->key, key) == 0) {
+		if (inserted != NULL)
+			*inserted = 0;
+		return node;
+	}
+
+	height = randomHeight_(list);
+	for (level = list->level; level < height; level++)
+		update[level] = list->head;
+	if (height > list->level)
+		list->level = height;
+
+	node = newTower_(list, height);
+	node->key = key;
+	node->value = value;
+	for (level = 0; level < height; level++) {
+		node->next[level] = update[level]->next[level];
+		update[level]->next[level] = node;
+	}
+
+	list->nItems++;
+	if (inserted != NULL)
+		*inserted = 1;
+	return node;
+}
+
+
+SkipNode *
+skipListSeek(SkipList *list, SkipKey key)
+{
+	return findPredecessors_(list, key, NULL)->next[0];
+}
+
+
+SkipNode *
+skipListFind(SkipList *list, SkipKey key)
+{
+	SkipNode *node = skipListSeek(list, key);
+
+	if (node != NULL && compareKeys_(list, node->key, key) == 0)
+		return node;
+	return NULL;
+}
+
+
+SkipNode *
+skipListFirst(SkipList *list)
+{
+	return list->head->next[0];
+}
+
+
+SkipNode *
+skipListNext(SkipNode *node)
+{
+	return node->next[0];
+}
+
+
+void *
+skipListDelete(SkipList *list, SkipKey key)
+{
+	SkipNode *update[SKIPLIST_MAX_LEVEL], *node;
+	void *value;
+	int level;
+
+	node = findPredecessors_(list, key, update)->next[0];
+	if (node == NULL || compareKeys_(list, node->key, key) != 0)
+		return NULL;
+
+	for (level = 0; level < node->height; level++)
+		update[level]->next[level] = node->next[level];
+	while (list->level > 1 && list->head->next[list->level - 1] == NULL)
+		list->level--;
+
+	value = node->value;
+	node->next[0] = list->freeTowers[node->height];
+	list->freeTowers[node->height] = node;
+	list->nItems--;
+	return value;
+}
+
+
+void
+skipListApplyRange(SkipList *list, SkipKey *lo, SkipKey *hi,
+		void (*fn)(SkipNode*, void*), void *arg)
+{
+	SkipNode *node, *next;
+
+	node = (lo != NULL) ? skipListSeek(list, *lo) : skipListFirst(list);
+	for ( ; node != NULL; node = next) {
+		if (hi != NULL && compareKeys_(list, node->key, *hi) > 0)
+			break;
+		/** fetch the successor first, so that fn may delete node */
+		next = node->next[0];
+		(*fn)(node, arg);
+	}
+}
+
+
+void
+skipListFree(SkipList *list)
+{
+	if (list == NULL)
+		return;
+	arenaDestroy(list->arena);
+	free(list);
+}
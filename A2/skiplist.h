@@ -0,0 +1,97 @@
+
+#ifndef	__SKIPLIST_HEADER__
+#define	__SKIPLIST_HEADER__
+
+#include <stdint.h>
+
+#include "arena.h"
+
+/**
+ * An ordered map kept as a skip list.
+ *
+ * Each node carries a "tower" of forward pointers whose height is
+ * chosen at random (each level with probability 1/4), so a search
+ * drops down from the sparse upper levels and costs O(log n)
+ * comparisons on average, while the bottom level is an ordinary
+ * sorted linked list for iterating over a range.
+ *
+ * Keys are either strings, compared with strcmp(), or long ids.
+ * String keys are not copied: as with LLvNode, the caller keeps them
+ * alive for as long as the map.  The towers come from an arena, with
+ * deleted towers kept on a free list for each height so that they
+ * are reused, and the whole map is released at once by skipListFree().
+ */
+
+#define	SKIPLIST_KEY_STRING		0
+#define	SKIPLIST_KEY_ID			1
+
+/** enough levels for 4^32 keys */
+#define	SKIPLIST_MAX_LEVEL		32
+
+typedef union SkipKey {
+	const char *string;
+	long id;
+} SkipKey;
+
+#define	SKIP_KEY_STRING(s)		((SkipKey) { .string = (s) })
+#define	SKIP_KEY_ID(n)			((SkipKey) { .id = (n) })
+
+typedef struct SkipNode {
+	SkipKey key;
+	void *value;
+	int height;
+	struct SkipNode *next[];	/* height forward pointers */
+} SkipNode;
+
+typedef struct SkipList {
+	SkipNode *head;			/* a full height tower holding no key */
+	int keyType;
+	int level;				/* the highest level in use */
+	long nItems;
+	uint64_t randomState;
+	Arena *arena;
+	SkipNode *freeTowers[SKIPLIST_MAX_LEVEL + 1];
+} SkipList;
+
+/** create an empty map whose keys are of keyType */
+SkipList *skipListCreate(int keyType);
+
+/**
+ * Add key to the map with value, unless the key is already there.
+ *
+ * Returns the node holding key; *inserted (if not NULL) is set to 1
+ * if a node was added or 0 if an existing node was found
+ */
+SkipNode *skipListInsert(SkipList *list, SkipKey key, void *value,
+		int *inserted);
+
+/** the node holding key, or NULL if it is not in the map */
+SkipNode *skipListFind(SkipList *list, SkipKey key);
+
+/** the first node whose key is not less than key, or NULL */
+SkipNode *skipListSeek(SkipList *list, SkipKey key);
+
+/** the node with the least key, or NULL if the map is empty */
+SkipNode *skipListFirst(SkipList *list);
+
+/** the node following node in key order, or NULL */
+SkipNode *skipListNext(SkipNode *node);
+
+/**
+ * Remove key from the map.
+ *
+ * Returns its value, or NULL if the key was not in the map
+ */
+void *skipListDelete(SkipList *list, SkipKey key);
+
+/**
+ * Call fn for each node with a key from lo to hi inclusive, in order.
+ * A NULL bound leaves that end of the range open
+ */
+void skipListApplyRange(SkipList *list, SkipKey *lo, SkipKey *hi,
+		void (*fn)(SkipNode*, void*), void *arg);
+
+/** release the map; the keys and values are the caller's */
+void skipListFree(SkipList *list);
+
+#endif /* __SKIPLIST_HEADER__ */
@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "fasta.h"
+#include "compressed_input.h"
+#include "benchmark.h"
+#include "fasta_profile.h"
+#include "arena.h"
+#include "skiplist.h"
+#include "LLvNode.h"
+
+/** the settings given on the command line, used by processFasta() */
+static int keyType = SKIPLIST_KEY_STRING;
+static int useSortedList = 0;
+
+
+/**
+ * the name of fRecord, copied into arena (or with malloc() if arena
+ * is NULL) so that it can be a key
+ */
+static char *
+copyRecordName(FASTArecord *fRecord, Arena *arena)
+{
+	const char *name;
+	char *copy;
+	int nameLength;
+
+	name = fastaRecordName(fRecord, &nameLength);
+	if (arena != NULL) {
+		copy = (char *) arenaAlloc(arena, nameLength + 1);
+	} else if ((copy = (char *) malloc(nameLength + 1)) == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	memcpy(copy, name, nameLength);
+	copy[nameLength] = '\0';
+	return copy;
+}
+
+
+/** check that the loaded keys come out in ascending order */
+static int
+skipListInOrder(SkipList *list)
+{
+	SkipNode *node, *next;
+
+	for (node = skipListFirst(list); node != NULL; node = next) {
+		next = skipListNext(node);
+		if (next == NULL)
+			break;
+		if ((list->keyType == SKIPLIST_KEY_STRING)
+				? strcmp(node->key.string, next->key.string) >= 0
+				: node->key.id >= next->key.id)
+			return 0;
+	}
+	return 1;
+}
+
+
+/** free a sorted list node's malloc()ed key and record */
+static void
+deleteRecordNode(LLvNode *node, void *data)
+{
+	fastaDeallocateRecord((FASTArecord *) node->value);
+	free(node->key);
+}
+
+
+/**
+ * Release the loaded map or list: all at once with the arena if the
+ * records came from one, or else record by record
+ */
+static void
+freeLoaded(SkipList *list, LLvNode *head, Arena *arena)
+{
+	SkipNode *node;
+
+	if (arena != NULL) {
+		skipListFree(list);
+		arenaDestroy(arena);
+		return;
+	}
+
+	if (list != NULL) {
+		for (node = skipListFirst(list); node != NULL;
+				node = skipListNext(node)) {
+			fastaDeallocateRecord((FASTArecord *) node->value);
+			if (list->keyType == SKIPLIST_KEY_STRING)
+				free((char *) node->key.string);
+		}
+		skipListFree(list);
+	}
+	llFree(head, deleteRecordNode, NULL);
+}
+
+
+int processFasta(char *filename, BMOptions *options, BMSample *sample)
+{
+	FILE *fp;
+	FASTArecord *fRecord;
+	int lineNumber = 0, recordNumber = 0, nDuplicates = 0, status;
+	int eofSeen = 0, inserted;
+	BMTimer timer, freeTimer;
+	FPTimer phaseTimer;
+	Arena *arena = NULL;
+	SkipList *list = NULL;
+	LLvNode *head = NULL;
+	char *name = NULL;
+
+	fp = ciOpen(filename);
+	if (fp == NULL) {
+		fprintf(stderr, "Failure opening %s : %s\n",
+				filename, strerror(errno));
+		return -1;
+	}
+
+	/** with -A, records and their strings come from one arena (the
+	 * towers always come from the skip list's own) */
+	if (options->useArena)
+		arena = arenaCreate(0);
+	if (!useSortedList)
+		list = skipListCreate(keyType);
+
+	/** record the time now, before we do the work */
+	bmTimerStart(&timer);
+
+	do {
+		/** print a '.' every 10,000 records so
+		* we know something is happening */
+		if ((recordNumber % 10000) == 0) {
+			printf(".");
+			fflush(stdout);
+		}
+
+		if (arena != NULL)
+			fRecord = fastaAllocateRecordInArena(arena);
+		else
+			fRecord = fastaAllocateRecord();
+
+		status = fastaReadRecordInArena(fp, fRecord, arena);
+		if (status == 0) {
+			eofSeen = 1;
+
+		} else if (status > 0) {
+			lineNumber += status;
+			recordNumber++;
+
+			if (useSortedList || keyType == SKIPLIST_KEY_STRING)
+				name = copyRecordName(fRecord, arena);
+
+			fpStart(&phaseTimer);
+			if (useSortedList) {
+				head = llInsertByIndexOrder(head, (arena != NULL)
+						? llNewNodeInArena(arena, name, fRecord)
+						: llNewNode(name, fRecord));
+				fpStop(&phaseTimer, FP_CONTAINER, sizeof(LLvNode));
+			} else {
+				skipListInsert(list, (keyType == SKIPLIST_KEY_STRING)
+						? SKIP_KEY_STRING(name) : SKIP_KEY_ID(fRecord->id),
+						fRecord, &inserted);
+				fpStop(&phaseTimer, FP_CONTAINER, sizeof(SkipNode));
+				if (!inserted) {
+					nDuplicates++;
+					if (arena == NULL) {
+						fastaDeallocateRecord(fRecord);
+						free(name);
+					}
+				}
+			}
+
+		} else {
+			fprintf(stderr, "status = %d\n", status);
+			fprintf(stderr, "Error: failure at line %d of '%s'\n",
+					lineNumber, filename);
+			if (arena == NULL)
+				free(fRecord);
+			freeLoaded(list, head, arena);
+			fclose(fp);
+			return -1;
+		}
+
+	} while ( ! eofSeen);
+	printf(" %d FASTA records", recordNumber);
+	if (list != NULL)
+		printf(", %ld distinct keys (%d duplicates)%s",
+				list->nItems, nDuplicates,
+				skipListInOrder(list) ? "" : " OUT OF ORDER");
+	printf("\n");
+
+	/** record the time now, when the work is done */
+	bmTimerStop(&timer, sample);
+
+
+	fclose(fp);
+
+	if (arena == NULL)
+		free(fRecord); // the record allocated for the read that found EOF
+
+	bmTimerStart(&freeTimer);
+	fpStart(&phaseTimer);
+	freeLoaded(list, head, arena);
+	fpStop(&phaseTimer, FP_TEARDOWN, 0);
+	sample->freeSeconds = bmTimerElapsed(&freeTimer);
+
+	return recordNumber;
+}
+
+
+void usage(char *progname)
+{
+	fprintf(stderr, "%s [<OPTIONS>] <file> [ <file> ...]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Prints timing of loading FASTA records into an ordered map.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options: \n");
+	fprintf(stderr, "-k <KEY>     : order the records by name (default) or id.\n");
+	fprintf(stderr, "-L           : keep them in a sorted linked list instead,\n");
+	fprintf(stderr, "               to compare against the skip list (by name only).\n");
+	bmUsage(stderr);
+	fprintf(stderr, "\n");
+}
+
+/**
+ * Program mainline
+ */
+int main(int argc, char **argv)
+{
+	BMOptions options;
+	int i, status, recordsProcessed = 0;
+
+	bmInitOptions(&options, argv[0]);
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			if (strcmp(argv[i], "-L") == 0
+					|| (strcmp(argv[i], "-k") == 0 && i + 1 < argc)) {
+				if (strcmp(argv[i], "-L") == 0) {
+					useSortedList = 1;
+				} else if (strcmp(argv[++i], "name") == 0) {
+					keyType = SKIPLIST_KEY_STRING;
+				} else if (strcmp(argv[i], "id") == 0) {
+					keyType = SKIPLIST_KEY_ID;
+				} else {
+					fprintf(stderr, "Error: unknown key '%s'\n", argv[i]);
+					return 1;
+				}
+				/** the sorted list is ordered by name only */
+				if (useSortedList && keyType == SKIPLIST_KEY_ID) {
+					fprintf(stderr, "Error: -L cannot be used with -k id\n");
+					usage(argv[0]);
+					return 1;
+				}
+				continue;
+			}
+			status = bmParseOption(&options, argc, argv, &i);
+			if (status < 0) {
+				return 1;
+			} else if (status == 0) {
+				fprintf(stderr,
+						"Error: unknown option '%s'\n", argv[i]);
+				usage(argv[0]);
+			}
+		} else {
+			recordsProcessed = bmProcessRepeatedly(argv[i], &options,
+					processFasta);
+			if (recordsProcessed < 0) {
+				fprintf(stderr, "Error: Processing '%s' failed -- exitting\n",
+						argv[i]);
+				return 1;
+			}
+			printf("%d records processed from '%s'\n",
+					recordsProcessed, argv[i]);
+		}
+	}
+
+	if ( recordsProcessed == 0 ) {
+		fprintf(stderr,
+				"No data processed -- provide the name of"
+				" a file on the command line\n");
+		usage(argv[0]);
+		return 1;
+	}
+
+	return 0;
+}
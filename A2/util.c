@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util.h"
+
+
+double
+secondsSince(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec)
+			+ ((now.tv_nsec - start->tv_nsec) / 1e9);
+}
+
+
+void *
+reallocOrDie(void *block, size_t size)
+{
+	block = realloc(block, size);
+	if (block == NULL) {
+		fprintf(stderr, "ERROR: Memory Allocation failed.\n");
+		exit(1);
+	}
+	return block;
+}
+
+
+FILE *
+tempFileOpen(const char *filename, const char *mode, char **tmpName)
+{
+	FILE *ofp;
+
+	*tmpName = (char *) reallocOrDie(NULL, strlen(filename) + 32);
+	sprintf(*tmpName, "%s.%ld", filename, (long) getpid());
+	if ((ofp = fopen(*tmpName, mode)) == NULL) {
+		free(*tmpName);
+		*tmpName = NULL;
+	}
+	return ofp;
+}
+
+
+int
+tempFileCommit(FILE *ofp, char *tmpName, const char *filename, int ok)
+{
+	if (fclose(ofp) != 0)
+		ok = 0;
+	if (ok && rename(tmpName, filename) < 0)
+		ok = 0;
+	if (!ok)
+		unlink(tmpName);
+
+	free(tmpName);
+	return ok;
+}